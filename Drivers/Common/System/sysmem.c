@@ -66,7 +66,12 @@ void *_sbrk(ptrdiff_t incr)
   extern uint8_t _end; /* Symbol defined in the linker script */
   extern uint8_t _estack; /* Symbol defined in the linker script */
   extern uint32_t _Min_Stack_Size; /* Symbol defined in the linker script */
-  const uint32_t stack_limit = (uint32_t)&_estack - (uint32_t)&_Min_Stack_Size;
+  // UTAT EDIT - BEGINNING
+  // The MemManage handler's stack (see Stack.c) is right below the MSP stack
+  extern uint32_t _Fault_Stack_Size; /* Symbol defined in the linker script */
+  const uint32_t stack_limit = (uint32_t)&_estack - (uint32_t)&_Min_Stack_Size -
+      (uint32_t)&_Fault_Stack_Size;
+  // UTAT EDIT - END
   const uint8_t *max_heap = (uint8_t *)stack_limit;
   uint8_t *prev_heap_end;
 
@@ -63,6 +63,17 @@ Reset_Handler:
   ldr   r0, =_estack
   mov   sp, r0          /* set stack pointer */
 
+/* Paint the stack with STACK_PAINT (see Stack.h) before anything is pushed
+   onto it, so the deepest point it reaches can be found later */
+  ldr r1, =_Min_Stack_Size
+  subs r2, r0, r1
+  ldr r3, =0xA5A5A5A5
+PaintStack:
+  str r3, [r2]
+  adds r2, r2, #4
+  cmp r2, r0
+  bcc PaintStack
+
 /* Copy the data segment initializers from flash to SRAM */
   ldr r0, =_sdata
   ldr r1, =_edata
@@ -61,6 +61,18 @@ defined in linker script */
 Reset_Handler:  
   ldr   sp, =_estack      /* set stack pointer */
 
+/* Paint the stack with STACK_PAINT (see Stack.h) before anything is pushed
+   onto it, so the deepest point it reaches can be found later */
+  ldr  r0, =_estack
+  ldr  r1, =_Min_Stack_Size
+  subs  r0, r0, r1
+  ldr  r1, =_estack
+  ldr  r3, =0xA5A5A5A5
+PaintStack:
+  str  r3, [r0], #4
+  cmp  r0, r1
+  bcc  PaintStack
+
 /* Call the clock system intitialization function.*/
   bl  SystemInit
 
@@ -92,6 +104,27 @@ LoopFillZerobss:
   cmp  r2, r3
   bcc  FillZerobss
 
+/* Copy the ITCM code and DTCM data from flash (FAST_CODE and FAST_DATA in
+   Sections.h) */
+  ldr  r0, =_sitcm
+  ldr  r1, =_eitcm
+  ldr  r2, =_siitcm
+  bl  CopyRegion
+  ldr  r0, =_sdtcm_data
+  ldr  r1, =_edtcm_data
+  ldr  r2, =_sidtcm_data
+  bl  CopyRegion
+/* Make sure the ITCM code is written before it can be executed */
+  dsb
+  isb
+/* Zero fill the DTCM and D2 SRAM bss sections (FAST_BSS and DMA_BUFFER) */
+  ldr  r0, =_sdtcm_bss
+  ldr  r1, =_edtcm_bss
+  bl  ZeroRegion
+  ldr  r0, =_sd2_bss
+  ldr  r1, =_ed2_bss
+  bl  ZeroRegion
+
 /* Call static constructors */
     bl __libc_init_array
 /* Call the application's entry point.*/
@@ -99,6 +132,33 @@ LoopFillZerobss:
   bx  lr    
 .size  Reset_Handler, .-Reset_Handler
 
+/* Copy words from r2 to r0 until r0 reaches r1 */
+    .section  .text.CopyRegion
+  .type  CopyRegion, %function
+CopyRegion:
+  cmp  r0, r1
+  bcs  CopyRegionDone
+  ldr  r3, [r2], #4
+  str  r3, [r0], #4
+  b  CopyRegion
+CopyRegionDone:
+  bx  lr
+.size  CopyRegion, .-CopyRegion
+
+/* Zero fill words from r0 until r0 reaches r1 */
+    .section  .text.ZeroRegion
+  .type  ZeroRegion, %function
+ZeroRegion:
+  movs  r3, #0
+LoopZeroRegion:
+  cmp  r0, r1
+  bcs  ZeroRegionDone
+  str  r3, [r0], #4
+  b  LoopZeroRegion
+ZeroRegionDone:
+  bx  lr
+.size  ZeroRegion, .-ZeroRegion
+
 /**
  * @brief  This is the code that gets called when the processor receives an 
  *         unexpected interrupt.  This simply enters an infinite loop, preserving
@@ -78,7 +78,7 @@
 
 /************************* Miscellaneous Configuration ************************/
 /*!< Uncomment the following line if you need to use initialized data in D2 domain SRAM (AHB SRAM) */
-/* #define DATA_IN_D2_SRAM */
+#define DATA_IN_D2_SRAM
 
 /*!< Uncomment the following line if you need to relocate your vector Table in
      Internal SRAM. */
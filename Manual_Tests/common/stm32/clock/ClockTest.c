@@ -0,0 +1,129 @@
+/*
+ * ClockTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the microsecond clock: its rate against HAL_GetTick(), the accuracy of
+ * clock_delay_us() against the CPU cycle counter, and that the 64-bit time
+ * stays monotonic across a counter overflow (including when the overflow
+ * interrupt can't run).
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/uart/Log.h>
+#include <common/stm32/util/Profile.h>
+
+// Number of times to read the clock when checking it never goes backwards
+#define MONOTONIC_READS 100000
+
+Clock g_clock;
+
+/*
+ * Reads the clock repeatedly and returns the number of times it went
+ * backwards.
+ */
+uint32_t count_backwards(uint32_t reads) {
+    uint32_t backwards = 0;
+    uint64_t prev = clock_now_us();
+    for (uint32_t i = 0; i < reads; i++) {
+        uint64_t now = clock_now_us();
+        if (now < prev) {
+            backwards++;
+        }
+        prev = now;
+    }
+    return backwards;
+}
+
+/*
+ * Moves the counter to just before it wraps around, so an overflow happens
+ * in about 1 ms.
+ */
+void set_counter_near_overflow(void) {
+    __HAL_TIM_SET_COUNTER(&g_clock.timer.handle, 0xFFFFFFFF - 1000);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    Log log;
+    log_init(&log, &uart);
+
+    info(&log, "Starting clock test");
+
+    clock_init(&g_clock, TIM2);
+    info(&log, "Timer input clock: %lu Hz, prescaler: %lu",
+            timer_get_input_clock_freq(&g_clock.timer),
+            g_clock.timer.handle.Init.Prescaler);
+
+    // The clock should count 1000 us for every HAL tick
+    uint32_t start_ms = HAL_GetTick();
+    uint64_t start_us = clock_now_us();
+    HAL_Delay(1000);
+    uint32_t elapsed_ms = HAL_GetTick() - start_ms;
+    uint32_t elapsed_us = (uint32_t) clock_elapsed_us(start_us);
+    info(&log, "HAL_GetTick(): %lu ms, clock: %lu us", elapsed_ms, elapsed_us);
+
+    // Compare clock_delay_us() with the number of CPU cycles it took
+    profile_init();
+    uint32_t delays_us[] = {1, 10, 100, 1000, 10000};
+    for (uint32_t i = 0; i < sizeof(delays_us) / sizeof(delays_us[0]); i++) {
+        uint32_t start_cycles = profile_now();
+        clock_delay_us(delays_us[i]);
+        uint32_t cycles = profile_now() - start_cycles;
+        info(&log, "clock_delay_us(%lu): %lu us measured", delays_us[i],
+                (uint32_t) (((uint64_t) cycles * 1000000) / SystemCoreClock));
+    }
+
+    // Cost of reading the clock
+    uint32_t start_cycles = profile_now();
+    for (uint32_t i = 0; i < 1000; i++) {
+        clock_now_us();
+    }
+    info(&log, "clock_now_us(): %lu cycles/call",
+            (profile_now() - start_cycles) / 1000);
+
+    info(&log, "Went backwards %lu times in %lu reads",
+            count_backwards(MONOTONIC_READS), (uint32_t) MONOTONIC_READS);
+
+    // Overflow with the interrupt running normally
+    uint32_t overflows = g_clock.overflows;
+    set_counter_near_overflow();
+    uint32_t backwards = count_backwards(MONOTONIC_READS);
+    info(&log, "Overflow: overflows %lu -> %lu, went backwards %lu times",
+            overflows, g_clock.overflows, backwards);
+
+    // Overflow while interrupts are disabled, so `overflows` is out of date
+    // and the time must be corrected using the update flag
+    overflows = g_clock.overflows;
+    __disable_irq();
+    set_counter_near_overflow();
+    uint64_t before_us = clock_now_us();
+    // Wait (without the clock) long enough for the counter to wrap
+    start_cycles = profile_now();
+    while (profile_now() - start_cycles < SystemCoreClock / 500) {
+    }
+    uint64_t after_us = clock_now_us();
+    uint32_t overflows_during = g_clock.overflows;
+    __enable_irq();
+    uint64_t enabled_us = clock_now_us();
+    info(&log, "Overflow with IRQs disabled: overflows %lu -> %lu -> %lu",
+            overflows, overflows_during, g_clock.overflows);
+    info(&log, "Time went forward: %s, %s",
+            (after_us > before_us) ? "PASS" : "FAIL",
+            (enabled_us >= after_us) ? "PASS" : "FAIL");
+    info(&log, "Upper 32 bits: 0x%lX -> 0x%lX", (uint32_t) (before_us >> 32),
+            (uint32_t) (after_us >> 32));
+
+    info(&log, "Done clock test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * GPIODebouncerTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the debouncer on the blue button (PC13 on both the Nucleo-G474RE and
+ * Nucleo-H743ZI2, high when pressed), plus PC0-PC3 with pull-ups as active-low
+ * inputs (short one to ground with a jumper wire, or tap it against ground to
+ * make it bounce).
+ *
+ * Each press and release should be logged exactly once, no matter how fast
+ * the button is pressed or how much the wire bounces. The callback and
+ * latched event counts should always match.
+ */
+
+#include <common/stm32/gpio/GPIODebouncer.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/uart/Log.h>
+
+#define BUTTON_PIN GPIO_PIN_13
+#define WIRE_PINS (GPIO_PIN_0 | GPIO_PIN_1 | GPIO_PIN_2 | GPIO_PIN_3)
+
+Log g_log;
+GPIODebouncer g_debouncer;
+
+// These must be volatile since they are modified inside the ISR callback
+volatile uint32_t g_cb_presses = 0;
+volatile uint32_t g_cb_releases = 0;
+
+uint32_t count_pins(uint16_t pins) {
+    return (uint32_t) __builtin_popcount(pins);
+}
+
+void debounced(void* context, GPIO_TypeDef* port, uint16_t pressed,
+        uint16_t released) {
+    g_cb_presses += count_pins(pressed);
+    g_cb_releases += count_pins(released);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting GPIO debouncer test");
+
+    gpio_debouncer_init(&g_debouncer, TIM6, GPIO_DEBOUNCER_DEFAULT_HZ,
+            debounced, NULL);
+    gpio_debouncer_add_pins(&g_debouncer, &mcu, GPIOC, BUTTON_PIN,
+            GPIO_NOPULL, false);
+    gpio_debouncer_add_pins(&g_debouncer, &mcu, GPIOC, WIRE_PINS,
+            GPIO_PULLUP, true);
+    gpio_debouncer_start(&g_debouncer);
+
+    info(&g_log, "Press the blue button or ground PC0-PC3");
+
+    uint32_t presses = 0;
+    uint32_t releases = 0;
+    while (1) {
+        uint16_t pressed = gpio_debouncer_get_pressed(&g_debouncer, GPIOC);
+        uint16_t released = gpio_debouncer_get_released(&g_debouncer, GPIOC);
+        if (pressed != 0 || released != 0) {
+            presses += count_pins(pressed);
+            releases += count_pins(released);
+            info(&g_log, "Pressed: 0x%04x, released: 0x%04x, button is %s",
+                    pressed, released,
+                    gpio_debouncer_is_pressed(&g_debouncer, GPIOC,
+                    BUTTON_PIN) ? "down" : "up");
+            info(&g_log, "Total presses: %lu (callback %lu), releases: %lu "
+                    "(callback %lu)", presses, g_cb_presses, releases,
+                    g_cb_releases);
+        }
+        // The debouncer's timer interrupt wakes this up
+        idle_sleep();
+    }
+}
@@ -0,0 +1,151 @@
+/*
+ * GPIOEdgeQueueTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the GPIO edge queue with a PWM signal. Connect PA6 (TIM3 channel 1,
+ * PWM output) to PB6 (interrupt input) with a jumper wire (these pins are the
+ * same on the Nucleo-G474RE and Nucleo-H743ZI2).
+ *
+ * First measures the interrupt latency with software triggers while the PWM is
+ * off. Then runs a 1 kHz, 25% duty PWM signal for 1 second, draining the queue
+ * in batches, and checks the timestamps give the expected period and high
+ * time and that the levels alternate. Finally, stops draining for a while to
+ * check that overflows are counted.
+ */
+
+#include <common/stm32/gpio/GPIOEdgeQueue.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/timer/PWM.h>
+#include <common/stm32/uart/Log.h>
+
+// Number of edges read from the queue at once
+#define BATCH_SIZE 16
+
+Clock g_clock;
+Log g_log;
+
+Timer g_pwm_timer;
+PWM g_pwm;
+GPIOITInput g_input;
+GPIOEdgeQueue g_queue;
+
+void test_edges(void) {
+    info(&g_log, "Recording 1 kHz, 25%% duty PWM for 1 s");
+
+    pwm_set_freq(&g_pwm, 1000);
+    pwm_set_duty(&g_pwm, 25.0f);
+    pwm_start(&g_pwm);
+
+    GPIOEdge batch[BATCH_SIZE];
+    GPIOEdge last = {0};
+    bool have_last = false;
+    uint32_t edges = 0;
+    uint32_t same_level = 0;
+    uint32_t batches = 0;
+    uint64_t high_sum_us = 0;
+    uint32_t highs = 0;
+    uint64_t low_sum_us = 0;
+    uint32_t lows = 0;
+
+    uint64_t deadline = clock_deadline_ms(1000);
+    while (!clock_deadline_passed(deadline)) {
+        uint32_t count = gpio_edge_queue_read(&g_queue, batch, BATCH_SIZE);
+        if (count > 0) {
+            batches++;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (have_last) {
+                uint64_t interval_us = batch[i].timestamp_us -
+                        last.timestamp_us;
+                if (batch[i].level == last.level) {
+                    same_level++;
+                } else if (last.level == 1) {
+                    high_sum_us += interval_us;
+                    highs++;
+                } else {
+                    low_sum_us += interval_us;
+                    lows++;
+                }
+            }
+            last = batch[i];
+            have_last = true;
+            edges++;
+        }
+        // Wake up at the next edge (or the clock overflow)
+        idle_sleep();
+    }
+    pwm_stop(&g_pwm);
+
+    info(&g_log, "Edges: %lu (expected 2000) in %lu batches", edges, batches);
+    info(&g_log, "Same level twice in a row: %lu (expected 0)", same_level);
+    if (highs > 0 && lows > 0) {
+        info(&g_log, "Average high time: %lu us (expected 250)",
+                (uint32_t) (high_sum_us / highs));
+        info(&g_log, "Average low time: %lu us (expected 750)",
+                (uint32_t) (low_sum_us / lows));
+    }
+    info(&g_log, "Overflows: %lu (expected 0)", g_queue.overflows);
+}
+
+void test_overflow(void) {
+    info(&g_log, "Not reading the queue for 100 ms");
+
+    // Empty the queue first
+    GPIOEdge batch[BATCH_SIZE];
+    while (gpio_edge_queue_read(&g_queue, batch, BATCH_SIZE) > 0) {
+    }
+    uint32_t start_overflows = g_queue.overflows;
+
+    pwm_start(&g_pwm);
+    clock_delay_us(100000);
+    pwm_stop(&g_pwm);
+
+    info(&g_log, "Available: %lu (expected %lu)",
+            gpio_edge_queue_available(&g_queue),
+            (uint32_t) GPIO_EDGE_QUEUE_SIZE);
+    info(&g_log, "Overflows: %lu (expected about %lu)",
+            g_queue.overflows - start_overflows,
+            200 - (uint32_t) GPIO_EDGE_QUEUE_SIZE);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting GPIO edge queue test");
+
+    clock_init(&g_clock, TIM2);
+
+    // PWM on TIM3 channel 1, the frequency is set by pwm_set_freq()
+    timer_setup(&g_pwm_timer, 0, 0xFFFF, 0);
+    timer_customize(&g_pwm_timer, TIM3, 1, 0, 0);
+    timer_init(&g_pwm_timer);
+    pwm_init(&g_pwm, &g_pwm_timer, TIM_CHANNEL_1, &mcu, GPIOA, GPIO_PIN_6,
+            GPIO_AF2_TIM3);
+
+    gpio_edge_queue_init(&g_queue);
+    gpio_edge_queue_add_input(&g_queue, &g_input, &mcu, GPIOB, GPIO_PIN_6,
+            GPIO_MODE_IT_RISING_FALLING, GPIO_NOPULL);
+
+    uint32_t latency = gpio_edge_queue_measure_latency(&g_queue, GPIO_PIN_6,
+            1000);
+    info(&g_log, "Max interrupt latency: %lu cycles (%lu ns)", latency,
+            (uint32_t) (((uint64_t) latency * 1000000000) / SystemCoreClock));
+
+    test_edges();
+    test_overflow();
+
+    info(&g_log, "Done GPIO edge queue test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
@@ -0,0 +1,197 @@
+/*
+ * GPIOFastTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the direct-register GPIO functions in two parts:
+ * - Checks the BSRR words written by the fast output and bus functions, using
+ *   a GPIO_TypeDef in RAM in place of a real port (so the written values can
+ *   be read back exactly)
+ * - Benchmarks toggles per second with the HAL functions and the fast
+ *   functions, on the LED pin (watch the pin on a scope to see the edges), and
+ *   writes a counting pattern to a 4-pin bus on PC0-PC3 (all 4 pins should
+ *   change on the same edge on a logic analyzer)
+ */
+
+#include <common/stm32/gpio/GPIO.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/util/Profile.h>
+#include <nucleo_g474re/G474REConfig.h>
+#include <nucleo_h743zi2/H743ZI2Config.h>
+#include <string.h>
+
+// Number of toggles timed for each benchmark
+#define TOGGLE_COUNT 100000
+
+#define BUS_MASK (GPIO_PIN_0 | GPIO_PIN_1 | GPIO_PIN_2 | GPIO_PIN_3)
+
+Log g_log;
+
+// Stand-in for a GPIO port's registers
+GPIO_TypeDef g_stub_port;
+uint32_t g_stub_failures = 0;
+
+void check_bsrr(char* name, uint32_t expected) {
+    if (g_stub_port.BSRR != expected) {
+        error(&g_log, "%s: BSRR 0x%08lx, expected 0x%08lx", name,
+                (uint32_t) g_stub_port.BSRR, expected);
+        g_stub_failures++;
+    }
+}
+
+void test_stub_port(void) {
+    info(&g_log, "Checking register writes on stub port");
+    memset(&g_stub_port, 0, sizeof(g_stub_port));
+
+    GPIOOutput output = {NULL, &g_stub_port, GPIO_PIN_5};
+    gpio_set_fast(&output, GPIO_PIN_SET);
+    check_bsrr("gpio_set_fast(SET)", 0x00000020);
+    gpio_set_fast(&output, GPIO_PIN_RESET);
+    check_bsrr("gpio_set_fast(RESET)", 0x00200000);
+    gpio_set_high_fast(&output);
+    check_bsrr("gpio_set_high_fast", 0x00000020);
+    gpio_set_low_fast(&output);
+    check_bsrr("gpio_set_low_fast", 0x00200000);
+
+    // Toggling depends on ODR, which does not change by itself in RAM
+    g_stub_port.ODR = 0x0000;
+    gpio_toggle_fast(&output);
+    check_bsrr("gpio_toggle_fast (low)", 0x00000020);
+    g_stub_port.ODR = 0xFFFF;
+    gpio_toggle_fast(&output);
+    check_bsrr("gpio_toggle_fast (high)", 0x00200000);
+
+    // Only the pins in the mask may ever be written
+    GPIOBus bus = {NULL, &g_stub_port, BUS_MASK};
+    gpio_bus_write(&bus, 0x0005);
+    check_bsrr("gpio_bus_write(0x5)", 0x000A0005);
+    gpio_bus_write(&bus, 0xFFF0);
+    check_bsrr("gpio_bus_write(0xFFF0)", 0x000F0000);
+    gpio_bus_set(&bus, 0x0103);
+    check_bsrr("gpio_bus_set(0x103)", 0x00000003);
+    gpio_bus_clear(&bus, 0x0106);
+    check_bsrr("gpio_bus_clear(0x106)", 0x00060000);
+    gpio_bus_set_clear(&bus, 0x0001, 0x0008);
+    check_bsrr("gpio_bus_set_clear(0x1, 0x8)", 0x00080001);
+    g_stub_port.ODR = 0x1235;
+    if (gpio_bus_read(&bus) != 0x0005) {
+        error(&g_log, "gpio_bus_read: 0x%04x, expected 0x0005",
+                gpio_bus_read(&bus));
+        g_stub_failures++;
+    }
+
+    info(&g_log, "Stub port failures: %lu", g_stub_failures);
+}
+
+/*
+ * Logs the time taken for TOGGLE_COUNT toggles and the resulting rate.
+ */
+void log_rate(char* name, uint32_t cycles) {
+    uint32_t per_toggle_x10 = (uint32_t) (((uint64_t) cycles * 10) /
+            TOGGLE_COUNT);
+    uint32_t rate = (uint32_t) (((uint64_t) SystemCoreClock * TOGGLE_COUNT) /
+            cycles);
+    info(&g_log, "%s: %lu.%lu cycles/toggle, %lu toggles/s", name,
+            per_toggle_x10 / 10, per_toggle_x10 % 10, rate);
+}
+
+void test_toggle_rate(GPIOOutput* led) {
+    info(&g_log, "Toggling %lu times (core clock %lu Hz)",
+            (uint32_t) TOGGLE_COUNT, SystemCoreClock);
+
+    // Interrupts are disabled so only the toggles are counted
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < TOGGLE_COUNT; i++) {
+        gpio_toggle(led);
+    }
+    uint32_t hal_toggle = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < TOGGLE_COUNT; i++) {
+        gpio_toggle_fast(led);
+    }
+    uint32_t fast_toggle = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < TOGGLE_COUNT / 2; i++) {
+        gpio_set_high(led);
+        gpio_set_low(led);
+    }
+    uint32_t hal_set = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < TOGGLE_COUNT / 2; i++) {
+        gpio_set_high_fast(led);
+        gpio_set_low_fast(led);
+    }
+    uint32_t fast_set = DWT->CYCCNT - start;
+
+    __set_PRIMASK(primask);
+
+    log_rate("gpio_toggle", hal_toggle);
+    log_rate("gpio_toggle_fast", fast_toggle);
+    log_rate("gpio_set_high/low", hal_set);
+    log_rate("gpio_set_high/low_fast", fast_set);
+}
+
+void test_bus(MCU* mcu) {
+    info(&g_log, "Counting on PC0-PC3 bus");
+
+    GPIOBus bus;
+    gpio_bus_init(&bus, mcu, GPIOC, BUS_MASK, GPIO_MODE_OUTPUT_PP,
+            GPIO_NOPULL, 0);
+
+    uint32_t start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < TOGGLE_COUNT; i++) {
+        gpio_bus_write(&bus, (uint16_t) i);
+    }
+    log_rate("gpio_bus_write", DWT->CYCCNT - start);
+
+    // Check the pins actually ended up in the last state written
+    uint16_t expected = (TOGGLE_COUNT - 1) & BUS_MASK;
+    info(&g_log, "Bus state: 0x%x (expected 0x%x)", gpio_bus_read(&bus),
+            expected);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting GPIO fast path test");
+
+    GPIOOutput led;
+    if (board == MCU_BOARD_NUCLEO_H743ZI2) {
+        gpio_output_init(&led, &mcu, H743ZI2_GREEN_LED_PORT,
+                H743ZI2_GREEN_LED_PIN, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL,
+                GPIO_PIN_RESET);
+    } else if (board == MCU_BOARD_NUCLEO_G474RE) {
+        gpio_output_init(&led, &mcu, G474RE_GREEN_LED_PORT,
+                G474RE_GREEN_LED_PIN, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL,
+                GPIO_PIN_RESET);
+    } else {
+        error(&g_log, "Board not supported, ending test function");
+        return -1;
+    }
+
+    // Enables the DWT cycle counter
+    profile_init();
+
+    test_stub_port();
+    test_toggle_rate(&led);
+    test_bus(&mcu);
+
+    info(&g_log, "Done GPIO fast path test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
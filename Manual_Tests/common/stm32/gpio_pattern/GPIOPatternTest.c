@@ -0,0 +1,111 @@
+/*
+ * GPIOPatternTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the GPIO pattern generator on PC0-PC3 (the same on the Nucleo-G474RE
+ * and Nucleo-H743ZI2). Watch the pins with a scope or logic analyzer:
+ * - A 4-bit counter (PC0 is bit 0) at 1 MHz, played 1000 times (16 ms), where
+ *   every step should be exactly 1 us and all pins should change together
+ * - A streamed pattern at 100 kHz where PC0 toggles every word and PC1 every
+ *   100 words, for 50 ms, generated by a callback
+ * - The counter looped forever for 100 ms, then stopped
+ * For each, checks that playback took as long as expected.
+ */
+
+#include <common/stm32/gpio/GPIOPattern.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/uart/Log.h>
+
+#define PATTERN_PINS (GPIO_PIN_0 | GPIO_PIN_1 | GPIO_PIN_2 | GPIO_PIN_3)
+// Words refilled at a time (the buffer is twice this)
+#define HALF_COUNT 256
+// Number of words streamed by stream_fill()
+#define STREAM_COUNT 5000
+
+Clock g_clock;
+Log g_log;
+
+Timer g_timer;
+GPIOPattern g_pattern;
+uint32_t g_buf[HALF_COUNT * 2];
+uint32_t g_counter[16];
+uint32_t g_streamed = 0;
+
+/*
+ * Generates STREAM_COUNT words, toggling PC0 every word and PC1 every 100
+ * words.
+ */
+uint32_t stream_fill(void* context, uint32_t* words, uint32_t count) {
+    uint32_t filled = 0;
+    while (filled < count && g_streamed < STREAM_COUNT) {
+        uint16_t value = (g_streamed & 1) ? GPIO_PIN_0 : 0;
+        if ((g_streamed / 100) & 1) {
+            value |= GPIO_PIN_1;
+        }
+        words[filled] = gpio_pattern_word(value,
+                (GPIO_PIN_0 | GPIO_PIN_1) & ~value);
+        filled++;
+        g_streamed++;
+    }
+    return filled;
+}
+
+void log_duration(char* name, uint64_t start_us, uint32_t expected_us,
+        bool finished) {
+    info(&g_log, "%s: %s in %lu us (expected about %lu us)", name,
+            finished ? "finished" : "timed out",
+            (uint32_t) clock_elapsed_us(start_us), expected_us);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting GPIO pattern test");
+
+    clock_init(&g_clock, TIM2);
+
+    // The rate is set when each pattern starts
+    timer_setup(&g_timer, 0, 0, 0);
+    timer_customize(&g_timer, TIM3, 1, 0, 0);
+    timer_init(&g_timer);
+    gpio_pattern_init(&g_pattern, &mcu, GPIOC, PATTERN_PINS, 0, &g_timer,
+            g_buf, HALF_COUNT);
+
+    for (uint16_t i = 0; i < 16; i++) {
+        g_counter[i] = gpio_pattern_word(i, PATTERN_PINS & ~i);
+    }
+
+    uint64_t start = clock_now_us();
+    uint32_t rate_hz = gpio_pattern_play(&g_pattern, 1000000, g_counter, 16,
+            1000);
+    bool finished = gpio_pattern_wait(&g_pattern, 1000);
+    info(&g_log, "Counter at %lu Hz", rate_hz);
+    log_duration("Counter", start, 16000, finished);
+
+    start = clock_now_us();
+    rate_hz = gpio_pattern_stream(&g_pattern, 100000, stream_fill, NULL);
+    finished = gpio_pattern_wait(&g_pattern, 1000);
+    info(&g_log, "Stream at %lu Hz, %lu words", rate_hz, g_streamed);
+    log_duration("Stream", start, STREAM_COUNT * 10, finished);
+
+    gpio_pattern_play(&g_pattern, 1000000, g_counter, 16, 0);
+    finished = gpio_pattern_wait(&g_pattern, 100);
+    gpio_pattern_stop(&g_pattern);
+    info(&g_log, "Looping forever: %s (expected timed out)",
+            finished ? "finished" : "timed out");
+
+    info(&g_log, "Done GPIO pattern test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
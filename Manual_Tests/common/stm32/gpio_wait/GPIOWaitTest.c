@@ -0,0 +1,85 @@
+/*
+ * GPIOWaitTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests waiting for a pin with gpio_wait_for_state() on the blue button (PC13
+ * on both the Nucleo-G474RE and Nucleo-H743ZI2, high when pressed).
+ *
+ * Waits for the button to be pressed and released a few times, logging the
+ * wake latency and how busy the CPU was while waiting (which should be close
+ * to 0%, since it sleeps until the button's interrupt). Then does the same with
+ * a GPIOITInput also registered on the button, whose callback should still see
+ * every press and release. Each wait times out after 10 s, which should log
+ * a warning.
+ */
+
+#include <common/stm32/gpio/GPIO.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/uart/Log.h>
+
+#define WAIT_COUNT 3
+
+Clock g_clock;
+Log g_log;
+
+// This must be volatile since it is modified inside the ISR callback
+volatile uint32_t g_callback_count = 0;
+
+void count_callback(void* context, uint16_t pin, uint64_t timestamp_us) {
+    g_callback_count++;
+}
+
+void test_waits(GPIOInput* button) {
+    for (uint32_t i = 0; i < WAIT_COUNT; i++) {
+        info(&g_log, "Press the blue button");
+        idle_reset_stats();
+        bool pressed = gpio_wait_for_high(button, 10000);
+        uint32_t load = idle_get_load_percent();
+        if (!pressed) {
+            info(&g_log, "Timed out (CPU load %lu%%)", load);
+            continue;
+        }
+        info(&g_log, "Pressed, wake latency %lu us (CPU load %lu%%)",
+                button->wake_latency_us, load);
+
+        gpio_wait_for_low(button, 10000);
+        info(&g_log, "Released, wake latency %lu us",
+                button->wake_latency_us);
+    }
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting GPIO wait test");
+
+    clock_init(&g_clock, TIM2);
+
+    info(&g_log, "Waiting with a temporary interrupt");
+    GPIOInput button;
+    gpio_input_init(&button, &mcu, GPIOC, GPIO_PIN_13, GPIO_NOPULL);
+    test_waits(&button);
+
+    info(&g_log, "Waiting with an interrupt input on the same pin");
+    GPIOITInput it_button;
+    gpio_it_input_init(&it_button, &mcu, GPIOC, GPIO_PIN_13,
+            GPIO_MODE_IT_RISING_FALLING, GPIO_NOPULL, count_callback, NULL);
+    test_waits(&it_button.input);
+    info(&g_log, "Interrupt input callbacks: %lu (expected %lu)",
+            g_callback_count, (uint32_t) WAIT_COUNT * 2);
+
+    info(&g_log, "Done GPIO wait test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
@@ -0,0 +1,217 @@
+/*
+ * HeapTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the TLSF allocator and the malloc() hooks with the same random
+ * workload (a mix of small and large blocks, allocated and freed in random
+ * order):
+ * - A TLSF pool in a static buffer, checking every block keeps its contents
+ *   and the pool's structure is still consistent at the end
+ * - malloc()/free(), which go to the TLSF heap (or to newlib's allocator if
+ *   HEAP_NEWLIB is defined, to compare the two)
+ * For each, prints the distribution of CPU cycles per call (power of 2
+ * buckets), so the worst case can be compared as well as the average.
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/uart/Log.h>
+#include <common/stm32/util/Heap.h>
+#include <common/stm32/util/Profile.h>
+#include <common/stm32/util/Random.h>
+#include <common/stm32/util/TLSF.h>
+#include <stdlib.h>
+
+// Number of blocks that can be allocated at the same time
+#define SLOT_COUNT 64
+// Number of allocations/frees in each workload
+#define OP_COUNT 20000
+// Number of power of 2 buckets in the latency histograms
+#define HIST_BUCKETS 16
+#define POOL_SIZE (32 * 1024)
+
+typedef struct {
+    uint32_t count;
+    uint32_t total;
+    uint32_t max;
+    uint32_t hist[HIST_BUCKETS];
+} Latency;
+
+typedef void* (*AllocFunc)(size_t size);
+typedef void (*FreeFunc)(void* ptr);
+
+Log g_log;
+
+TLSF g_tlsf;
+uint8_t g_pool[POOL_SIZE] __attribute__((aligned(8)));
+
+void* tlsf_test_malloc(size_t size) {
+    return tlsf_malloc(&g_tlsf, size);
+}
+
+void tlsf_test_free(void* ptr) {
+    tlsf_free(&g_tlsf, ptr);
+}
+
+void latency_record(Latency* latency, uint32_t cycles) {
+    uint32_t bucket = (cycles == 0) ? 0 : (31 - __builtin_clz(cycles));
+    if (bucket >= HIST_BUCKETS) {
+        bucket = HIST_BUCKETS - 1;
+    }
+    latency->hist[bucket]++;
+    latency->count++;
+    latency->total += cycles;
+    if (cycles > latency->max) {
+        latency->max = cycles;
+    }
+}
+
+void latency_print(Latency* latency, char* name) {
+    info(&g_log, "%s: %lu calls, average %lu cycles, max %lu cycles", name,
+            latency->count, latency->total / latency->count, latency->max);
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        if (latency->hist[i] > 0) {
+            info(&g_log, "    %lu-%lu cycles: %lu", 1UL << i,
+                    (2UL << i) - 1, latency->hist[i]);
+        }
+    }
+}
+
+/*
+ * Runs the workload and returns the number of blocks that were corrupted
+ * (did not keep the pattern they were filled with).
+ */
+uint32_t run_workload(Random* random, AllocFunc alloc_func,
+        FreeFunc free_func, Latency* alloc_latency, Latency* free_latency,
+        uint32_t* failures) {
+    uint8_t* blocks[SLOT_COUNT] = {NULL};
+    uint32_t sizes[SLOT_COUNT] = {0};
+    uint32_t corrupted = 0;
+    *failures = 0;
+
+    for (uint32_t op = 0; op < OP_COUNT + SLOT_COUNT; op++) {
+        // At the end, free everything that is left
+        uint32_t slot = (op < OP_COUNT) ?
+                random_next_bounded(random, SLOT_COUNT) : op - OP_COUNT;
+
+        if (blocks[slot] != NULL) {
+            for (uint32_t i = 0; i < sizes[slot]; i++) {
+                if (blocks[slot][i] != (uint8_t) slot) {
+                    corrupted++;
+                    break;
+                }
+            }
+            uint32_t start = profile_now();
+            free_func(blocks[slot]);
+            latency_record(free_latency, profile_now() - start);
+            blocks[slot] = NULL;
+        } else if (op < OP_COUNT) {
+            // Mostly small blocks (like libc's), with some large buffers
+            uint32_t size = (random_next_bounded(random, 8) == 0) ?
+                    1 + random_next_bounded(random, 2048) :
+                    1 + random_next_bounded(random, 96);
+            uint32_t start = profile_now();
+            uint8_t* block = alloc_func(size);
+            latency_record(alloc_latency, profile_now() - start);
+            if (block == NULL) {
+                (*failures)++;
+                continue;
+            }
+            memset(block, (uint8_t) slot, size);
+            blocks[slot] = block;
+            sizes[slot] = size;
+        }
+    }
+    return corrupted;
+}
+
+void test_tlsf(Random* random) {
+    info(&g_log, "TLSF pool of %lu bytes", (uint32_t) POOL_SIZE);
+    tlsf_init(&g_tlsf, g_pool, sizeof(g_pool));
+
+    Latency alloc_latency = {0};
+    Latency free_latency = {0};
+    uint32_t failures;
+    uint32_t corrupted = run_workload(random, tlsf_test_malloc,
+            tlsf_test_free, &alloc_latency, &free_latency, &failures);
+    latency_print(&alloc_latency, "tlsf_malloc()");
+    latency_print(&free_latency, "tlsf_free()");
+
+    TLSFStats stats;
+    tlsf_get_stats(&g_tlsf, &stats);
+    info(&g_log, "Corrupted: %lu (expected 0), failed: %lu, check: %u "
+            "(expected 1)", corrupted, failures, tlsf_check(&g_tlsf));
+    info(&g_log, "Used: %lu (expected 0), peak: %lu, largest free: %lu, "
+            "free blocks: %lu (expected 1)", (uint32_t) stats.used_bytes,
+            (uint32_t) stats.peak_used_bytes, (uint32_t) stats.largest_free,
+            stats.free_blocks);
+
+    // The largest request should succeed, and one more byte should not (it
+    // rounds up past the only free block's list)
+    void* too_large = tlsf_malloc(&g_tlsf, stats.largest_request + 1);
+    tlsf_free(&g_tlsf, too_large);
+    void* largest = tlsf_malloc(&g_tlsf, stats.largest_request);
+    info(&g_log, "Largest request: %lu, allocated: %u (expected 1), one more "
+            "byte allocated: %u (expected 0)", (uint32_t) stats.largest_request,
+            largest != NULL, too_large != NULL);
+    tlsf_free(&g_tlsf, largest);
+}
+
+void test_malloc(Random* random) {
+#if defined(HEAP_NEWLIB)
+    info(&g_log, "malloc() (newlib)");
+#else
+    info(&g_log, "malloc() (TLSF heap)");
+#endif
+
+    Latency alloc_latency = {0};
+    Latency free_latency = {0};
+    uint32_t failures;
+    uint32_t corrupted = run_workload(random, malloc, free, &alloc_latency,
+            &free_latency, &failures);
+    latency_print(&alloc_latency, "malloc()");
+    latency_print(&free_latency, "free()");
+    info(&g_log, "Corrupted: %lu (expected 0), failed: %lu", corrupted,
+            failures);
+
+#if !defined(HEAP_NEWLIB)
+    TLSFStats stats;
+    heap_get_stats(&stats);
+    info(&g_log, "Heap: %lu bytes, used: %lu, peak: %lu, allocs: %lu, "
+            "frees: %lu, failures: %lu, check: %u (expected 1)",
+            (uint32_t) stats.pool_bytes, (uint32_t) stats.used_bytes,
+            (uint32_t) stats.peak_used_bytes, stats.allocs, stats.frees,
+            stats.failures, heap_check());
+#endif
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting heap test");
+    // Formatting a float allocates inside vsnprintf()
+    info(&g_log, "Float through the heap: %f (expected 3.140000)", 3.14f);
+
+    profile_init();
+    Random random;
+    random_init(&random, &uart);
+    random_set_seed(&random, 1);
+
+    test_tlsf(&random);
+    // Same sequence of operations for both
+    random_set_seed(&random, 1);
+    test_malloc(&random);
+
+    info(&g_log, "Done heap test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
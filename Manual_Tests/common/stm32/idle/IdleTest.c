@@ -0,0 +1,109 @@
+/*
+ * IdleTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests idle sleeping: that idle_sleep_until() wakes up on time, that
+ * idle_sleep_until_cond() returns as soon as an interrupt makes its condition
+ * true (long before the deadline), that HAL_GetTick() stays in step with the
+ * clock while the SysTick is stopped during long sleeps, and that the idle time
+ * accounting reports a low load while sleeping and a high load while
+ * busy-waiting.
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/uart/Log.h>
+
+Clock g_clock;
+Log g_log;
+
+volatile bool g_alarm_fired = false;
+
+void alarm_cb(void* context) {
+    g_alarm_fired = true;
+}
+
+bool alarm_fired(void* context) {
+    return g_alarm_fired;
+}
+
+/*
+ * Logs the stats since the last reset.
+ */
+void log_stats(char* name) {
+    IdleStats stats;
+    idle_get_stats(&stats);
+    info(&g_log, "%s: %lu us total, %lu us idle, %lu sleeps (%lu tickless), "
+            "load %lu%%", name, (uint32_t) stats.total_us,
+            (uint32_t) stats.idle_us, stats.sleeps, stats.tickless_sleeps,
+            idle_get_load_percent());
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting idle test");
+
+    clock_init(&g_clock, TIM2);
+
+    // Wakeup accuracy for short (ticked) and long (tickless) sleeps
+    uint32_t sleeps_us[] = {100, 1000, 5000, 50000, 500000};
+    for (uint32_t i = 0; i < sizeof(sleeps_us) / sizeof(sleeps_us[0]); i++) {
+        uint64_t start_us = clock_now_us();
+        uint64_t deadline = start_us + sleeps_us[i];
+        uint32_t wakeups = 0;
+        while (!clock_deadline_passed(deadline)) {
+            idle_sleep_until(deadline);
+            wakeups++;
+        }
+        info(&g_log, "Sleep %lu us: took %lu us, %lu wakeups", sleeps_us[i],
+                (uint32_t) clock_elapsed_us(start_us), wakeups);
+    }
+
+    // Should return right after the alarm (5000 us), not at the deadline
+    for (uint32_t i = 0; i < 3; i++) {
+        g_alarm_fired = false;
+        uint64_t start_us = clock_now_us();
+        clock_set_alarm(start_us + 5000, alarm_cb, NULL);
+        bool done = idle_sleep_until_cond(start_us + 1000000, alarm_fired,
+                NULL);
+        info(&g_log, "Sleep until alarm: returned %u (expected 1) after %lu us "
+                "(expected about 5000)", done,
+                (uint32_t) clock_elapsed_us(start_us));
+    }
+
+    // HAL_GetTick() should advance by the same amount as the clock, even
+    // though the SysTick interrupt is off for most of this
+    uint32_t start_ms = HAL_GetTick();
+    uint64_t start_us = clock_now_us();
+    for (uint32_t i = 0; i < 100; i++) {
+        idle_sleep_until(clock_deadline_us(9700));
+    }
+    info(&g_log, "100 tickless sleeps: HAL_GetTick() %lu ms, clock %lu ms",
+            HAL_GetTick() - start_ms, (uint32_t) (clock_elapsed_us(start_us) /
+            1000));
+
+    // Mostly sleeping
+    idle_reset_stats();
+    HAL_Delay(1000);
+    log_stats("HAL_Delay(1000)");
+
+    // Busy
+    idle_reset_stats();
+    clock_delay_us(1000000);
+    log_stats("clock_delay_us(1000000)");
+
+    info(&g_log, "Done idle test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * GPIOLogicAnalyzerTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the logic analyzer by capturing a PWM signal. Connect PA6 (TIM3
+ * channel 1, PWM output) to PB6 with a jumper wire (these pins are the same on
+ * the Nucleo-G474RE and Nucleo-H743ZI2).
+ *
+ * Captures a 100 kHz, 25% duty signal at 4 MHz, triggering on a rising edge of
+ * PB6 with 64 samples before the trigger, and sends the capture over the UART.
+ * The capture should show runs of about 10 samples high (0040) and 30 samples
+ * low (0000), with the first high run starting exactly 64 samples in. Then
+ * checks that arming with no signal times out.
+ */
+
+#include <common/stm32/gpio/GPIOLogicAnalyzer.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/timer/PWM.h>
+#include <common/stm32/uart/Log.h>
+
+// Samples per capture (the buffer is twice this)
+#define CAPTURE_COUNT 1024
+#define SAMPLE_RATE_HZ 4000000
+#define PRE_TRIGGER_COUNT 64
+
+Clock g_clock;
+Log g_log;
+
+Timer g_pwm_timer;
+PWM g_pwm;
+Timer g_sample_timer;
+GPIOLogicAnalyzer g_analyzer;
+uint16_t g_buf[CAPTURE_COUNT * 2];
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting logic analyzer test");
+
+    clock_init(&g_clock, TIM2);
+
+    // PWM on TIM3 channel 1
+    timer_setup(&g_pwm_timer, 0, 0xFFFF, 0);
+    timer_customize(&g_pwm_timer, TIM3, 1, 0, 0);
+    timer_init(&g_pwm_timer);
+    pwm_init(&g_pwm, &g_pwm_timer, TIM_CHANNEL_1, &mcu, GPIOA, GPIO_PIN_6,
+            GPIO_AF2_TIM3);
+
+    // The sample rate is set by gpio_logic_analyzer_arm()
+    timer_setup(&g_sample_timer, 0, 0, 0);
+    timer_customize(&g_sample_timer, TIM4, 1, 0, 0);
+    timer_init(&g_sample_timer);
+    gpio_logic_analyzer_init(&g_analyzer, &mcu, GPIOB, GPIO_PIN_6,
+            GPIO_NOPULL, &g_sample_timer, g_buf, CAPTURE_COUNT);
+
+    pwm_set_freq(&g_pwm, 100000);
+    pwm_set_duty(&g_pwm, 25.0f);
+    pwm_start(&g_pwm);
+
+    uint32_t rate_hz = gpio_logic_analyzer_arm(&g_analyzer, SAMPLE_RATE_HZ,
+            GPIO_PIN_6, GPIO_LOGIC_ANALYZER_RISING, PRE_TRIGGER_COUNT);
+    info(&g_log, "Armed at %lu Hz", rate_hz);
+    if (gpio_logic_analyzer_wait(&g_analyzer, 1000)) {
+        info(&g_log, "Captured %lu samples, %lu before trigger (expected "
+                "%lu, %lu)", g_analyzer.capture_count,
+                g_analyzer.capture_pre_count, (uint32_t) CAPTURE_COUNT,
+                (uint32_t) PRE_TRIGGER_COUNT);
+        uint32_t runs = gpio_logic_analyzer_send(&g_analyzer, &uart);
+        info(&g_log, "Sent %lu runs (expected about %lu)", runs,
+                (uint32_t) (CAPTURE_COUNT * 2 / 40));
+    } else {
+        error(&g_log, "Capture timed out");
+    }
+    pwm_stop(&g_pwm);
+
+    // Nothing to trigger on now
+    gpio_logic_analyzer_arm(&g_analyzer, SAMPLE_RATE_HZ, GPIO_PIN_6,
+            GPIO_LOGIC_ANALYZER_BOTH, PRE_TRIGGER_COUNT);
+    bool done = gpio_logic_analyzer_wait(&g_analyzer, 100);
+    gpio_logic_analyzer_cancel(&g_analyzer);
+    info(&g_log, "Capture with no signal: %s (expected timed out)",
+            done ? "done" : "timed out");
+
+    info(&g_log, "Done logic analyzer test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
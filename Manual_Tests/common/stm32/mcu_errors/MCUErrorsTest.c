@@ -7,6 +7,7 @@
  * Produces various errors in the HAL and in our code for testing.
  */
 
+#include <common/stm32/mcu/Idle.h>
 #include <common/stm32/mcu/errors.h>
 #include <common/stm32/uart/log.h>
 #include <stdlib.h>
@@ -62,7 +63,9 @@ int main() {
     uint32_t value = *ptr;	// This line should fail
     info(&log, "0x%lx", value);	// Should never reach this line
 
-    while (1) {}
+    while (1) {
+        idle_sleep();
+    }
 
     return 0;
 }
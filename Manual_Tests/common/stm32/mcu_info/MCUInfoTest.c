@@ -8,6 +8,7 @@
  * (from our mapping).
  */
 
+#include <common/stm32/mcu/Idle.h>
 #include <common/stm32/uart/log.h>
 
 int main() {
@@ -40,7 +41,9 @@ int main() {
     info(&log, "Model: 0x%lx", mcu_get_model_for_board(mcu_get_board()));
 
     info(&log, "Done MCU info test");
-    while (1) {}
+    while (1) {
+        idle_sleep();
+    }
 
     return 0;
 }
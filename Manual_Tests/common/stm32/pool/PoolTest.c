@@ -0,0 +1,233 @@
+/*
+ * PoolTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the fixed-block pool:
+ * - Allocates every block, checks they are all different and the next
+ *   allocation fails, then frees them and checks the stats
+ * - Allocates and frees blocks as fast as possible in the main loop while a
+ *   20 kHz timer interrupt (TIM6) does the same on the same pool, tagging
+ *   each block with its owner while it is held, and checks no block is ever
+ *   handed to both at once
+ * - Prints the stats of the UART and Log pools
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/timer/Timer.h>
+#include <common/stm32/uart/Log.h>
+#include <common/stm32/util/Pool.h>
+#include <common/stm32/util/Profile.h>
+
+#define FRAME_COUNT 8
+#define FRAME_DATA_SIZE 60
+#define ISR_HZ 20000
+// Tags written into blocks while they are held
+#define TAG_MAIN 0x4D41494E
+#define TAG_ISR 0x49535220
+
+typedef struct {
+    // Overwritten by the pool's free list link while the block is free
+    uint32_t seq;
+    // Owner's tag while held, 0 while free
+    uint32_t tag;
+    uint8_t data[FRAME_DATA_SIZE];
+} Frame;
+
+Clock g_clock;
+Log g_log;
+
+Pool g_frame_pool;
+uint8_t g_frame_blocks[FRAME_COUNT][POOL_BLOCK_SIZE(sizeof(Frame))]
+        __attribute__((aligned(4)));
+
+Timer g_timer;
+// Block the ISR holds from one interrupt to the next (NULL if none)
+Frame* g_isr_frame = NULL;
+volatile uint32_t g_isr_count = 0;
+volatile uint32_t g_isr_corrupted = 0;
+volatile uint32_t g_isr_failures = 0;
+
+/*
+ * Checks a frame still has its owner's tag, then clears it before freeing.
+ */
+bool frame_release(Frame* frame, uint32_t tag) {
+    bool ok = (frame->tag == tag);
+    frame->tag = 0;
+    pool_free(&g_frame_pool, frame);
+    return ok;
+}
+
+void timer_irq_handler(Timer* timer) {
+    TIM_TypeDef* instance = timer->handle.Instance;
+    if ((instance->SR & TIM_SR_UIF) == 0) {
+        return;
+    }
+    instance->SR = ~((uint32_t) TIM_SR_UIF);
+    g_isr_count++;
+
+    // Alternate between taking a block and giving it back, so the ISR holds
+    // one for half of the time
+    if (g_isr_frame != NULL) {
+        if (!frame_release(g_isr_frame, TAG_ISR)) {
+            g_isr_corrupted++;
+        }
+        g_isr_frame = NULL;
+    } else {
+        Frame* frame = pool_alloc(&g_frame_pool);
+        if (frame == NULL) {
+            g_isr_failures++;
+            return;
+        }
+        if (frame->tag != 0) {
+            g_isr_corrupted++;
+        }
+        frame->tag = TAG_ISR;
+        g_isr_frame = frame;
+    }
+}
+
+void test_basic(void) {
+    info(&g_log, "Allocating all %lu blocks", (uint32_t) FRAME_COUNT);
+    pool_init(&g_frame_pool, g_frame_blocks, sizeof(g_frame_blocks[0]),
+            FRAME_COUNT);
+
+    Frame* frames[FRAME_COUNT];
+    uint32_t duplicates = 0;
+    for (uint32_t i = 0; i < FRAME_COUNT; i++) {
+        frames[i] = pool_alloc(&g_frame_pool);
+        for (uint32_t j = 0; j < i; j++) {
+            if (frames[j] == frames[i]) {
+                duplicates++;
+            }
+        }
+    }
+    uint32_t nulls = 0;
+    for (uint32_t i = 0; i < FRAME_COUNT; i++) {
+        nulls += (frames[i] == NULL);
+    }
+    void* extra = pool_alloc(&g_frame_pool);
+    info(&g_log, "NULL blocks: %lu (expected 0), duplicates: %lu (expected 0), "
+            "extra block: %s (expected NULL)", nulls, duplicates,
+            (extra == NULL) ? "NULL" : "not NULL");
+
+    uint32_t start = profile_now();
+    for (uint32_t i = 0; i < FRAME_COUNT; i++) {
+        frames[i]->tag = 0;
+        pool_free(&g_frame_pool, frames[i]);
+    }
+    uint32_t free_cycles = profile_now() - start;
+
+    info(&g_log, "In use: %lu (expected 0), peak: %lu (expected %lu), "
+            "failures: %lu (expected 1)", g_frame_pool.in_use,
+            g_frame_pool.peak_in_use, (uint32_t) FRAME_COUNT,
+            g_frame_pool.failures);
+    info(&g_log, "Free: %lu cycles/block", free_cycles / FRAME_COUNT);
+}
+
+void test_isr(void) {
+    info(&g_log, "Allocating in the main loop and a %lu Hz interrupt for 1 s",
+            (uint32_t) ISR_HZ);
+    pool_init(&g_frame_pool, g_frame_blocks, sizeof(g_frame_blocks[0]),
+            FRAME_COUNT);
+
+    timer_setup(&g_timer, 0, 0, 1);
+    timer_customize(&g_timer, TIM6, 1, 0, 0);
+    g_timer.irq_handler = timer_irq_handler;
+    timer_setup_hz(&g_timer, ISR_HZ);
+    timer_init(&g_timer);
+    timer_start(&g_timer);
+
+    // Hold up to FRAME_COUNT - 1 blocks at a time, so the pool sometimes runs
+    // out when the ISR also has one
+    Frame* held[FRAME_COUNT - 1] = {NULL};
+    uint32_t ops = 0;
+    uint32_t corrupted = 0;
+    uint32_t failures = 0;
+    uint32_t alloc_cycles = 0;
+    uint32_t allocs = 0;
+
+    uint64_t deadline = clock_deadline_ms(1000);
+    while (!clock_deadline_passed(deadline)) {
+        uint32_t slot = ops % (FRAME_COUNT - 1);
+        if (held[slot] != NULL) {
+            if (!frame_release(held[slot], TAG_MAIN)) {
+                corrupted++;
+            }
+            held[slot] = NULL;
+        } else {
+            uint32_t start = profile_now();
+            Frame* frame = pool_alloc(&g_frame_pool);
+            alloc_cycles += profile_now() - start;
+            allocs++;
+            if (frame == NULL) {
+                failures++;
+            } else {
+                if (frame->tag != 0) {
+                    corrupted++;
+                }
+                frame->tag = TAG_MAIN;
+                frame->seq = ops;
+                held[slot] = frame;
+            }
+        }
+        ops++;
+    }
+    timer_stop(&g_timer);
+
+    for (uint32_t i = 0; i < FRAME_COUNT - 1; i++) {
+        if (held[i] != NULL && !frame_release(held[i], TAG_MAIN)) {
+            corrupted++;
+        }
+    }
+    if (g_isr_frame != NULL && !frame_release(g_isr_frame, TAG_ISR)) {
+        corrupted++;
+    }
+
+    info(&g_log, "Main: %lu operations, %lu failed allocations, %lu "
+            "corrupted (expected 0)", ops, failures, corrupted);
+    info(&g_log, "ISR: %lu interrupts, %lu failed allocations, %lu corrupted "
+            "(expected 0)", g_isr_count, g_isr_failures, g_isr_corrupted);
+    info(&g_log, "In use: %lu (expected 0), peak: %lu, failures: %lu",
+            g_frame_pool.in_use, g_frame_pool.peak_in_use,
+            g_frame_pool.failures);
+    if (allocs > 0) {
+        info(&g_log, "Average allocation: %lu cycles", alloc_cycles / allocs);
+    }
+}
+
+void print_pool(char* name, Pool* pool) {
+    info(&g_log, "%s: %lu blocks of %lu bytes, in use: %lu, peak: %lu, "
+            "failures: %lu", name, pool->count, pool->block_size,
+            pool->in_use, pool->peak_in_use, pool->failures);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting pool test");
+
+    profile_init();
+    clock_init(&g_clock, TIM2);
+
+    test_basic();
+    test_isr();
+
+    print_pool("UART TX", &g_uart_tx_pool);
+    print_pool("UART RX", &g_uart_rx_pool);
+    print_pool("Log", &g_log_pool);
+
+    info(&g_log, "Done pool test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * ProfileTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the profiler by timing a few known delays, logging, and the clock's
+ * timer interrupt, then dumping the report. Build with PROFILE=ON (e.g.
+ * `make clean && make compile TEST=... MCU=... PROFILE=ON`), otherwise the
+ * zones are compiled out and the report is empty.
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/uart/Log.h>
+#include <common/stm32/util/Profile.h>
+
+Clock g_clock;
+Log g_log;
+
+/*
+ * Busy-waits for a number of us inside its own zone, so the zone's times
+ * should be about delay_us * SystemCoreClock / 1000000 cycles.
+ */
+void delay_zone(uint32_t delay_us) {
+    PROFILE_BEGIN(delay_zone);
+    clock_delay_us(delay_us);
+    PROFILE_END(delay_zone);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting profile test");
+
+#ifndef PROFILE_ENABLED
+    warning(&g_log, "PROFILE_ENABLED is not defined, zones are compiled out");
+#endif
+
+    profile_init();
+    clock_init(&g_clock, TIM2);
+
+    // Cost of an empty zone
+    for (uint32_t i = 0; i < 1000; i++) {
+        PROFILE_BEGIN(empty);
+        PROFILE_END(empty);
+    }
+
+    // 1, 10 and 100 us (so the histogram has three buckets)
+    for (uint32_t i = 0; i < 100; i++) {
+        delay_zone(1);
+        delay_zone(10);
+        delay_zone(100);
+    }
+    info(&g_log, "Expected delay_zone times: about %lu, %lu and %lu cycles",
+            SystemCoreClock / 1000000, SystemCoreClock / 100000,
+            SystemCoreClock / 10000);
+
+    // Log messages (log_log and uart_write_dma zones)
+    for (uint32_t i = 0; i < 10; i++) {
+        info(&g_log, "Log message %lu", i);
+    }
+
+    // Wait for at least one clock alarm interrupt (timer_irq zone)
+    clock_set_alarm(clock_now_us() + 1000, NULL, NULL);
+    HAL_Delay(10);
+
+    profile_dump(&g_log);
+
+    info(&g_log, "Done profile test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
@@ -0,0 +1,144 @@
+/*
+ * PWMCaptureTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests PWM output and input capture together by measuring a PWM signal with
+ * input capture. Connect PA6 (TIM3 channel 1, PWM output) to PB6 (TIM4
+ * channel 1, input capture) with a jumper wire (these pins are the same on the
+ * Nucleo-G474RE and Nucleo-H743ZI2).
+ *
+ * For a few frequencies and duty cycles, captures both edges of the PWM signal
+ * and checks the measured period and high time against what was set.
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/InputCapture.h>
+#include <common/stm32/timer/PWM.h>
+#include <common/stm32/uart/Log.h>
+
+// Number of edges to capture for each measurement
+#define EDGE_COUNT 64
+
+Log g_log;
+
+Timer g_pwm_timer;
+PWM g_pwm;
+Timer g_capture_timer;
+InputCapture g_capture;
+uint32_t g_ring[EDGE_COUNT * 2];
+
+/*
+ * Measures the PWM signal with the given settings and logs the average period
+ * and high time, in timer ticks and ns.
+ */
+void measure(uint32_t freq_hz, float duty_percent) {
+    uint32_t actual_hz = pwm_set_freq(&g_pwm, freq_hz);
+    pwm_set_duty(&g_pwm, duty_percent);
+    pwm_start(&g_pwm);
+    HAL_Delay(10);
+
+    input_capture_start(&g_capture);
+    while (input_capture_available(&g_capture) < EDGE_COUNT) {
+    }
+    input_capture_stop(&g_capture);
+    pwm_stop(&g_pwm);
+
+    // Timestamps alternate between rising and falling edges, but which one
+    // came first depends on when capturing started
+    uint32_t timestamps[EDGE_COUNT];
+    for (uint32_t i = 0; i < EDGE_COUNT; i++) {
+        input_capture_read(&g_capture, &timestamps[i]);
+    }
+
+    // Sum the time between alternate edges (periods), and between each edge
+    // and the next (alternating high and low times)
+    uint64_t period_sum = 0;
+    uint64_t even_sum = 0;
+    uint64_t odd_sum = 0;
+    uint32_t periods = 0;
+    for (uint32_t i = 0; i + 2 < EDGE_COUNT; i += 2) {
+        period_sum += input_capture_ticks_between(&g_capture, timestamps[i],
+                timestamps[i + 2]);
+        even_sum += input_capture_ticks_between(&g_capture, timestamps[i],
+                timestamps[i + 1]);
+        odd_sum += input_capture_ticks_between(&g_capture, timestamps[i + 1],
+                timestamps[i + 2]);
+        periods++;
+    }
+    uint32_t tick_freq = input_capture_get_tick_freq(&g_capture);
+    uint32_t period_ticks = (uint32_t) (period_sum / periods);
+    // Either the even or odd intervals are the high time, the one that
+    // matches the duty cycle best is assumed to be
+    uint32_t expected_high_ticks = (uint32_t) ((period_ticks * duty_percent)
+            / 100.0f);
+    uint32_t even_ticks = (uint32_t) (even_sum / periods);
+    uint32_t odd_ticks = (uint32_t) (odd_sum / periods);
+    uint32_t high_ticks = (even_ticks > expected_high_ticks ?
+            even_ticks - expected_high_ticks :
+            expected_high_ticks - even_ticks) <
+            (odd_ticks > expected_high_ticks ?
+            odd_ticks - expected_high_ticks :
+            expected_high_ticks - odd_ticks) ? even_ticks : odd_ticks;
+
+    info(&g_log, "Set %lu Hz (actual %lu Hz), %lu%% duty", freq_hz, actual_hz,
+            (uint32_t) duty_percent);
+    info(&g_log, "Measured period: %lu ticks (%lu ns, expected %lu ns)",
+            period_ticks,
+            (uint32_t) (((uint64_t) period_ticks * 1000000000) / tick_freq),
+            1000000000 / actual_hz);
+    info(&g_log, "Measured high time: %lu ticks (%lu ns), %lu.%lu%% duty",
+            high_ticks,
+            (uint32_t) (((uint64_t) high_ticks * 1000000000) / tick_freq),
+            (high_ticks * 100) / period_ticks,
+            ((high_ticks * 1000) / period_ticks) % 10);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting PWM and input capture test");
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+
+    // PWM on TIM3 channel 1, the frequency is set by pwm_set_freq()
+    timer_setup(&g_pwm_timer, 0, 0xFFFF, 0);
+    timer_customize(&g_pwm_timer, TIM3, 1, 0, 0);
+    timer_init(&g_pwm_timer);
+    pwm_init(&g_pwm, &g_pwm_timer, TIM_CHANNEL_1, &mcu, GPIOA, GPIO_PIN_6,
+            GPIO_AF2_TIM3);
+
+    // Input capture on TIM4 channel 1, counting at the full timer clock over
+    // the full 16-bit range, so periods up to 65535 ticks (over 2.5 kHz) can be
+    // measured
+    timer_setup(&g_capture_timer, 0, 0xFFFF, 0);
+    timer_customize(&g_capture_timer, TIM4, 1, 0, 0);
+    timer_init(&g_capture_timer);
+    input_capture_init(&g_capture, &g_capture_timer, TIM_CHANNEL_1,
+            TIM_INPUTCHANNELPOLARITY_BOTHEDGE, 0, &mcu, GPIOB, GPIO_PIN_6,
+            GPIO_AF2_TIM4, GPIO_NOPULL, g_ring,
+            sizeof(g_ring) / sizeof(g_ring[0]));
+    info(&g_log, "Capture resolution: %lu Hz",
+            input_capture_get_tick_freq(&g_capture));
+
+    measure(10000, 25.0f);
+    measure(10000, 50.0f);
+    measure(50000, 10.0f);
+    measure(100000, 75.0f);
+    measure(5000, 90.0f);
+
+    input_capture_deinit(&g_capture);
+    info(&g_log, "Done PWM and input capture test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
@@ -7,7 +7,62 @@
  * Generates random numbers using functionality from our random library.
  */
 
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/util/Profile.h>
 #include <common/stm32/util/random.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Number of values to generate for each benchmark
+#define BENCHMARK_COUNT 1000000
+
+// Results are XORed into this so the compiler can't optimize the loops away
+volatile uint32_t g_sink = 0;
+
+// Number of values per batch for the bulk fill benchmarks
+#define BATCH_COUNT 1000
+uint32_t g_batch_u32[BATCH_COUNT];
+float g_batch_f32[BATCH_COUNT];
+
+// Number of buckets and values for the chi-square tests
+#define CHI_SQUARE_BUCKETS 10
+#define CHI_SQUARE_COUNT 100000
+// Critical value of the chi-square distribution with 9 degrees of freedom
+// (buckets - 1) at a 1% significance level
+// If the statistic is above this, there is less than a 1% chance the values
+// came from a uniform distribution
+#define CHI_SQUARE_CRITICAL_9_DOF 21.666f
+
+/*
+ * Calculates the chi-square statistic for the bucket counts, assuming every
+ * bucket is equally likely, and logs whether it passes.
+ */
+void log_chi_square(Log* log, char* name, uint32_t* counts) {
+    float expected = (float) CHI_SQUARE_COUNT / CHI_SQUARE_BUCKETS;
+    float chi_square = 0.0f;
+    for (uint32_t i = 0; i < CHI_SQUARE_BUCKETS; i++) {
+        float diff = (float) counts[i] - expected;
+        chi_square += (diff * diff) / expected;
+    }
+    info(log, "%s chi-square: %f (%s, critical value %f)", name, chi_square,
+            (chi_square < CHI_SQUARE_CRITICAL_9_DOF) ? "PASS" : "FAIL",
+            CHI_SQUARE_CRITICAL_9_DOF);
+}
+
+/*
+ * Logs how many numbers per second were generated, given the time it took to
+ * generate BENCHMARK_COUNT numbers.
+ */
+void log_rate(Log* log, char* name, uint32_t start_ms, uint32_t end_ms) {
+    uint32_t elapsed_ms = end_ms - start_ms;
+    if (elapsed_ms == 0) {
+        elapsed_ms = 1;
+    }
+    info(log, "%s: %lu numbers in %lu ms (%lu numbers/s)", name,
+            (uint32_t) BENCHMARK_COUNT, elapsed_ms,
+            (uint32_t) (((uint64_t) BENCHMARK_COUNT * 1000) / elapsed_ms));
+}
 
 int main() {
     // Try to automatically detect board based on MCU UID
@@ -53,13 +108,149 @@ int main() {
         info(&log, "0x%lX", random_get_uint32(&random));
     }
 
+    info(&log, "float values:");
+    for (uint32_t i = 0; i < 20; i++) {
+        info(&log, "%f", random_get_float(&random, -3.0f, 5.5f));
+    }
+
     info(&log, "double values:");
     for (uint32_t i = 0; i < 20; i++) {
         info(&log, "%lf", random_get_double(&random, -3.0, 5.5));
     }
 
+    // Take true random numbers from the entropy pool, which should have filled
+    // up in the background by now
+    info(&log, "Hardware entropy pool:");
+    uint32_t entropy[RANDOM_HW_POOL_SIZE + 4];
+    uint32_t entropy_count = random_get_hw_entropy(&random, entropy,
+            sizeof(entropy) / sizeof(entropy[0]));
+    info(&log, "Got %lu values (pool size %lu)", entropy_count,
+            (uint32_t) RANDOM_HW_POOL_SIZE);
+    for (uint32_t i = 0; i < entropy_count; i++) {
+        info(&log, "0x%.8lX", entropy[i]);
+    }
+    // Give the pool time to refill, then check it has values again
+    HAL_Delay(1);
+    entropy_count = random_get_hw_entropy(&random, entropy, 4);
+    info(&log, "Got %lu values after refilling", entropy_count);
+    info(&log, "RNG errors: %lu", random_get_hw_error_count(&random));
+    info(&log, "RNG health test failures: %lu",
+            random_get_hw_health_failure_count(&random));
+
+    // Check the values are uniformly distributed by putting them into buckets
+    info(&log, "Chi-square tests (%lu values, %lu buckets):",
+            (uint32_t) CHI_SQUARE_COUNT, (uint32_t) CHI_SQUARE_BUCKETS);
+    uint32_t counts[CHI_SQUARE_BUCKETS] = {0};
+    for (uint32_t i = 0; i < CHI_SQUARE_COUNT; i++) {
+        counts[random_get_uint(&random, 0, CHI_SQUARE_BUCKETS - 1)]++;
+    }
+    log_chi_square(&log, "uint", counts);
+
+    memset(counts, 0, sizeof(counts));
+    for (uint32_t i = 0; i < CHI_SQUARE_COUNT; i++) {
+        float value = random_get_float(&random, 0.0f, CHI_SQUARE_BUCKETS);
+        counts[(uint32_t) value]++;
+    }
+    log_chi_square(&log, "float", counts);
+
+    memset(counts, 0, sizeof(counts));
+    for (uint32_t i = 0; i < CHI_SQUARE_COUNT; i++) {
+        double value = random_get_double(&random, 0.0, CHI_SQUARE_BUCKETS);
+        counts[(uint32_t) value]++;
+    }
+    log_chi_square(&log, "double", counts);
+
+    // Compare generation speed against the C library's rand(), which we used
+    // to use (only 31 bits per number)
+    info(&log, "Benchmarks:");
+    uint32_t start = HAL_GetTick();
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++) {
+        g_sink ^= random_next(&random);
+    }
+    log_rate(&log, "random_next()", start, HAL_GetTick());
+
+    srand(seed);
+    start = HAL_GetTick();
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++) {
+        g_sink ^= rand();
+    }
+    log_rate(&log, "rand()", start, HAL_GetTick());
+
+    // Average number of CPU cycles per call (including the log level check
+    // each function does)
+    profile_init();
+    uint32_t start_cycles = profile_now();
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++) {
+        g_sink ^= random_get_uint(&random, 1, 10);
+    }
+    info(&log, "random_get_uint(): %lu cycles/call",
+            (profile_now() - start_cycles) / BENCHMARK_COUNT);
+
+    start_cycles = profile_now();
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++) {
+        g_sink ^= (uint32_t) random_get_float(&random, -3.0f, 5.5f);
+    }
+    info(&log, "random_get_float(): %lu cycles/call",
+            (profile_now() - start_cycles) / BENCHMARK_COUNT);
+
+    start_cycles = profile_now();
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++) {
+        g_sink ^= (uint32_t) random_get_double(&random, -3.0, 5.5);
+    }
+    info(&log, "random_get_double(): %lu cycles/call",
+            (profile_now() - start_cycles) / BENCHMARK_COUNT);
+
+    // Compare the bulk fill functions against calling the single-value
+    // functions once per element
+    info(&log, "Bulk fill benchmarks (%lu values per batch):",
+            (uint32_t) BATCH_COUNT);
+    start_cycles = profile_now();
+    for (uint32_t i = 0; i < BATCH_COUNT; i++) {
+        g_batch_u32[i] = random_get_uint32(&random);
+    }
+    info(&log, "random_get_uint32() per element: %lu cycles/value",
+            (profile_now() - start_cycles) / BATCH_COUNT);
+
+    start_cycles = profile_now();
+    random_fill_u32(&random, g_batch_u32, BATCH_COUNT);
+    info(&log, "random_fill_u32(): %lu cycles/value",
+            (profile_now() - start_cycles) / BATCH_COUNT);
+
+    start_cycles = profile_now();
+    for (uint32_t i = 0; i < BATCH_COUNT; i++) {
+        g_batch_f32[i] = random_get_float(&random, -1.0f, 1.0f);
+    }
+    info(&log, "random_get_float() per element: %lu cycles/value",
+            (profile_now() - start_cycles) / BATCH_COUNT);
+
+    start_cycles = profile_now();
+    random_fill_uniform_f32(&random, g_batch_f32, BATCH_COUNT, -1.0f, 1.0f);
+    info(&log, "random_fill_uniform_f32(): %lu cycles/value",
+            (profile_now() - start_cycles) / BATCH_COUNT);
+
+    // The first call calculates the ziggurat tables, so don't time it
+    random_fill_normal_f32(&random, g_batch_f32, 1, 0.0f, 1.0f);
+    start_cycles = profile_now();
+    random_fill_normal_f32(&random, g_batch_f32, BATCH_COUNT, 2.0f, 0.5f);
+    info(&log, "random_fill_normal_f32(): %lu cycles/value",
+            (profile_now() - start_cycles) / BATCH_COUNT);
+
+    // The sample mean and standard deviation should be close to 2.0 and 0.5
+    float sum = 0.0f;
+    float sum_squares = 0.0f;
+    for (uint32_t i = 0; i < BATCH_COUNT; i++) {
+        sum += g_batch_f32[i];
+        sum_squares += g_batch_f32[i] * g_batch_f32[i];
+    }
+    float mean = sum / BATCH_COUNT;
+    float variance = (sum_squares / BATCH_COUNT) - (mean * mean);
+    info(&log, "Normal values: mean %f, std dev %f (expected 2.0, 0.5)",
+            mean, sqrtf(variance));
+
     info(&log, "Done random test");
-    while (1) {}
+    while (1) {
+        idle_sleep();
+    }
 
     return 0;
 }
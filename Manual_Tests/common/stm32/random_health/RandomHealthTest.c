@@ -0,0 +1,111 @@
+/*
+ * RandomHealthTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Feeds simulated entropy sources into the continuous RNG health tests and
+ * checks that bad sources are detected while a good source passes.
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/util/Random.h>
+
+// Number of 32-bit words to generate from each simulated source
+#define WORD_COUNT 100000
+
+// Incremented by the failure callback
+uint32_t g_callback_count = 0;
+
+void count_failure(void* context, RandomHealthTest test) {
+    g_callback_count++;
+}
+
+/*
+ * Simulates a source that is stuck on one value.
+ */
+uint32_t stuck_source(Random* random) {
+    return 0xA5A5A5A5;
+}
+
+/*
+ * Simulates a source with a strong bias, where each byte is 0 a quarter of the
+ * time and uniformly random otherwise.
+ */
+uint32_t biased_source(Random* random) {
+    uint32_t word = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+        uint32_t byte = random_next(random) & 0xFF;
+        if (random_next(random) < 0x40000000) {
+            byte = 0;
+        }
+        word |= byte << (i * 8);
+    }
+    return word;
+}
+
+/*
+ * Simulates a good source using the PRNG.
+ */
+uint32_t good_source(Random* random) {
+    return random_next(random);
+}
+
+void test_source(Log* log, Random* random, char* name,
+        uint32_t (*source)(Random*), bool expect_failure) {
+    RandomHealth health;
+    random_health_init(&health);
+    random_health_set_failure_cb(&health, count_failure, NULL);
+    g_callback_count = 0;
+
+    uint32_t failed_words = 0;
+    for (uint32_t i = 0; i < WORD_COUNT; i++) {
+        if (!random_health_check_word(&health, source(random))) {
+            failed_words++;
+        }
+    }
+
+    bool detected = (health.rct_failures + health.apt_failures) > 0;
+    info(log, "%s source: %lu samples, %lu RCT failures, %lu APT failures, "
+            "%lu failed words, %lu callbacks (%s)", name, health.samples,
+            health.rct_failures, health.apt_failures, failed_words,
+            g_callback_count, (detected == expect_failure) ? "PASS" : "FAIL");
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    Log log;
+    log_init(&log, &uart);
+
+    info(&log, "Starting random health test");
+
+    Random random;
+    random_init(&random, &uart);
+
+    test_source(&log, &random, "Good", good_source, false);
+    test_source(&log, &random, "Stuck", stuck_source, true);
+    test_source(&log, &random, "Biased", biased_source, true);
+
+    // Let the RNG peripheral refill the entropy pool a few times, then check
+    // the health of the real source
+    uint32_t entropy[RANDOM_HW_POOL_SIZE];
+    for (uint32_t i = 0; i < 100; i++) {
+        HAL_Delay(1);
+        random_get_hw_entropy(&random, entropy, RANDOM_HW_POOL_SIZE);
+    }
+    info(&log, "RNG peripheral: %lu samples, %lu RCT failures, "
+            "%lu APT failures", random.health.samples,
+            random.health.rct_failures, random.health.apt_failures);
+
+    info(&log, "Done random health test");
+    while (1) {
+        idle_sleep();
+    }
+
+    return 0;
+}
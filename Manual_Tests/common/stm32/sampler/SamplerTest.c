@@ -0,0 +1,106 @@
+/*
+ * SamplerTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the timer-triggered DMA sampler by sampling GPIOA's input register at
+ * SAMPLE_RATE_HZ for 1 second (timed with the clock), checking the number of
+ * halves the callback got matches the sample rate, that no DMA errors
+ * happened, and how much CPU time the callbacks took.
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/timer/Sampler.h>
+#include <common/stm32/uart/Log.h>
+#include <common/stm32/util/Profile.h>
+
+#define SAMPLE_RATE_HZ 100000
+// Samples per half of the buffer (a callback every 10 ms)
+#define HALF_COUNT 1000
+
+Clock g_clock;
+Log g_log;
+
+Timer g_timer;
+Sampler g_sampler;
+uint16_t g_buf[HALF_COUNT * 2];
+
+// Number of callbacks, samples received and CPU cycles spent in callbacks
+volatile uint32_t g_callbacks = 0;
+volatile uint32_t g_samples = 0;
+volatile uint32_t g_callback_cycles = 0;
+// Count of samples with PA0 high, so the callback does some work per sample
+volatile uint32_t g_high = 0;
+
+void half_done(void* context, void* half, uint32_t count) {
+    uint32_t start_cycles = profile_now();
+    uint16_t* samples = (uint16_t*) half;
+    uint32_t high = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        high += samples[i] & 0x1;
+    }
+    g_high += high;
+    g_samples += count;
+    g_callbacks++;
+    g_callback_cycles += profile_now() - start_cycles;
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting sampler test");
+
+    profile_init();
+    clock_init(&g_clock, TIM2);
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+
+    // TIM3 counting up, updating SAMPLE_RATE_HZ times per second (no
+    // interrupts, the DMA handles each update)
+    timer_setup(&g_timer, 0, 0, 0);
+    timer_customize(&g_timer, TIM3, 1, 0, 0);
+    uint32_t rate_hz = timer_setup_hz(&g_timer, SAMPLE_RATE_HZ);
+    if (timer_init(&g_timer) != HAL_OK) {
+        error(&g_log, "Failed to initialize timer");
+        return -1;
+    }
+    info(&g_log, "Sample rate: %lu Hz, prescaler: %lu, period: %lu", rate_hz,
+            g_timer.handle.Init.Prescaler, g_timer.handle.Init.Period);
+
+    sampler_init(&g_sampler, &g_timer, TIM_DMA_UPDATE, &GPIOA->IDR,
+            SAMPLER_PERIPH_TO_MEMORY, sizeof(g_buf[0]), g_buf, HALF_COUNT,
+            half_done, NULL);
+
+    uint64_t start_us = clock_now_us();
+    sampler_start(&g_sampler);
+    clock_delay_us(1000000);
+    sampler_stop(&g_sampler);
+    uint32_t elapsed_us = (uint32_t) clock_elapsed_us(start_us);
+
+    uint32_t expected = (uint32_t) (((uint64_t) elapsed_us * SAMPLE_RATE_HZ)
+            / 1000000);
+    info(&g_log, "Elapsed: %lu us, samples: %lu (expected about %lu)",
+            elapsed_us, g_samples, expected);
+    info(&g_log, "Halves: %lu, callbacks: %lu, DMA errors: %lu",
+            g_sampler.halves_done, g_callbacks, g_sampler.errors);
+    info(&g_log, "PA0 high in %lu samples", g_high);
+    if (g_callbacks > 0) {
+        info(&g_log, "Callback: %lu cycles/half, %lu cycles/sample",
+                g_callback_cycles / g_callbacks,
+                g_callback_cycles / g_samples);
+    }
+    sampler_deinit(&g_sampler);
+
+    info(&g_log, "Done sampler test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
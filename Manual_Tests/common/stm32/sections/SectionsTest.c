@@ -0,0 +1,232 @@
+/*
+ * SectionsTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the memory placement attributes in Sections.h:
+ * - Checks FAST_DATA is initialized, FAST_BSS and DMA_BUFFER are zeroed, and
+ *   that a NOINIT counter keeps counting through resets (press the reset
+ *   button a few times)
+ * - Prints where each kind of variable and function ended up
+ * - Benchmarks the same loop run from flash and from FAST_CODE, over data in
+ *   regular RAM, FAST_BSS and DMA_BUFFER, and prints each against the flash
+ *   and RAM baseline
+ * - Benchmarks the log formatting (FAST_CODE) and the EXTI interrupt latency
+ *   (FAST_CODE dispatch with FAST_BSS tables). Build once normally and once
+ *   with SECTIONS_DISABLED defined to compare these with everything in flash
+ *   and AXI SRAM.
+ *
+ * On the G474 the attributes do nothing, so all times should be about the same.
+ */
+
+#include <common/stm32/gpio/GPIOEdgeQueue.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/uart/Log.h>
+#include <common/stm32/util/Profile.h>
+#include <common/stm32/util/StrBuf.h>
+
+// Number of words summed by each benchmark
+#define BENCH_WORDS 1024
+// Number of times each benchmark is run (the fastest run is reported)
+#define BENCH_RUNS 10
+// Marks g_noinit_count as set up
+#define NOINIT_MAGIC 0x5EC71045
+
+Clock g_clock;
+Log g_log;
+
+GPIOITInput g_input;
+GPIOEdgeQueue g_queue;
+
+FAST_DATA uint32_t g_fast_data = 0x12345678;
+FAST_BSS uint32_t g_fast_bss[BENCH_WORDS];
+DMA_BUFFER uint32_t g_dma_buf[BENCH_WORDS];
+uint32_t g_ram_buf[BENCH_WORDS];
+
+NOINIT uint32_t g_noinit_magic;
+NOINIT uint32_t g_noinit_count;
+
+/*
+ * Mixes all the words together (enough work per word that the loop is not
+ * just load/store bound).
+ */
+static inline __attribute__((always_inline)) uint32_t mix_words(
+        uint32_t* words, uint32_t count) {
+    uint32_t hash = 2166136261;
+    for (uint32_t i = 0; i < count; i++) {
+        hash = (hash ^ words[i]) * 16777619;
+    }
+    return hash;
+}
+
+__attribute__((noinline)) uint32_t mix_words_flash(uint32_t* words,
+        uint32_t count) {
+    return mix_words(words, count);
+}
+
+FAST_CODE uint32_t mix_words_fast(uint32_t* words, uint32_t count) {
+    return mix_words(words, count);
+}
+
+/*
+ * Returns the fewest cycles a mix function took over BENCH_RUNS runs.
+ */
+uint32_t bench_mix(uint32_t (*mix)(uint32_t*, uint32_t), uint32_t* words,
+        uint32_t* result) {
+    uint32_t best = UINT32_MAX;
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+        uint32_t start = profile_now();
+        *result = mix(words, BENCH_WORDS);
+        uint32_t cycles = profile_now() - start;
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+    return best;
+}
+
+void test_init(void) {
+    info(&g_log, "FAST_DATA: 0x%08lX (expected 0x12345678)", g_fast_data);
+
+    uint32_t nonzero = 0;
+    for (uint32_t i = 0; i < BENCH_WORDS; i++) {
+        if (g_fast_bss[i] != 0 || g_dma_buf[i] != 0) {
+            nonzero++;
+        }
+    }
+    info(&g_log, "Non-zero FAST_BSS/DMA_BUFFER words: %lu (expected 0)",
+            nonzero);
+
+    if (g_noinit_magic != NOINIT_MAGIC) {
+        g_noinit_magic = NOINIT_MAGIC;
+        g_noinit_count = 0;
+    }
+    g_noinit_count++;
+    info(&g_log, "NOINIT boot count: %lu (should go up by 1 on each reset)",
+            g_noinit_count);
+}
+
+void test_addresses(void) {
+    info(&g_log, "FAST_CODE function: 0x%08lX",
+            (uint32_t) mix_words_fast);
+    info(&g_log, "Flash function: 0x%08lX", (uint32_t) mix_words_flash);
+    info(&g_log, "FAST_DATA: 0x%08lX", (uint32_t) &g_fast_data);
+    info(&g_log, "FAST_BSS: 0x%08lX", (uint32_t) g_fast_bss);
+    info(&g_log, "DMA_BUFFER: 0x%08lX", (uint32_t) g_dma_buf);
+    info(&g_log, "RAM: 0x%08lX", (uint32_t) g_ram_buf);
+    info(&g_log, "NOINIT: 0x%08lX", (uint32_t) &g_noinit_count);
+}
+
+void test_mix(void) {
+    for (uint32_t i = 0; i < BENCH_WORDS; i++) {
+        g_ram_buf[i] = i * 2654435761u;
+        g_fast_bss[i] = g_ram_buf[i];
+        g_dma_buf[i] = g_ram_buf[i];
+    }
+
+    info(&g_log, "Mixing %lu words (cycles, fastest of %lu runs)",
+            (uint32_t) BENCH_WORDS, (uint32_t) BENCH_RUNS);
+
+    uint32_t (*mixes[])(uint32_t*, uint32_t) = {
+        mix_words_flash, mix_words_fast,
+    };
+    char* mix_names[] = {"flash", "FAST_CODE"};
+    uint32_t* bufs[] = {g_ram_buf, g_fast_bss, g_dma_buf};
+    char* buf_names[] = {"RAM", "FAST_BSS", "DMA_BUFFER"};
+
+    uint32_t expected = mix_words_flash(g_ram_buf, BENCH_WORDS);
+    uint32_t cycles[2][3];
+    for (uint32_t m = 0; m < 2; m++) {
+        for (uint32_t b = 0; b < 3; b++) {
+            uint32_t result;
+            cycles[m][b] = bench_mix(mixes[m], bufs[b], &result);
+            info(&g_log, "Code in %s, data in %s: %lu%s", mix_names[m],
+                    buf_names[b], cycles[m][b],
+                    (result == expected) ? "" : " (WRONG RESULT)");
+        }
+    }
+
+    // Before/after for moving the code into FAST_CODE, and the data out of
+    // regular RAM, relative to the flash and RAM baseline
+    uint32_t baseline = cycles[0][0];
+    for (uint32_t m = 0; m < 2; m++) {
+        for (uint32_t b = 0; b < 3; b++) {
+            uint32_t speedup = (cycles[m][b] == 0) ? 0 :
+                    (uint32_t) ((uint64_t) baseline * 100 / cycles[m][b]);
+            info(&g_log, "flash/RAM -> %s/%s: %lu -> %lu cycles (%lu.%02lux)",
+                    mix_names[m], buf_names[b], baseline, cycles[m][b],
+                    speedup / 100, speedup % 100);
+        }
+    }
+}
+
+void test_log_format(void) {
+    // Same formatting as log_log() and log_write_msg(), without sending
+    char msg[UART_TX_BUF_SIZE];
+    char line[UART_TX_BUF_SIZE];
+    StrBuf msg_sb;
+    StrBuf line_sb;
+
+    uint32_t best = UINT32_MAX;
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+        uint32_t start = profile_now();
+        strbuf_init(&msg_sb, msg, sizeof(msg));
+        strbuf_appendf(&msg_sb, "Reading %lu: %lu mV (%s)", run, 3300 - run,
+                "ok");
+        strbuf_init(&line_sb, line, sizeof(line));
+        strbuf_append_u32(&line_sb, HAL_GetTick());
+        strbuf_append(&line_sb, "ms: ");
+        strbuf_append(&line_sb, "INFO");
+        strbuf_append(&line_sb, ": ");
+        strbuf_append(&line_sb, msg);
+        strbuf_append(&line_sb, "\r\n");
+        uint32_t cycles = profile_now() - start;
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+    info(&g_log, "Log line formatting: %lu cycles", best);
+}
+
+void test_exti_latency(MCU* mcu) {
+    // Software triggers, so nothing needs to be connected to the pin
+    gpio_edge_queue_init(&g_queue);
+    gpio_edge_queue_add_input(&g_queue, &g_input, mcu, GPIOB, GPIO_PIN_6,
+            GPIO_MODE_IT_RISING_FALLING, GPIO_NOPULL);
+    uint32_t latency = gpio_edge_queue_measure_latency(&g_queue, GPIO_PIN_6,
+            1000);
+    info(&g_log, "Max EXTI interrupt latency: %lu cycles", latency);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting sections test");
+#if defined(SECTIONS_DISABLED)
+    info(&g_log, "SECTIONS_DISABLED is defined");
+#endif
+
+    profile_init();
+    clock_init(&g_clock, TIM2);
+
+    test_init();
+    test_addresses();
+    test_mix();
+    test_log_format();
+    test_exti_latency(&mcu);
+
+    info(&g_log, "Done sections test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
@@ -0,0 +1,134 @@
+/*
+ * StackTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the stack measurements in Stack.h:
+ * - Prints the high-water mark after startup, then checks it goes up by about
+ *   the expected amount when a recursive function uses more of the stack
+ * - Measures how much stack an error log (the Error_Handler() path) uses
+ * - Runs a 10 kHz timer interrupt (TIM6) while the main loop recurses, and
+ *   prints the report, where timer_irq should show a deeper max depth than
+ *   the main loop alone
+ * - Enables the MPU guard and overflows the stack on purpose, which should
+ *   log a stack overflow error and halt (instead of corrupting the heap)
+ */
+
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/mcu/Stack.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/timer/Timer.h>
+#include <common/stm32/uart/Log.h>
+
+// Bytes of locals in each call of recurse()
+#define FRAME_BYTES 64
+#define RECURSE_DEPTH 6
+#define ISR_HZ 10000
+
+Clock g_clock;
+Log g_log;
+Timer g_timer;
+
+/*
+ * Uses at least FRAME_BYTES of stack per level of recursion.
+ */
+__attribute__((noinline)) uint32_t recurse(uint32_t depth) {
+    volatile uint8_t buf[FRAME_BYTES];
+    buf[0] = (uint8_t) depth;
+    buf[FRAME_BYTES - 1] = (uint8_t) depth;
+    if (depth == 0) {
+        return buf[0];
+    }
+    return recurse(depth - 1) + buf[FRAME_BYTES - 1];
+}
+
+/*
+ * Recurses until the stack overflows (never returns).
+ */
+__attribute__((noinline)) uint32_t recurse_forever(uint32_t depth) {
+    volatile uint8_t buf[FRAME_BYTES];
+    buf[0] = (uint8_t) depth;
+    return recurse_forever(depth + 1) + buf[0];
+}
+
+void timer_irq_handler(Timer* timer) {
+    TIM_TypeDef* instance = timer->handle.Instance;
+    instance->SR = ~((uint32_t) TIM_SR_UIF);
+}
+
+void test_high_water(void) {
+    info(&g_log, "Stack: %lu bytes, using %lu, most used since reset: %lu",
+            stack_get_size(), stack_get_used(), stack_high_water());
+
+    stack_repaint();
+    uint32_t before = stack_high_water();
+    recurse(RECURSE_DEPTH);
+    uint32_t after = stack_high_water();
+    info(&g_log, "Recursing %lu levels: most used went from %lu to %lu "
+            "(expected at least %lu more)", (uint32_t) RECURSE_DEPTH, before,
+            after, (uint32_t) ((RECURSE_DEPTH + 1) * FRAME_BYTES));
+
+    stack_repaint();
+    before = stack_high_water();
+    Error_Handler();
+    after = stack_high_water();
+    info(&g_log, "Error_Handler() used %lu bytes of stack (the error above is "
+            "expected)", after - before);
+}
+
+void test_isr(void) {
+    info(&g_log, "Recursing with a %lu Hz interrupt for 1 s",
+            (uint32_t) ISR_HZ);
+
+    timer_setup(&g_timer, 0, 0, 1);
+    timer_customize(&g_timer, TIM6, 1, 0, 0);
+    g_timer.irq_handler = timer_irq_handler;
+    timer_setup_hz(&g_timer, ISR_HZ);
+    timer_init(&g_timer);
+
+    stack_reset_isrs();
+    stack_repaint();
+    timer_start(&g_timer);
+    uint64_t deadline = clock_deadline_ms(1000);
+    while (!clock_deadline_passed(deadline)) {
+        recurse(RECURSE_DEPTH);
+    }
+    timer_stop(&g_timer);
+
+    stack_dump(&g_log);
+}
+
+void test_guard(void) {
+    stack_guard_enable();
+    info(&g_log, "Guard enabled: %u (expected 1), overflowing the stack "
+            "(expected a stack overflow error, then nothing else)",
+            stack_guard_is_enabled());
+    recurse_forever(0);
+    info(&g_log, "FAILED: still running after overflowing the stack");
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting stack test");
+
+    clock_init(&g_clock, TIM2);
+
+    test_high_water();
+    test_isr();
+    test_guard();
+
+    info(&g_log, "Done stack test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
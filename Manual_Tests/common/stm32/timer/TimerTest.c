@@ -8,6 +8,7 @@ Manual test for timer wrapper code. Uses callback to light up LED on timeout.
 */
 
 #include <common/stm32/gpio/GPIO.h>
+#include <common/stm32/mcu/Idle.h>
 #include <common/stm32/timer/Timer.h>
 #include <common/stm32/uart/Log.h>
 #include <nucleo_g474re/G474REConfig.h>
@@ -16,12 +17,6 @@ Manual test for timer wrapper code. Uses callback to light up LED on timeout.
 // Used to toggle LED
 GPIOOutput g_test_led;
 Log g_log;
-Timer g_timer;
-
-// Passes interrupts from TIM5 to interrupt handler
-void TIM5_IRQHandler() {
-    HAL_TIM_IRQHandler(&(g_timer.handle));
-}
 
 // Timer callback function to toggle LED after timer runs out
 void toggle_led(TIM_HandleTypeDef *htim) {
@@ -66,28 +61,35 @@ int main() {
         return -1;
     }
 
-    // APB1 clock runs at 240 MHz for TIM5, scaling to 4 Hz
+    // The prescaler and period for 4 Hz are calculated from the clock tree
+    // The timer library handles the TIM5 interrupt and passes it to this
+    // timer, so it only needs to stay valid for as long as it is running
     info(&g_log, "Enabling timer");
-    timer_setup(&g_timer, 7999, 7499, 1);
-    HAL_StatusTypeDef status = timer_init(&g_timer);
+    Timer timer;
+    timer_setup(&timer, 0, 0, 1);
+    uint32_t freq_hz = timer_setup_hz(&timer, 4);
+    info(&g_log, "Timer frequency: %lu Hz (prescaler %lu, period %lu)",
+            freq_hz, timer.handle.Init.Prescaler, timer.handle.Init.Period);
+    HAL_StatusTypeDef status = timer_init(&timer);
     if(status != HAL_OK) {
         error(&g_log, "Encountered HAL status %d while initializing timer", status);
         return -1;
     }
-    status = timer_setup_callback(&g_timer, toggle_led);
+    status = timer_setup_callback(&timer, toggle_led);
     if(status != HAL_OK) {
         error(&g_log, "Encountered HAL status %d during timer callback registration", status);
         return -1;
     }
 
     info(&g_log, "Starting timer");
-    status = timer_start(&g_timer);
+    status = timer_start(&timer);
     if(status != HAL_OK) {
         error(&g_log, "Encountered HAL status %d during timer startup", status);
         return -1;
     }
 
-    while(1){
+    while (1) {
+        idle_sleep();
     }
 
     return 0;
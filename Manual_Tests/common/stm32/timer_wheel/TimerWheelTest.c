@@ -0,0 +1,205 @@
+/*
+ * TimerWheelTest.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Tests the timer wheel in two parts:
+ * - A manually advanced wheel with TIMER_COUNT random one-shot timers active
+ *   at once, checking each one expires at exactly the right tick (and none are
+ *   lost when some are cancelled), and measuring the CPU cycles per start,
+ *   cancel and expiry
+ * - A manually advanced wheel with a periodic timer that falls several
+ *   periods behind, checking the missed expiries are skipped (one callback,
+ *   not one per missed period) and the next expiry stays on the period's grid
+ * - A wheel running on the clock with a few periodic and one-shot timers,
+ *   checking how many times each callback ran in 1 second
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/timer/TimerWheel.h>
+#include <common/stm32/util/Profile.h>
+#include <common/stm32/util/Random.h>
+
+// Number of timers active at the same time in the manual wheel test
+#define TIMER_COUNT 1000
+
+Clock g_clock;
+Log g_log;
+
+TimerWheel g_manual_wheel;
+TimerWheelEntry g_entries[TIMER_COUNT];
+// Number of timers that expired, and how many did not expire at their expiry
+uint32_t g_expired = 0;
+uint32_t g_wrong_time = 0;
+
+// Period (in ticks) of the timer in the overrun test
+#define OVERRUN_PERIOD 10
+// How far the overrun test stalls past the first expiry
+#define OVERRUN_STALL 1000
+
+TimerWheelEntry g_overrun_entry;
+volatile uint32_t g_overrun_count = 0;
+
+TimerWheel g_clock_wheel;
+TimerWheelEntry g_1ms_entry;
+TimerWheelEntry g_10ms_entry;
+TimerWheelEntry g_250ms_entry;
+TimerWheelEntry g_oneshot_entry;
+volatile uint32_t g_1ms_count = 0;
+volatile uint32_t g_10ms_count = 0;
+volatile uint32_t g_250ms_count = 0;
+volatile uint32_t g_oneshot_count = 0;
+
+/*
+ * Callback for the manual wheel test. Checks that the timer expired at the
+ * tick it was set for (while a one-shot timer's callback runs, the wheel's
+ * base is the tick being processed).
+ */
+void manual_expired(void* context) {
+    TimerWheelEntry* entry = (TimerWheelEntry*) context;
+    g_expired++;
+    if (entry->expiry != g_manual_wheel.base) {
+        g_wrong_time++;
+    }
+}
+
+void count_callback(void* context) {
+    (*((volatile uint32_t*) context))++;
+}
+
+void test_manual_wheel(Random* random) {
+    info(&g_log, "Manual wheel with %lu timers", (uint32_t) TIMER_COUNT);
+
+    // Start near a 32-bit boundary so expiries carry into the upper bits
+    timer_wheel_init_manual(&g_manual_wheel, 0xFFFF0000);
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        timer_wheel_entry_init(&g_entries[i], manual_expired, &g_entries[i]);
+    }
+
+    // Mix of short and long delays so all levels of the wheel are used
+    uint32_t start_cycles = profile_now();
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        uint32_t max_delay = 0xFFFFFFFF >> random_get_uint(random, 0, 26);
+        timer_wheel_start_oneshot(&g_manual_wheel, &g_entries[i],
+                random_get_uint(random, 0, max_delay));
+    }
+    uint32_t start_total = profile_now() - start_cycles;
+
+    // Cancel every 10th timer
+    uint32_t cancelled = 0;
+    start_cycles = profile_now();
+    for (uint32_t i = 0; i < TIMER_COUNT; i += 10) {
+        timer_wheel_cancel(&g_manual_wheel, &g_entries[i]);
+        cancelled++;
+    }
+    uint32_t cancel_total = profile_now() - start_cycles;
+
+    // Advance straight to each event in turn, as the clock's alarm would
+    uint32_t advances = 0;
+    uint64_t time;
+    start_cycles = profile_now();
+    while (timer_wheel_next_event(&g_manual_wheel, &time)) {
+        timer_wheel_advance(&g_manual_wheel, time);
+        advances++;
+    }
+    uint32_t expire_total = profile_now() - start_cycles;
+
+    info(&g_log, "Expired: %lu (expected %lu), at wrong time: %lu, "
+            "still active: %lu", g_expired, TIMER_COUNT - cancelled,
+            g_wrong_time, g_manual_wheel.count);
+    info(&g_log, "Start: %lu cycles/timer", start_total / TIMER_COUNT);
+    info(&g_log, "Cancel: %lu cycles/timer", cancel_total / cancelled);
+    info(&g_log, "Expire: %lu cycles/timer (%lu advances, including "
+            "cascades)", expire_total / g_expired, advances);
+}
+
+void test_periodic_overrun(void) {
+    info(&g_log, "Periodic timer (every %lu ticks) stalled for %lu ticks",
+            (uint32_t) OVERRUN_PERIOD, (uint32_t) OVERRUN_STALL);
+
+    timer_wheel_init_manual(&g_manual_wheel, 0);
+    timer_wheel_entry_init(&g_overrun_entry, count_callback,
+            (void*) &g_overrun_count);
+    timer_wheel_start_periodic(&g_manual_wheel, &g_overrun_entry,
+            OVERRUN_PERIOD);
+
+    timer_wheel_advance(&g_manual_wheel, OVERRUN_PERIOD);
+    uint32_t on_time = g_overrun_count;
+
+    // Stall for many periods, then catch up in one advance
+    g_overrun_count = 0;
+    timer_wheel_advance(&g_manual_wheel, OVERRUN_PERIOD + OVERRUN_STALL);
+    uint32_t after_stall = g_overrun_count;
+    uint64_t next = g_overrun_entry.expiry;
+
+    g_overrun_count = 0;
+    timer_wheel_advance(&g_manual_wheel, next);
+    uint32_t after_next = g_overrun_count;
+
+    timer_wheel_cancel(&g_manual_wheel, &g_overrun_entry);
+
+    info(&g_log, "On time: %lu (expected 1), after stall: %lu (expected 1), "
+            "at next expiry: %lu (expected 1)", on_time, after_stall,
+            after_next);
+    info(&g_log, "Next expiry after stall: %lu (expected %lu)",
+            (uint32_t) next,
+            (uint32_t) (OVERRUN_PERIOD + OVERRUN_STALL + OVERRUN_PERIOD));
+}
+
+void test_clock_wheel(void) {
+    info(&g_log, "Clock wheel");
+
+    timer_wheel_init(&g_clock_wheel);
+    timer_wheel_entry_init(&g_1ms_entry, count_callback, (void*) &g_1ms_count);
+    timer_wheel_entry_init(&g_10ms_entry, count_callback,
+            (void*) &g_10ms_count);
+    timer_wheel_entry_init(&g_250ms_entry, count_callback,
+            (void*) &g_250ms_count);
+    timer_wheel_entry_init(&g_oneshot_entry, count_callback,
+            (void*) &g_oneshot_count);
+
+    timer_wheel_start_periodic(&g_clock_wheel, &g_1ms_entry, 1000);
+    timer_wheel_start_periodic(&g_clock_wheel, &g_10ms_entry, 10000);
+    timer_wheel_start_periodic(&g_clock_wheel, &g_250ms_entry, 250000);
+    timer_wheel_start_oneshot(&g_clock_wheel, &g_oneshot_entry, 500000);
+
+    clock_delay_us(1000500);
+
+    timer_wheel_cancel(&g_clock_wheel, &g_1ms_entry);
+    timer_wheel_cancel(&g_clock_wheel, &g_10ms_entry);
+    timer_wheel_cancel(&g_clock_wheel, &g_250ms_entry);
+
+    info(&g_log, "1 ms: %lu (expected 1000)", g_1ms_count);
+    info(&g_log, "10 ms: %lu (expected 100)", g_10ms_count);
+    info(&g_log, "250 ms: %lu (expected 4)", g_250ms_count);
+    info(&g_log, "One-shot: %lu (expected 1)", g_oneshot_count);
+}
+
+int main() {
+    // Try to automatically detect board based on MCU UID
+    MCUBoard board = mcu_get_board();
+
+    MCU mcu;
+    mcu_init(&mcu, board);
+    UART uart;
+    uart_init_for_board(&uart, &mcu);
+    log_init(&g_log, &uart);
+
+    info(&g_log, "Starting timer wheel test");
+
+    Random random;
+    random_init(&random, &uart);
+    profile_init();
+    clock_init(&g_clock, TIM2);
+
+    test_manual_wheel(&random);
+    test_periodic_overrun();
+    test_clock_wheel();
+
+    info(&g_log, "Done timer wheel test");
+
+    while (1) {
+        idle_sleep();
+    }
+}
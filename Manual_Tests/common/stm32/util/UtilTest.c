@@ -7,7 +7,9 @@
  * Tests miscellaneous utility functions (e.g. bit/byte manipulation).
  */
 
+#include <common/stm32/mcu/Idle.h>
 #include <common/stm32/uart/log.h>
+#include <common/stm32/util/StrBuf.h>
 #include <common/stm32/util/util.h>
 
 int main() {
@@ -60,8 +62,23 @@ int main() {
     info(&log, "deserialize_le_bytes({0xAF, 0x23, 0xB9}, 3) = 0x%lX",
             deserialize_le_bytes(bytes4, 3));	// 0xB923AF
 
+    char str[16];
+    StrBuf sb;
+    strbuf_init(&sb, str, sizeof(str));
+    strbuf_append(&sb, "t=");
+    strbuf_append_u32(&sb, 4294967295);
+    strbuf_append_char(&sb, ' ');
+    strbuf_append_hex(&sb, 0xA, 2);
+    info(&log, "StrBuf: \"%s\", len = %u, truncated = %u",
+            str, sb.len, sb.truncated);  // "t=4294967295 0A", 15, 0
+    strbuf_appendf(&sb, "%d", 7);
+    info(&log, "StrBuf: \"%s\", len = %u, truncated = %u",
+            str, sb.len, sb.truncated);  // "t=4294967295 0A", 15, 1
+
     info(&log, "Done utilities test");
-    while (1) {}
+    while (1) {
+        idle_sleep();
+    }
 
     return 0;
 }
@@ -8,13 +8,16 @@
  * pressed.
  */
 
+#include <common/stm32/mcu/Idle.h>
 #include <nucleo_h743zi2/h743zi2.h>
 
-// This must be volatile since it is modified inside the ISR callback
+// These must be volatile since they are modified inside the ISR callback
 volatile bool received = false;
+volatile uint64_t received_time_us = 0;
 
-void callback(void) {
-    received = true;
+void callback(void* context, uint16_t pin, uint64_t timestamp_us) {
+    *((volatile bool*) context) = true;
+    received_time_us = timestamp_us;
 }
 
 int main() {
@@ -29,13 +32,17 @@ int main() {
     // Use rising mode because the input signal is low by default (when the
     // button is not pressed)
     gpio_it_input_init(&interrupt, &dk.mcu, dk.blue_button.port,
-            dk.blue_button.pin, GPIO_MODE_IT_RISING, GPIO_NOPULL, callback);
+            dk.blue_button.pin, GPIO_MODE_IT_RISING, GPIO_NOPULL, callback,
+            (void*) &received);
 
     while (1) {
         if (received) {
-            info(&dk.log, "Received interrupt");
+            info(&dk.log, "Received interrupt at %lu ms",
+                    (uint32_t) (received_time_us / 1000));
             received = false;
         }
+        // The button's interrupt wakes this up
+        idle_sleep();
     }
 
     return 0;
@@ -44,8 +44,13 @@
 #define COMMON_STM32_GPIO_GPIO_H_
 
 #include <common/stm32/gpio/GPIOAltFunc.h>
+#include <common/stm32/gpio/GPIOBus.h>
+#include <common/stm32/gpio/GPIODebouncer.h>
+#include <common/stm32/gpio/GPIOEdgeQueue.h>
 #include <common/stm32/gpio/GPIOInput.h>
 #include <common/stm32/gpio/GPIOITInput.h>
+#include <common/stm32/gpio/GPIOLogicAnalyzer.h>
 #include <common/stm32/gpio/GPIOOutput.h>
+#include <common/stm32/gpio/GPIOPattern.h>
 
 #endif /* COMMON_STM32_GPIO_GPIO_H_ */
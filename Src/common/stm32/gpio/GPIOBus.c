@@ -0,0 +1,44 @@
+/*
+ * GPIOBus.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * A group of output pins on one port that are written together (e.g. a
+ * parallel data bus or several chip selects). Writes use the port's BSRR, which
+ * sets and clears any combination of pins in one store, so all the pins change
+ * at once and pins outside the bus are never touched (see GPIOBus.h).
+ */
+
+#include <common/stm32/gpio/GPIOBus.h>
+
+/*
+Initialize several pins on one port as outputs
+@param GPIOBus* bus - the bus struct to initialize
+@param MCU* mcu - initialized MCU struct
+@param GPIO_TypeDef* port - the gpio port the pins are on
+@param uint16_t mask - the pins in the bus (e.g. GPIO_PIN_0 | GPIO_PIN_1)
+@param uint32_t mode - output mode; must be GPIO_MODE_OUTPUT_PP (push-pull) or
+                       GPIO_MODE_OUTPUT_OD (open-drain)
+@param uint32_t pull - the internal pull-up/down gpio resistor state (see
+                       gpio_output_init())
+@param uint16_t value - initial state of the pins (one bit per pin)
+ */
+void gpio_bus_init(GPIOBus* bus, MCU* mcu, GPIO_TypeDef* port, uint16_t mask,
+        uint32_t mode, uint32_t pull, uint16_t value) {
+    bus->mcu = mcu;
+    bus->port = port;
+    bus->mask = mask;
+
+    // Set the initial state before making the pins outputs to prevent
+    // glitches (same as gpio_output_init())
+    gpio_bus_write(bus, value);
+
+    // A bus may be switched quickly, so don't use the low speed that
+    // GPIOOutput uses
+    GPIO_InitTypeDef init;
+    init.Pin = mask;
+    init.Pull = pull;
+    init.Mode = mode;
+    init.Speed = GPIO_SPEED_FREQ_MEDIUM;
+    HAL_GPIO_Init(port, &init);
+}
@@ -0,0 +1,64 @@
+/*
+ * GPIOBus.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_GPIO_GPIOBUS_H_
+#define COMMON_STM32_GPIO_GPIOBUS_H_
+
+#include <common/stm32/mcu/MCU.h>
+
+// Several output pins on the same port, written together
+typedef struct {
+    MCU* mcu;
+    GPIO_TypeDef* port;
+    // Pins in the bus (e.g. GPIO_PIN_0 | GPIO_PIN_1 | GPIO_PIN_2)
+    uint16_t mask;
+} GPIOBus;
+
+void gpio_bus_init(GPIOBus* bus, MCU* mcu, GPIO_TypeDef* port, uint16_t mask,
+        uint32_t mode, uint32_t pull, uint16_t value);
+
+/*
+ * Sets every pin in the bus to the matching bit of `value` (pins not in the
+ * bus are unaffected), in one BSRR write, so all of them change on the same
+ * clock cycle.
+ */
+static inline void gpio_bus_write(GPIOBus* bus, uint16_t value) {
+    bus->port->BSRR = ((uint32_t) (~value & bus->mask) << 16) |
+            (value & bus->mask);
+}
+
+/*
+ * Sets the given pins high and leaves the others unchanged.
+ */
+static inline void gpio_bus_set(GPIOBus* bus, uint16_t pins) {
+    bus->port->BSRR = pins & bus->mask;
+}
+
+/*
+ * Sets the given pins low and leaves the others unchanged.
+ */
+static inline void gpio_bus_clear(GPIOBus* bus, uint16_t pins) {
+    bus->port->BSRR = (uint32_t) (pins & bus->mask) << 16;
+}
+
+/*
+ * Sets `set_pins` high and `clear_pins` low at the same time (if a pin is in
+ * both, it is set high).
+ */
+static inline void gpio_bus_set_clear(GPIOBus* bus, uint16_t set_pins,
+        uint16_t clear_pins) {
+    bus->port->BSRR = ((uint32_t) (clear_pins & bus->mask) << 16) |
+            (set_pins & bus->mask);
+}
+
+/*
+ * Returns the output state of the bus's pins (other bits are 0).
+ */
+static inline uint16_t gpio_bus_read(GPIOBus* bus) {
+    return (uint16_t) (bus->port->ODR & bus->mask);
+}
+
+#endif /* COMMON_STM32_GPIO_GPIOBUS_H_ */
@@ -0,0 +1,231 @@
+/*
+ * GPIODebouncer.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Debounces buttons and switches on any number of pins, driven by a periodic
+ * timer interrupt instead of polling in application code.
+ *
+ * Each interrupt reads the whole input data register (IDR) of each port in one
+ * load and runs a "vertical counter" over it: instead of keeping a counter per
+ * pin, bit n of two 16-bit words `count0` and `count1` together form a 2-bit
+ * counter for pin n. A few bitwise operations then update all 16 counters at
+ * once, so the cost per interrupt only depends on the number of ports, not the
+ * number of pins.
+ *
+ * A pin's counter is reset whenever it reads the same as its debounced state,
+ * and counts each sample that differs. After 4 differing samples in a row, the
+ * debounced state changes and a press or release event is recorded, so at
+ * GPIO_DEBOUNCER_DEFAULT_HZ a change is reported 20 ms after the switch stops
+ * bouncing.
+ *
+ * Events are both passed to the callback (from the interrupt) and latched in
+ * `pressed`/`released` until the application reads them with
+ * gpio_debouncer_get_pressed()/gpio_debouncer_get_released(), so no events are
+ * lost if it only checks occasionally.
+ */
+
+#include <common/stm32/gpio/GPIODebouncer.h>
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Sections.h>
+
+
+/*
+ * Updates the debounced state of all pins on a port from one sample.
+ */
+static void gpio_debouncer_sample(GPIODebouncer* debouncer,
+        GPIODebouncerPort* port) {
+    // 1 = pressed, for the pins being debounced
+    uint16_t sample = (uint16_t) ((port->port->IDR ^ port->active_low) &
+            port->pins);
+
+    // Pins that differ from the debounced state count up (11 -> 10 -> 01 ->
+    // 00 -> 11 from the reset value of 11), the others are reset to 11
+    uint16_t changed = sample ^ port->state;
+    port->count0 = ~(port->count0 & changed);
+    port->count1 = port->count0 ^ (port->count1 & changed);
+
+    // Pins whose counter wrapped back to 11 while still different have
+    // differed for 4 samples in a row
+    uint16_t toggled = changed & port->count0 & port->count1;
+    if (toggled == 0) {
+        return;
+    }
+
+    port->state ^= toggled;
+    uint16_t pressed = toggled & port->state;
+    uint16_t released = toggled & ~port->state;
+    port->pressed |= pressed;
+    port->released |= released;
+    if (debouncer->callback != NULL) {
+        debouncer->callback(debouncer->context, port->port, pressed, released);
+    }
+}
+
+/*
+ * Handles the debouncer timer's interrupt (set as the Timer's irq_handler).
+ */
+FAST_CODE static void gpio_debouncer_irq_handler(Timer* timer) {
+    // The Timer is the first member of the GPIODebouncer
+    GPIODebouncer* debouncer = (GPIODebouncer*) timer;
+    TIM_TypeDef* instance = timer->handle.Instance;
+    if ((instance->SR & TIM_SR_UIF) == 0) {
+        return;
+    }
+    instance->SR = ~((uint32_t) TIM_SR_UIF);
+
+    for (uint32_t i = 0; i < debouncer->port_count; i++) {
+        gpio_debouncer_sample(debouncer, &debouncer->ports[i]);
+    }
+}
+
+static GPIODebouncerPort* gpio_debouncer_find_port(GPIODebouncer* debouncer,
+        GPIO_TypeDef* port) {
+    for (uint32_t i = 0; i < debouncer->port_count; i++) {
+        if (debouncer->ports[i].port == port) {
+            return &debouncer->ports[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Sets up the debouncer's timer (does not start it).
+ *
+ * TIM_TypeDef* timer_reg: timer to use (e.g. TIM6), not used by anything else
+ * uint32_t sample_hz: samples per second (e.g. GPIO_DEBOUNCER_DEFAULT_HZ)
+ * GPIODebouncerCB callback: called on each press/release (can be NULL)
+ */
+void gpio_debouncer_init(GPIODebouncer* debouncer, TIM_TypeDef* timer_reg,
+        uint32_t sample_hz, GPIODebouncerCB callback, void* context) {
+    debouncer->port_count = 0;
+    debouncer->callback = callback;
+    debouncer->context = context;
+
+    timer_setup(&debouncer->timer, 0, 0, 1);
+    timer_customize(&debouncer->timer, timer_reg, 1, 0, 0);
+    debouncer->timer.irq_handler = gpio_debouncer_irq_handler;
+    if (timer_setup_hz(&debouncer->timer, sample_hz) == 0) {
+        Error_Handler();
+        return;
+    }
+    if (timer_init(&debouncer->timer) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+}
+
+/*
+ * Initializes pins on one port as inputs and starts debouncing them. Can be
+ * called several times for the same port (e.g. with different pulls).
+ *
+ * @param pins - pins to add (e.g. GPIO_PIN_0 | GPIO_PIN_13)
+ * @param pull - one of GPIO_NOPULL, GPIO_PULLUP, GPIO_PULLDOWN
+ * @param active_low - true if the pins read low when pressed
+ */
+void gpio_debouncer_add_pins(GPIODebouncer* debouncer, MCU* mcu,
+        GPIO_TypeDef* port, uint16_t pins, uint32_t pull, bool active_low) {
+    GPIO_InitTypeDef init = {0};
+    init.Pin = pins;
+    init.Mode = GPIO_MODE_INPUT;
+    init.Pull = pull;
+    HAL_GPIO_Init(port, &init);
+
+    // The timer interrupt may be sampling the port
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    GPIODebouncerPort* entry = gpio_debouncer_find_port(debouncer, port);
+    if (entry == NULL) {
+        if (debouncer->port_count >= GPIO_DEBOUNCER_MAX_PORTS) {
+            __set_PRIMASK(primask);
+            Error_Handler();
+            return;
+        }
+        entry = &debouncer->ports[debouncer->port_count];
+        entry->port = port;
+        entry->pins = 0;
+        entry->active_low = 0;
+        entry->state = 0;
+        entry->count0 = 0xFFFF;
+        entry->count1 = 0xFFFF;
+        entry->pressed = 0;
+        entry->released = 0;
+        debouncer->port_count++;
+    }
+
+    entry->pins |= pins;
+    if (active_low) {
+        entry->active_low |= pins;
+    } else {
+        entry->active_low &= ~pins;
+    }
+    // Start from the current state of the new pins, so a switch that is
+    // already closed is not reported as pressed
+    uint16_t sample = (uint16_t) ((port->IDR ^ entry->active_low) & pins);
+    entry->state = (entry->state & ~pins) | sample;
+    entry->count0 |= pins;
+    entry->count1 |= pins;
+
+    __set_PRIMASK(primask);
+}
+
+void gpio_debouncer_start(GPIODebouncer* debouncer) {
+    if (timer_start(&debouncer->timer) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
+void gpio_debouncer_stop(GPIODebouncer* debouncer) {
+    timer_stop(&debouncer->timer);
+}
+
+/*
+ * Returns the debounced state of a pin (true if pressed).
+ */
+bool gpio_debouncer_is_pressed(GPIODebouncer* debouncer, GPIO_TypeDef* port,
+        uint16_t pin) {
+    GPIODebouncerPort* entry = gpio_debouncer_find_port(debouncer, port);
+    if (entry == NULL) {
+        return false;
+    }
+    return (entry->state & pin) != 0;
+}
+
+/*
+ * Returns the pins on `port` that have been pressed since the last call, and
+ * clears them.
+ */
+uint16_t gpio_debouncer_get_pressed(GPIODebouncer* debouncer,
+        GPIO_TypeDef* port) {
+    GPIODebouncerPort* entry = gpio_debouncer_find_port(debouncer, port);
+    if (entry == NULL) {
+        return 0;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint16_t pressed = entry->pressed;
+    entry->pressed = 0;
+    __set_PRIMASK(primask);
+    return pressed;
+}
+
+/*
+ * Returns the pins on `port` that have been released since the last call, and
+ * clears them.
+ */
+uint16_t gpio_debouncer_get_released(GPIODebouncer* debouncer,
+        GPIO_TypeDef* port) {
+    GPIODebouncerPort* entry = gpio_debouncer_find_port(debouncer, port);
+    if (entry == NULL) {
+        return 0;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint16_t released = entry->released;
+    entry->released = 0;
+    __set_PRIMASK(primask);
+    return released;
+}
@@ -0,0 +1,68 @@
+/*
+ * GPIODebouncer.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_GPIO_GPIODEBOUNCER_H_
+#define COMMON_STM32_GPIO_GPIODEBOUNCER_H_
+
+#include <common/stm32/timer/Timer.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Maximum number of GPIO ports one debouncer can sample
+#define GPIO_DEBOUNCER_MAX_PORTS 4
+// Suggested sample rate: a pin must read the same for 4 samples (20 ms) to
+// change state, which is longer than most switches bounce for
+#define GPIO_DEBOUNCER_DEFAULT_HZ 200
+
+// Called from the timer interrupt when pins on a port are pressed or released
+// (one bit per pin, e.g. GPIO_PIN_13)
+typedef void (*GPIODebouncerCB)(void* context, GPIO_TypeDef* port,
+        uint16_t pressed, uint16_t released);
+
+// Debounce state for all pins on one port
+// Each bit is one pin, so all 16 pins are debounced in parallel with bitwise
+// operations
+typedef struct {
+    GPIO_TypeDef* port;
+    // Pins being debounced
+    uint16_t pins;
+    // Pins that are pressed when low (e.g. buttons to ground with a pull-up)
+    uint16_t active_low;
+    // Debounced state (1 = pressed)
+    uint16_t state;
+    // 2-bit counter for each pin (bit 0 and bit 1 in separate words) of how
+    // many samples in a row have differed from the debounced state
+    uint16_t count0;
+    uint16_t count1;
+    // Pins pressed/released since the application last checked
+    volatile uint16_t pressed;
+    volatile uint16_t released;
+} GPIODebouncerPort;
+
+typedef struct {
+    // Must be the first member, so the timer's irq_handler can get the
+    // debouncer from the Timer pointer
+    Timer timer;
+    GPIODebouncerPort ports[GPIO_DEBOUNCER_MAX_PORTS];
+    uint32_t port_count;
+    GPIODebouncerCB callback;
+    void* context;
+} GPIODebouncer;
+
+void gpio_debouncer_init(GPIODebouncer* debouncer, TIM_TypeDef* timer_reg,
+        uint32_t sample_hz, GPIODebouncerCB callback, void* context);
+void gpio_debouncer_add_pins(GPIODebouncer* debouncer, MCU* mcu,
+        GPIO_TypeDef* port, uint16_t pins, uint32_t pull, bool active_low);
+void gpio_debouncer_start(GPIODebouncer* debouncer);
+void gpio_debouncer_stop(GPIODebouncer* debouncer);
+bool gpio_debouncer_is_pressed(GPIODebouncer* debouncer, GPIO_TypeDef* port,
+        uint16_t pin);
+uint16_t gpio_debouncer_get_pressed(GPIODebouncer* debouncer,
+        GPIO_TypeDef* port);
+uint16_t gpio_debouncer_get_released(GPIODebouncer* debouncer,
+        GPIO_TypeDef* port);
+
+#endif /* COMMON_STM32_GPIO_GPIODEBOUNCER_H_ */
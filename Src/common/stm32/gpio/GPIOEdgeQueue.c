@@ -0,0 +1,171 @@
+/*
+ * GPIOEdgeQueue.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Records edges on interrupt inputs with the time they happened, for
+ * synchronization pulses and external triggers where the application needs to
+ * know exactly when an edge came rather than when it got around to handling
+ * it.
+ *
+ * Each input is a GPIOITInput whose callback pushes {pin, level, timestamp}
+ * into a lock-free ring. The timestamp is the clock time read at the start of
+ * the EXTI interrupt (see gpio_exti_irq_handler()), so it does not depend on
+ * when the application reads the queue. The application drains the queue in
+ * batches with gpio_edge_queue_read(). If it falls behind and the queue fills
+ * up, new edges are dropped and counted in `overflows`.
+ *
+ * The EXTI has no hardware timestamp, so the timestamp is late by the
+ * interrupt latency (usually well under 1 us, but more if interrupts are
+ * disabled or a higher priority interrupt is running when the edge comes).
+ * gpio_edge_queue_measure_latency() measures this by triggering a line in
+ * software at a known cycle count. For timestamps exact to the timer clock,
+ * use input capture on a timer channel instead (see InputCapture.h).
+ */
+
+#include <common/stm32/gpio/GPIOEdgeQueue.h>
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/util/Profile.h>
+
+
+FAST_CODE static void gpio_edge_queue_cb(void* context, uint16_t pin,
+        uint64_t timestamp_us) {
+    GPIOEdgeQueue* queue = (GPIOEdgeQueue*) context;
+
+    if (queue->trigger_pending) {
+        uint32_t latency = profile_now() - queue->trigger_cycles;
+        if (latency > queue->max_latency_cycles) {
+            queue->max_latency_cycles = latency;
+        }
+        queue->trigger_pending = false;
+        return;
+    }
+
+    queue->events++;
+    uint32_t head = queue->head;
+    if (head - queue->tail >= GPIO_EDGE_QUEUE_SIZE) {
+        queue->overflows++;
+        return;
+    }
+
+    volatile GPIOEdge* edge = &queue->edges[head & (GPIO_EDGE_QUEUE_SIZE - 1)];
+    edge->timestamp_us = timestamp_us;
+    edge->pin = pin;
+    edge->level = (queue->ports[__builtin_ctz(pin)]->IDR & pin) ? 1 : 0;
+    // Make sure the edge is written to memory before updating the head index
+    __DMB();
+    queue->head = head + 1;
+}
+
+/*
+ * Sets up an empty queue. Inputs are added with gpio_edge_queue_add_input().
+ */
+void gpio_edge_queue_init(GPIOEdgeQueue* queue) {
+    queue->head = 0;
+    queue->tail = 0;
+    for (uint32_t i = 0; i < GPIO_IT_INPUT_EXTI_COUNT; i++) {
+        queue->ports[i] = NULL;
+    }
+    queue->events = 0;
+    queue->overflows = 0;
+    queue->trigger_pending = false;
+    queue->trigger_cycles = 0;
+    queue->max_latency_cycles = 0;
+}
+
+/*
+ * Initializes an interrupt input (see gpio_it_input_init()) that pushes its
+ * edges into the queue. This replaces any other callback on the pin's line.
+ *
+ * @param mode - one of GPIO_MODE_IT_RISING, GPIO_MODE_IT_FALLING,
+ *               GPIO_MODE_IT_RISING_FALLING
+ * @param pull - one of GPIO_NOPULL, GPIO_PULLUP, GPIO_PULLDOWN
+ */
+void gpio_edge_queue_add_input(GPIOEdgeQueue* queue, GPIOITInput* gpio,
+        MCU* mcu, GPIO_TypeDef* port, uint16_t pin, uint32_t mode,
+        uint32_t pull) {
+    if (pin == 0 || (pin & (pin - 1)) != 0) {
+        Error_Handler();
+        return;
+    }
+    // Set the port before the interrupt can use it
+    queue->ports[__builtin_ctz(pin)] = port;
+    gpio_it_input_init(gpio, mcu, port, pin, mode, pull, gpio_edge_queue_cb,
+            queue);
+}
+
+/*
+ * Returns the number of edges waiting to be read.
+ */
+uint32_t gpio_edge_queue_available(GPIOEdgeQueue* queue) {
+    return queue->head - queue->tail;
+}
+
+/*
+ * Reads up to `count` edges (oldest first) into `buf`, without waiting.
+ * Returns the number of edges read.
+ *
+ * Only one caller may read from a queue (it must not be called from more than
+ * one thread or interrupt).
+ */
+uint32_t gpio_edge_queue_read(GPIOEdgeQueue* queue, GPIOEdge* buf,
+        uint32_t count) {
+    uint32_t tail = queue->tail;
+    uint32_t available = queue->head - tail;
+    // Make sure the edges are read after the head index that says they are
+    // ready
+    __DMB();
+    if (count > available) {
+        count = available;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        volatile GPIOEdge* edge =
+                &queue->edges[(tail + i) & (GPIO_EDGE_QUEUE_SIZE - 1)];
+        buf[i].timestamp_us = edge->timestamp_us;
+        buf[i].pin = edge->pin;
+        buf[i].level = edge->level;
+    }
+
+    // Make sure the edges are read before the ISR can overwrite them
+    __DMB();
+    queue->tail = tail + count;
+    return count;
+}
+
+/*
+ * Measures the interrupt latency of an input in the queue by triggering its
+ * EXTI line in software `count` times (through the software interrupt event
+ * register) and timing how many CPU cycles it takes for each one to reach the
+ * callback. Software triggers are not pushed into the queue.
+ *
+ * Returns the maximum latency seen so far in cycles (also in
+ * `max_latency_cycles`). Must be called with interrupts enabled, while the
+ * pin is quiet (a real edge during a measurement is counted as the trigger).
+ */
+uint32_t gpio_edge_queue_measure_latency(GPIOEdgeQueue* queue, uint16_t pin,
+        uint32_t count) {
+    // Make sure the cycle counter is running
+    profile_init();
+
+    for (uint32_t i = 0; i < count; i++) {
+        queue->trigger_cycles = profile_now();
+        queue->trigger_pending = true;
+        EXTI->SWIER1 = pin;
+
+        // The interrupt should run within a few cycles, unless the line's
+        // interrupt is not enabled
+        uint64_t deadline = clock_deadline_ms(10);
+        while (queue->trigger_pending) {
+            if (clock_deadline_passed(deadline)) {
+                queue->trigger_pending = false;
+                Error_Handler();
+                return queue->max_latency_cycles;
+            }
+        }
+    }
+
+    return queue->max_latency_cycles;
+}
@@ -0,0 +1,67 @@
+/*
+ * GPIOEdgeQueue.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_GPIO_GPIOEDGEQUEUE_H_
+#define COMMON_STM32_GPIO_GPIOEDGEQUEUE_H_
+
+#include <common/stm32/gpio/GPIOITInput.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of edges the queue holds
+// Must be a power of 2 so the indices can wrap around with a mask
+#define GPIO_EDGE_QUEUE_SIZE 64
+
+// One edge on an interrupt input
+typedef struct {
+    // Clock time in us when the interrupt started
+    uint64_t timestamp_us;
+    // Pin that changed (e.g. GPIO_PIN_6)
+    uint16_t pin;
+    // Pin level read in the interrupt (1 after a rising edge, 0 after a
+    // falling edge, unless the pin changed again before the interrupt ran)
+    uint8_t level;
+} GPIOEdge;
+
+typedef struct {
+    // This is a single-producer (EXTI ISRs), single-consumer ring buffer
+    // All EXTI interrupts have the same priority, so they never interrupt each
+    // other and act as a single producer
+    // The indices count up forever and are masked when accessing the array
+    volatile GPIOEdge edges[GPIO_EDGE_QUEUE_SIZE];
+    // Only written by the ISR
+    volatile uint32_t head;
+    // Only written by gpio_edge_queue_read()
+    volatile uint32_t tail;
+
+    // Port of each line's pin (NULL if the line is not in this queue), to read
+    // the level from
+    GPIO_TypeDef* ports[GPIO_IT_INPUT_EXTI_COUNT];
+
+    // Number of edges pushed, including ones that were dropped
+    volatile uint32_t events;
+    // Number of edges dropped because the queue was full
+    volatile uint32_t overflows;
+
+    // True while gpio_edge_queue_measure_latency() is waiting for a software
+    // trigger to reach the callback, and the DWT cycle count when it triggered
+    volatile bool trigger_pending;
+    volatile uint32_t trigger_cycles;
+    // Maximum cycles from a software trigger to its callback
+    volatile uint32_t max_latency_cycles;
+} GPIOEdgeQueue;
+
+void gpio_edge_queue_init(GPIOEdgeQueue* queue);
+void gpio_edge_queue_add_input(GPIOEdgeQueue* queue, GPIOITInput* gpio,
+        MCU* mcu, GPIO_TypeDef* port, uint16_t pin, uint32_t mode,
+        uint32_t pull);
+uint32_t gpio_edge_queue_available(GPIOEdgeQueue* queue);
+uint32_t gpio_edge_queue_read(GPIOEdgeQueue* queue, GPIOEdge* buf,
+        uint32_t count);
+uint32_t gpio_edge_queue_measure_latency(GPIOEdgeQueue* queue, uint16_t pin,
+        uint32_t count);
+
+#endif /* COMMON_STM32_GPIO_GPIOEDGEQUEUE_H_ */
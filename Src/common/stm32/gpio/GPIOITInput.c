@@ -13,34 +13,98 @@
  * supports 16 interrupt sources corresponding to the 16 GPIO pins
  * This means all GPIO pins on different ports but with the same pin number
  * (e.g. A12, B12, F12) are connected to the same interrupt source
+ *
+ * Lines 5-9 and 10-15 share one interrupt vector each, so the handlers read the
+ * pending register once and only visit the lines that are actually pending
+ * (lowest first), looking each one's callback up directly by line number. This
+ * keeps the latency on the shared vectors independent of how many lines they
+ * cover.
  */
 
 #include <common/stm32/gpio/GPIOITInput.h>
 #include <common/stm32/mcu/errors.h>
-#include <common/stm32/util/Util.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/mcu/Stack.h>
+#include <common/stm32/timer/Clock.h>
+
+// Callback for each EXTI line (all NULL by default), indexed by line number
+FAST_BSS GPIOITInputLine g_gpio_it_input_lines[GPIO_IT_INPUT_EXTI_COUNT] = {{NULL}};
+
+// Lines that gpio_wait_for_state() is waiting on (one bit per line), which the
+// interrupt clears after saving the time in g_gpio_it_input_wake_us
+volatile uint16_t g_gpio_it_input_waiting = 0;
+volatile uint64_t g_gpio_it_input_wake_us[GPIO_IT_INPUT_EXTI_COUNT] = {0};
+// Lines that gpio_it_input_arm_wait() set up itself, which are disabled again
+// by gpio_it_input_disarm_wait()
+uint16_t g_gpio_it_input_temporary = 0;
 
-// This should set all callbacks by default to NULL
-GPIOITInputCB g_gpio_it_input_cbs[GPIO_IT_INPUT_EXTI_COUNT] = {NULL};
+
+/*
+ * Returns the interrupt vector for the pin's EXTI line.
+ */
+static IRQn_Type gpio_it_input_get_irq(uint16_t pin) {
+    if (pin == GPIO_PIN_0) {
+        return EXTI0_IRQn;
+    }
+    else if (pin == GPIO_PIN_1) {
+        return EXTI1_IRQn;
+    }
+    else if (pin == GPIO_PIN_2) {
+        return EXTI2_IRQn;
+    }
+    else if (pin == GPIO_PIN_3) {
+        return EXTI3_IRQn;
+    }
+    else if (pin == GPIO_PIN_4) {
+        return EXTI4_IRQn;
+    }
+    else if (GPIO_PIN_9 >= pin && pin >= GPIO_PIN_5) {
+        return EXTI9_5_IRQn;
+    }
+    else if (GPIO_PIN_15 >= pin && pin >= GPIO_PIN_10) {
+        return EXTI15_10_IRQn;
+    }
+    else {
+        Error_Handler();
+        // Default value to prevent -Wmaybe-uninitialized warning
+        return EXTI0_IRQn;
+    }
+}
 
 /*
  * @param mode - one of GPIO_MODE_IT_RISING, GPIO_MODE_IT_FALLING,
  *               GPIO_MODE_IT_RISING_FALLING
  * @param pull - one of GPIO_NOPULL, GPIO_PULLUP, GPIO_PULLDOWN
+ * @param callback - called from the interrupt on each edge (can be NULL)
+ * @param context - passed to the callback
  */
 void gpio_it_input_init(GPIOITInput* gpio, MCU* mcu, GPIO_TypeDef* port,
-        uint16_t pin, uint32_t mode, uint32_t pull, GPIOITInputCB callback) {
+        uint16_t pin, uint32_t mode, uint32_t pull, GPIOITInputCB callback,
+        void* context) {
+    // Must be exactly one pin, since each pin has its own line
+    if (pin == 0 || (pin & (pin - 1)) != 0) {
+        Error_Handler();
+        return;
+    }
 
     // Initialize GPIOInput struct within GPIOInterrupt struct
     gpio->input.mcu = mcu;
     gpio->input.port = port;
     gpio->input.pin = pin;
+    gpio->input.wake_latency_us = 0;
 
     // Set function pointer for interrupt callback
-    for (uint32_t i = 0; i < GPIO_IT_INPUT_EXTI_COUNT; i++) {
-        if (bit(i) == pin) {
-            g_gpio_it_input_cbs[i] = callback;
-        }
-    }
+    // Disable interrupts so the line's interrupt can't see a callback with
+    // the wrong context
+    GPIOITInputLine* line = &g_gpio_it_input_lines[__builtin_ctz(pin)];
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    line->callback = callback;
+    line->context = context;
+    // The line now belongs to this input, so a wait in progress must not
+    // disable it when it finishes
+    g_gpio_it_input_temporary &= ~pin;
+    __set_PRIMASK(primask);
 
     // Initialize pin with HAL library
     GPIO_InitTypeDef init = {0};
@@ -50,33 +114,7 @@ void gpio_it_input_init(GPIOITInput* gpio, MCU* mcu, GPIO_TypeDef* port,
     HAL_GPIO_Init(port, &init);
 
     /* EXTI interrupt init*/
-    IRQn_Type irq;
-    if (pin == GPIO_PIN_0) {
-        irq = EXTI0_IRQn;
-    }
-    else if (pin == GPIO_PIN_1) {
-        irq = EXTI1_IRQn;
-    }
-    else if (pin == GPIO_PIN_2) {
-        irq = EXTI2_IRQn;
-    }
-    else if (pin == GPIO_PIN_3) {
-        irq = EXTI3_IRQn;
-    }
-    else if (pin == GPIO_PIN_4) {
-        irq = EXTI4_IRQn;
-    }
-    else if (GPIO_PIN_9 >= pin && pin >= GPIO_PIN_5) {
-        irq = EXTI9_5_IRQn;
-    }
-    else if (GPIO_PIN_15 >= pin && pin >= GPIO_PIN_10) {
-        irq = EXTI15_10_IRQn;
-    }
-    else {
-        Error_Handler();
-        // Default value to prevent -Wmaybe-uninitialized warning
-        irq = EXTI0_IRQn;
-    }
+    IRQn_Type irq = gpio_it_input_get_irq(pin);
     // Choose preemption priority as 4 since it should be fairly high priority,
     // but probably not the highest priority
     HAL_NVIC_SetPriority(irq, 4, 0);
@@ -86,17 +124,129 @@ void gpio_it_input_init(GPIOITInput* gpio, MCU* mcu, GPIO_TypeDef* port,
 
 
 
+/*
+ * Sets up the pin's EXTI line so the edge towards `state` causes an interrupt
+ * (to wake the CPU from sleep), for gpio_wait_for_state(). Must be followed by
+ * gpio_it_input_disarm_wait() when done waiting.
+ *
+ * If the line is not in use, it is set up temporarily for just that edge. If
+ * it is already in use by a GPIOITInput on the same pin, its configuration is
+ * left alone so its callback keeps working (and only sees the edges it asked
+ * for).
+ *
+ * Returns true if the edge is guaranteed to cause an interrupt, or false if
+ * not (the line is in use by a pin on another port, or a GPIOITInput that
+ * does not use this edge), in which case the caller has to poll.
+ */
+bool gpio_it_input_arm_wait(GPIO_TypeDef* port, uint16_t pin,
+        GPIO_PinState state) {
+    uint32_t index = (uint32_t) __builtin_ctz(pin);
+    uint32_t exticr_shift = (index & 0x3) * 4;
+    uint32_t port_index = GPIO_GET_INDEX(port);
+    bool armed;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((EXTI->IMR1 & pin) == 0) {
+        // Line is free, so route it from this port and enable the edge
+        __HAL_RCC_SYSCFG_CLK_ENABLE();
+        SYSCFG->EXTICR[index >> 2] =
+                (SYSCFG->EXTICR[index >> 2] & ~(0xFUL << exticr_shift)) |
+                (port_index << exticr_shift);
+        if (state == GPIO_PIN_SET) {
+            EXTI->RTSR1 |= pin;
+            EXTI->FTSR1 &= ~((uint32_t) pin);
+        } else {
+            EXTI->FTSR1 |= pin;
+            EXTI->RTSR1 &= ~((uint32_t) pin);
+        }
+        EXTI->PR1 = pin;
+        EXTI->IMR1 |= pin;
+        g_gpio_it_input_temporary |= pin;
+
+        IRQn_Type irq = gpio_it_input_get_irq(pin);
+        HAL_NVIC_SetPriority(irq, 4, 0);
+        HAL_NVIC_EnableIRQ(irq);
+        armed = true;
+    } else {
+        uint32_t line_port =
+                (SYSCFG->EXTICR[index >> 2] >> exticr_shift) & 0xF;
+        uint32_t edges = (state == GPIO_PIN_SET) ? EXTI->RTSR1 : EXTI->FTSR1;
+        armed = (line_port == port_index) && ((edges & pin) != 0);
+    }
+
+    g_gpio_it_input_waiting |= pin;
+    __set_PRIMASK(primask);
+    return armed;
+}
+
+/*
+ * Undoes gpio_it_input_arm_wait(). Returns the time in us when the line's
+ * interrupt ran while waiting, or 0 if it did not run.
+ */
+uint64_t gpio_it_input_disarm_wait(uint16_t pin) {
+    uint32_t index = (uint32_t) __builtin_ctz(pin);
+    uint64_t wake_us = 0;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    // The interrupt clears the waiting bit when it runs
+    if ((g_gpio_it_input_waiting & pin) == 0) {
+        wake_us = g_gpio_it_input_wake_us[index];
+    }
+    g_gpio_it_input_waiting &= ~pin;
+
+    if (g_gpio_it_input_temporary & pin) {
+        EXTI->IMR1 &= ~((uint32_t) pin);
+        EXTI->RTSR1 &= ~((uint32_t) pin);
+        EXTI->FTSR1 &= ~((uint32_t) pin);
+        EXTI->PR1 = pin;
+        g_gpio_it_input_temporary &= ~pin;
+    }
+
+    __set_PRIMASK(primask);
+    return wake_us;
+}
+
+
+
+
 // -----------------------------------------------------------------------------
 // Interrupt handlers
 
 /*
- * high and low are both INCLUSIVE
+ * Handles all pending lines in `lines` (the lines sharing one interrupt
+ * vector, e.g. GPIO_PIN_5 to GPIO_PIN_9).
  */
-void gpio_exti_irq_handler(uint16_t high, uint16_t low) {
-    // e.g. if high = GPIO_PIN_15, low = GPIO_PIN_10, pin goes from
-    // GPIO_PIN_15 -> GPIO_PIN_14 -> ... -> GPIO_PIN_10
-    for (uint16_t pin = high; pin >= low; pin >>= 1) {
-        HAL_GPIO_EXTI_IRQHandler(pin);
+FAST_CODE void gpio_exti_irq_handler(uint16_t lines) {
+    // Read the time first, as close to the edge as possible (lines that are
+    // pending together all get this timestamp)
+    uint64_t timestamp_us = clock_now_us();
+    STACK_SAMPLE_ISR(exti_irq);
+
+    // Read and clear the pending lines all at once (pending bits are cleared
+    // by writing 1), so any edge during a callback sets its bit again and
+    // re-triggers the interrupt instead of being lost
+    uint32_t pending = EXTI->PR1 & lines;
+    EXTI->PR1 = pending;
+
+    while (pending != 0) {
+        uint32_t index = (uint32_t) __builtin_ctz(pending);
+        // Clear the lowest set bit
+        pending &= pending - 1;
+
+        if (g_gpio_it_input_waiting & (1U << index)) {
+            g_gpio_it_input_wake_us[index] = timestamp_us;
+            g_gpio_it_input_waiting &= ~(1U << index);
+        }
+
+        GPIOITInputLine* line = &g_gpio_it_input_lines[index];
+        if (line->callback != NULL) {
+            line->callback(line->context, (uint16_t) (1U << index),
+                    timestamp_us);
+        }
     }
 }
 
@@ -104,64 +254,49 @@ void gpio_exti_irq_handler(uint16_t high, uint16_t low) {
  * @brief This function handles EXTI line[0] interrupts.
  */
 void EXTI0_IRQHandler(void) {
-    gpio_exti_irq_handler(GPIO_PIN_0, GPIO_PIN_0);
+    gpio_exti_irq_handler(GPIO_PIN_0);
 }
 
 /**
  * @brief This function handles EXTI line[1] interrupts.
  */
 void EXTI1_IRQHandler(void) {
-    gpio_exti_irq_handler(GPIO_PIN_1, GPIO_PIN_1);
+    gpio_exti_irq_handler(GPIO_PIN_1);
 }
 
 /**
  * @brief This function handles EXTI line[2] interrupts.
  */
 void EXTI2_IRQHandler(void) {
-    gpio_exti_irq_handler(GPIO_PIN_2, GPIO_PIN_2);
+    gpio_exti_irq_handler(GPIO_PIN_2);
 }
 
 /**
  * @brief This function handles EXTI line[3] interrupts.
  */
 void EXTI3_IRQHandler(void) {
-    gpio_exti_irq_handler(GPIO_PIN_3, GPIO_PIN_3);
+    gpio_exti_irq_handler(GPIO_PIN_3);
 }
 
 /**
  * @brief This function handles EXTI line[4] interrupts.
  */
 void EXTI4_IRQHandler(void) {
-    gpio_exti_irq_handler(GPIO_PIN_4, GPIO_PIN_4);
+    gpio_exti_irq_handler(GPIO_PIN_4);
 }
 
 /**
  * @brief This function handles EXTI line[9:5] interrupts.
  */
 void EXTI9_5_IRQHandler(void) {
-    gpio_exti_irq_handler(GPIO_PIN_9, GPIO_PIN_5);
+    gpio_exti_irq_handler(GPIO_PIN_5 | GPIO_PIN_6 | GPIO_PIN_7 | GPIO_PIN_8 |
+            GPIO_PIN_9);
 }
 
 /**
  * @brief This function handles EXTI line[15:10] interrupts.
  */
 void EXTI15_10_IRQHandler(void) {
-    gpio_exti_irq_handler(GPIO_PIN_15, GPIO_PIN_10);
-}
-
-/**
- * @brief  EXTI line detection callback.
- * @param  gpio_pin: Specifies the port pin connected to corresponding EXTI
- *                   line.
- * @retval None
- *
- * This function overrides the weak version of this function in the HAL.
- * This function is called by HAL_GPIO_EXTI_IRQHandler() in the HAL.
- */
-void HAL_GPIO_EXTI_Callback(uint16_t gpio_pin) {
-    for (uint32_t i = 0; i < GPIO_IT_INPUT_EXTI_COUNT; i++) {
-        if (bit(i) == gpio_pin && g_gpio_it_input_cbs[i] != NULL) {
-            g_gpio_it_input_cbs[i]();
-        }
-    }
+    gpio_exti_irq_handler(GPIO_PIN_10 | GPIO_PIN_11 | GPIO_PIN_12 |
+            GPIO_PIN_13 | GPIO_PIN_14 | GPIO_PIN_15);
 }
@@ -14,9 +14,17 @@
 #define GPIO_IT_INPUT_EXTI_COUNT 16
 
 // Interrupt input callback type
-// This syntax is weird, but this defines a type called`GPIOITInputCB`
-// that points to a function with signature `void function_name(void)`
-typedef void (*GPIOITInputCB)(void);
+// Called from the EXTI interrupt with the context pointer passed to
+// gpio_it_input_init(), the pin that triggered (e.g. GPIO_PIN_13), and the
+// clock time in us when the interrupt started (see Clock.h)
+typedef void (*GPIOITInputCB)(void* context, uint16_t pin,
+        uint64_t timestamp_us);
+
+// Callback registered for an EXTI line
+typedef struct {
+    GPIOITInputCB callback;
+    void* context;
+} GPIOITInputLine;
 
 typedef struct {
     // Because an interrupt pin can also function as a normal GPIO input, store
@@ -26,6 +34,11 @@ typedef struct {
 } GPIOITInput;
 
 void gpio_it_input_init(GPIOITInput* gpio, MCU* mcu, GPIO_TypeDef* port,
-        uint16_t pin, uint32_t mode, uint32_t pull, GPIOITInputCB callback);
+        uint16_t pin, uint32_t mode, uint32_t pull, GPIOITInputCB callback,
+        void* context);
+
+bool gpio_it_input_arm_wait(GPIO_TypeDef* port, uint16_t pin,
+        GPIO_PinState state);
+uint64_t gpio_it_input_disarm_wait(uint16_t pin);
 
 #endif /* COMMON_STM32_GPIO_GPIOITINPUT_H_ */
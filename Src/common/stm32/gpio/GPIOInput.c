@@ -5,11 +5,33 @@
  *      Author: bruno
  * 
  * Used for standard GPIO input pins, read by polling (not interrupts).
+ *
+ * The exception is gpio_wait_for_state(), which sleeps until the pin's EXTI
+ * interrupt (see GPIOITInput.c) or the timeout instead of polling the pin.
  */
 
 #include <common/stm32/gpio/GPIOInput.h>
+#include <common/stm32/gpio/GPIOITInput.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
 #include <common/stm32/uart/Log.h>
 
+
+// Condition for gpio_wait_for_state()
+typedef struct {
+    GPIOInput* gpio;
+    GPIO_PinState state;
+} GPIOInputWait;
+
+/*
+ * Returns true if the pin is in the state being waited for (called by
+ * idle_sleep_until_cond() with interrupts disabled).
+ */
+static bool gpio_is_in_state(void* context) {
+    GPIOInputWait* wait = (GPIOInputWait*) context;
+    return gpio_read(wait->gpio) == wait->state;
+}
+
 /*
 Initialize a GPIO pin to input state
 @param GPIOInput* gpio - a struct of the initialized pin to be used in
@@ -26,6 +48,7 @@ void gpio_input_init(GPIOInput* gpio, MCU* mcu, GPIO_TypeDef* port,
     gpio->mcu = mcu;
     gpio->port = port;
     gpio->pin = pin;
+    gpio->wake_latency_us = 0;
 
     // Initialize pin with HAL library
     GPIO_InitTypeDef init;
@@ -74,16 +97,41 @@ Wait for an input pin to change to a particular state (either low or high)
  */
 bool gpio_wait_for_state(GPIOInput* gpio, GPIO_PinState state,
         uint32_t timeout_ms) {
-    uint32_t start = HAL_GetTick();
-    while (gpio_read(gpio) != state) {
-        if (HAL_GetTick() > start + timeout_ms) {
-            if (g_log_def != NULL) {
-                warning(g_log_def, "GPIO wait for state timed out");
+    uint64_t deadline = clock_deadline_ms(timeout_ms);
+    if (gpio_read(gpio) == state) {
+        return true;
+    }
+
+    // Sleep until the edge towards `state` interrupts (or the deadline),
+    // checking the pin every time any interrupt wakes the CPU up
+    // If the edge can't be guaranteed to interrupt, wake up every
+    // GPIO_WAIT_POLL_MS to check the pin
+    bool armed = gpio_it_input_arm_wait(gpio->port, gpio->pin, state);
+    GPIOInputWait wait = {gpio, state};
+    bool reached;
+    if (armed) {
+        reached = idle_sleep_until_cond(deadline, gpio_is_in_state, &wait);
+    } else {
+        while (1) {
+            uint64_t poll = clock_deadline_ms(GPIO_WAIT_POLL_MS);
+            reached = idle_sleep_until_cond(poll < deadline ? poll : deadline,
+                    gpio_is_in_state, &wait);
+            if (reached || clock_deadline_passed(deadline)) {
+                break;
             }
-            return false;
         }
     }
+    uint64_t wake_us = gpio_it_input_disarm_wait(gpio->pin);
 
+    if (!reached) {
+        if (g_log_def != NULL) {
+            warning(g_log_def, "GPIO wait for state timed out");
+        }
+        return false;
+    }
+    if (wake_us != 0) {
+        gpio->wake_latency_us = (uint32_t) clock_elapsed_us(wake_us);
+    }
     return true;
 }
 
@@ -11,10 +11,18 @@
 #include <common/stm32/mcu/MCU.h>
 #include <stdbool.h>
 
+// How often gpio_wait_for_state() checks the pin if the pin's EXTI line can't
+// be used to wake it up (because a pin on another port, or an interrupt input
+// on the opposite edge, is using it)
+#define GPIO_WAIT_POLL_MS 1
+
 typedef struct {
     MCU* mcu;
     GPIO_TypeDef* port;
     uint16_t pin;
+    // Time in us from the pin's interrupt to gpio_wait_for_state() running
+    // again, in the last wait that slept until the pin changed
+    uint32_t wake_latency_us;
 } GPIOInput;
 
 void gpio_input_init(GPIOInput* gpio, MCU* mcu, GPIO_TypeDef* port,
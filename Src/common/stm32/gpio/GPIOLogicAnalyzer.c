@@ -0,0 +1,301 @@
+/*
+ * GPIOLogicAnalyzer.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * A simple logic analyzer for debugging the timing of buses like SPI, I2C and
+ * UART without an external analyzer. A timer triggers DMA reads of a GPIO
+ * port's input data register (IDR) into a RAM buffer (see Sampler.c), so the
+ * pins are sampled at a steady rate of up to several MHz with no CPU
+ * involvement per sample.
+ *
+ * The DMA fills the buffer circularly while armed. Each time a half of the
+ * buffer is filled, the interrupt scans it for the trigger edge. Once the
+ * trigger is found, sampling continues until there are enough samples after
+ * it, then the timer is stopped. The capture is `half_count` samples, of which
+ * `pre_count` are from before the trigger. Only half the buffer can be used
+ * for the capture, since the DMA keeps writing into the other half while the
+ * last half is being checked. If the DMA did get far enough to overwrite the
+ * start of the capture (at very high rates), those pre-trigger samples are
+ * dropped and capture_pre_count is reduced.
+ *
+ * The highest usable rate depends on how quickly the half interrupt can scan
+ * half_count samples for the trigger (a few cycles per sample) and how busy
+ * the DMA and bus matrix are.
+ *
+ * The capture is sent over a UART run-length compressed, as text (so it can
+ * be read in a terminal or parsed by a script):
+ *     capture: 4000000 Hz, pins 0x00f0, 4096 samples, 512 before trigger
+ *     0010 37
+ *     0030 112
+ *     ...
+ *     end
+ * Each line after the header is a sample value (masked to the captured pins)
+ * in hex, and the number of samples in a row that had that value.
+ *
+ * Like Sampler, the buffer must be in memory the DMA can access (e.g. not DTCM
+ * on the H743).
+ */
+
+#include <common/stm32/gpio/GPIOLogicAnalyzer.h>
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/uart/UART.h>
+#include <common/stm32/util/StrBuf.h>
+
+// Size of the buffer used to format runs before sending them over the UART
+#define GPIO_LOGIC_ANALYZER_TX_BUF_SIZE 256
+// Longest line that gpio_logic_analyzer_send() formats (excluding the header)
+#define GPIO_LOGIC_ANALYZER_MAX_LINE 16
+
+
+/*
+ * Returns a mask of the trigger pins that have the trigger edge between two
+ * consecutive samples.
+ */
+static inline uint16_t gpio_logic_analyzer_edges(GPIOLogicAnalyzer* analyzer,
+        uint16_t prev, uint16_t cur) {
+    if (analyzer->trigger_edge == GPIO_LOGIC_ANALYZER_RISING) {
+        return ~prev & cur & analyzer->trigger_pins;
+    } else if (analyzer->trigger_edge == GPIO_LOGIC_ANALYZER_FALLING) {
+        return prev & ~cur & analyzer->trigger_pins;
+    } else {
+        return (prev ^ cur) & analyzer->trigger_pins;
+    }
+}
+
+/*
+ * Stops sampling after the last sample of the capture and works out where the
+ * capture is in the buffer.
+ */
+static void gpio_logic_analyzer_finish(GPIOLogicAnalyzer* analyzer) {
+    // Stop the DMA requests, but leave the DMA running so its position can
+    // still be read (gpio_logic_analyzer_wait() releases it later)
+    timer_stop(analyzer->sampler.timer);
+
+    // The DMA has carried on past the samples that were handed to the
+    // callback, overwriting the oldest samples in the buffer
+    // Count one more in case a request was in flight when the timer stopped
+    uint32_t total = analyzer->half_count * 2;
+    uint32_t overwritten = (sampler_get_index(&analyzer->sampler) + total -
+            (analyzer->samples_seen % total)) % total + 1;
+    uint32_t valid_end = analyzer->samples_seen + overwritten;
+    uint32_t oldest = (valid_end > total) ? valid_end - total : 0;
+
+    uint32_t start = analyzer->trigger_sample - analyzer->pre_count;
+    if (start < oldest) {
+        start = oldest;
+    }
+    uint32_t end = analyzer->trigger_sample +
+            (analyzer->half_count - analyzer->pre_count);
+
+    analyzer->capture_start = start % total;
+    analyzer->capture_count = end - start;
+    analyzer->capture_pre_count = analyzer->trigger_sample - start;
+    analyzer->state = GPIO_LOGIC_ANALYZER_DONE;
+}
+
+/*
+ * Called from the DMA interrupt each time half of the buffer is filled.
+ */
+FAST_CODE static void gpio_logic_analyzer_cb(void* context, void* half,
+        uint32_t count) {
+    GPIOLogicAnalyzer* analyzer = (GPIOLogicAnalyzer*) context;
+    uint16_t* samples = (uint16_t*) half;
+
+    if (analyzer->state == GPIO_LOGIC_ANALYZER_ARMED) {
+        uint16_t prev = (analyzer->samples_seen == 0) ? samples[0] :
+                analyzer->last_sample;
+        // Don't trigger until there are enough samples before the trigger
+        uint32_t first = 0;
+        if (analyzer->samples_seen < analyzer->pre_count) {
+            first = analyzer->pre_count - analyzer->samples_seen;
+            if (first > count) {
+                first = count;
+            }
+            if (first > 0) {
+                prev = samples[first - 1];
+            }
+        }
+
+        for (uint32_t i = first; i < count; i++) {
+            uint16_t cur = samples[i];
+            if (gpio_logic_analyzer_edges(analyzer, prev, cur) != 0) {
+                analyzer->trigger_sample = analyzer->samples_seen + i;
+                analyzer->state = GPIO_LOGIC_ANALYZER_TRIGGERED;
+                break;
+            }
+            prev = cur;
+        }
+    }
+
+    analyzer->last_sample = samples[count - 1];
+    analyzer->samples_seen += count;
+
+    if (analyzer->state == GPIO_LOGIC_ANALYZER_TRIGGERED &&
+            analyzer->trigger_sample + (analyzer->half_count -
+            analyzer->pre_count) <= analyzer->samples_seen) {
+        gpio_logic_analyzer_finish(analyzer);
+    }
+}
+
+/*
+ * Sets up the pins as inputs and the sampler (does not start capturing).
+ *
+ * GPIO_TypeDef* port: port to capture
+ * uint16_t pins: pins on the port to capture (e.g. GPIO_PIN_4 | GPIO_PIN_5);
+ *                all 16 are sampled, but the others are masked out
+ * uint32_t pull: one of GPIO_NOPULL, GPIO_PULLUP, GPIO_PULLDOWN
+ * Timer* timer: timer that sets the sample rate, set up and initialized without
+ *               interrupts (see Sampler.c); not used by anything else
+ * uint16_t* buf: buffer of 2 * half_count samples
+ * uint32_t half_count: number of samples in a capture
+ */
+void gpio_logic_analyzer_init(GPIOLogicAnalyzer* analyzer, MCU* mcu,
+        GPIO_TypeDef* port, uint16_t pins, uint32_t pull, Timer* timer,
+        uint16_t* buf, uint32_t half_count) {
+    gpio_input_init(&analyzer->input, mcu, port, pins, pull);
+
+    analyzer->buf = buf;
+    analyzer->half_count = half_count;
+    analyzer->sample_hz = 0;
+    analyzer->state = GPIO_LOGIC_ANALYZER_IDLE;
+    analyzer->capture_start = 0;
+    analyzer->capture_count = 0;
+    analyzer->capture_pre_count = 0;
+
+    sampler_init(&analyzer->sampler, timer, TIM_DMA_UPDATE, &port->IDR,
+            SAMPLER_PERIPH_TO_MEMORY, sizeof(uint16_t), buf, half_count,
+            gpio_logic_analyzer_cb, analyzer);
+}
+
+/*
+ * Starts sampling and looking for the trigger.
+ *
+ * uint32_t sample_hz: sample rate
+ * uint16_t trigger_pins: pins to look for the edge on (any of them triggers)
+ * GPIOLogicAnalyzerEdge trigger_edge: edge to look for
+ * uint32_t pre_count: samples to keep from before the trigger (at most
+ *                     half_count)
+ *
+ * Returns the actual sample rate, or 0 if it can't be reached.
+ */
+uint32_t gpio_logic_analyzer_arm(GPIOLogicAnalyzer* analyzer,
+        uint32_t sample_hz, uint16_t trigger_pins,
+        GPIOLogicAnalyzerEdge trigger_edge, uint32_t pre_count) {
+    if (pre_count > analyzer->half_count) {
+        Error_Handler();
+        return 0;
+    }
+    gpio_logic_analyzer_cancel(analyzer);
+
+    analyzer->sample_hz = timer_setup_hz(analyzer->sampler.timer, sample_hz);
+    if (analyzer->sample_hz == 0) {
+        return 0;
+    }
+
+    analyzer->trigger_pins = trigger_pins;
+    analyzer->trigger_edge = trigger_edge;
+    analyzer->pre_count = pre_count;
+    analyzer->samples_seen = 0;
+    analyzer->last_sample = 0;
+    analyzer->trigger_sample = 0;
+    analyzer->capture_count = 0;
+    analyzer->state = GPIO_LOGIC_ANALYZER_ARMED;
+    sampler_start(&analyzer->sampler);
+    return analyzer->sample_hz;
+}
+
+/*
+ * Condition for gpio_logic_analyzer_wait() (called with interrupts disabled):
+ * the capture finished or was cancelled.
+ */
+static bool gpio_logic_analyzer_is_stopped(void* context) {
+    GPIOLogicAnalyzer* analyzer = (GPIOLogicAnalyzer*) context;
+    return analyzer->state == GPIO_LOGIC_ANALYZER_DONE ||
+            analyzer->state == GPIO_LOGIC_ANALYZER_IDLE;
+}
+
+/*
+ * Waits (sleeping) for the capture to finish.
+ * Returns true if it finished, or false if it timed out (the analyzer is still
+ * armed, so this can be called again).
+ */
+bool gpio_logic_analyzer_wait(GPIOLogicAnalyzer* analyzer,
+        uint32_t timeout_ms) {
+    // The sampler's DMA interrupt wakes this up every half
+    uint64_t deadline = clock_deadline_ms(timeout_ms);
+    idle_sleep_until_cond(deadline, gpio_logic_analyzer_is_stopped, analyzer);
+    if (analyzer->state != GPIO_LOGIC_ANALYZER_DONE) {
+        return false;
+    }
+
+    // Release the DMA until the next capture (the capture stays in the
+    // buffer)
+    sampler_deinit(&analyzer->sampler);
+    return true;
+}
+
+/*
+ * Stops capturing, discarding any capture in progress, and releases the
+ * sampler's DMA (the next gpio_logic_analyzer_arm() takes it again). Must be
+ * called before the analyzer goes out of scope.
+ */
+void gpio_logic_analyzer_cancel(GPIOLogicAnalyzer* analyzer) {
+    sampler_deinit(&analyzer->sampler);
+    analyzer->state = GPIO_LOGIC_ANALYZER_IDLE;
+}
+
+/*
+ * Sends the finished capture over `uart`, run-length compressed (see the top
+ * of this file for the format).
+ * Returns the number of runs sent (0 if there is no finished capture).
+ */
+uint32_t gpio_logic_analyzer_send(GPIOLogicAnalyzer* analyzer,
+        struct UARTStruct* uart) {
+    if (analyzer->state != GPIO_LOGIC_ANALYZER_DONE ||
+            analyzer->capture_count == 0) {
+        return 0;
+    }
+
+    char tx_buf[GPIO_LOGIC_ANALYZER_TX_BUF_SIZE];
+    StrBuf sb;
+    strbuf_init(&sb, tx_buf, sizeof(tx_buf));
+    strbuf_appendf(&sb, "capture: %lu Hz, pins 0x%04x, %lu samples, %lu "
+            "before trigger\r\n", analyzer->sample_hz, analyzer->input.pin,
+            analyzer->capture_count, analyzer->capture_pre_count);
+
+    uint32_t total = analyzer->half_count * 2;
+    uint16_t mask = analyzer->input.pin;
+    uint32_t index = analyzer->capture_start;
+    uint16_t value = analyzer->buf[index] & mask;
+    uint32_t length = 0;
+    uint32_t runs = 0;
+    for (uint32_t i = 0; i <= analyzer->capture_count; i++) {
+        // One past the end flushes the last run
+        bool last = (i == analyzer->capture_count);
+        uint16_t sample = last ? 0 : analyzer->buf[index] & mask;
+        if (!last && sample == value) {
+            length++;
+        } else {
+            if (sb.len + GPIO_LOGIC_ANALYZER_MAX_LINE >= sb.size) {
+                uart_write(uart, (uint8_t*) sb.buf, sb.len);
+                strbuf_clear(&sb);
+            }
+            strbuf_append_hex(&sb, value, 4);
+            strbuf_append_char(&sb, ' ');
+            strbuf_append_u32(&sb, length);
+            strbuf_append(&sb, "\r\n");
+            runs++;
+            value = sample;
+            length = 1;
+        }
+        index = (index + 1) % total;
+    }
+
+    strbuf_append(&sb, "end\r\n");
+    uart_write(uart, (uint8_t*) sb.buf, sb.len);
+    return runs;
+}
@@ -0,0 +1,82 @@
+/*
+ * GPIOLogicAnalyzer.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_GPIO_GPIOLOGICANALYZER_H_
+#define COMMON_STM32_GPIO_GPIOLOGICANALYZER_H_
+
+#include <common/stm32/gpio/GPIOInput.h>
+#include <common/stm32/timer/Sampler.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// GPIO.h is included by UARTLog.h, so UART can't be included here (see
+// UARTLog.h)
+struct UARTStruct;
+
+typedef enum {
+    // Trigger when any of the trigger pins goes from low to high
+    GPIO_LOGIC_ANALYZER_RISING,
+    // Trigger when any of the trigger pins goes from high to low
+    GPIO_LOGIC_ANALYZER_FALLING,
+    // Trigger when any of the trigger pins changes
+    GPIO_LOGIC_ANALYZER_BOTH,
+} GPIOLogicAnalyzerEdge;
+
+typedef enum {
+    GPIO_LOGIC_ANALYZER_IDLE,
+    // Sampling, looking for the trigger
+    GPIO_LOGIC_ANALYZER_ARMED,
+    // Trigger found, sampling the rest of the capture
+    GPIO_LOGIC_ANALYZER_TRIGGERED,
+    // Capture finished, ready to send
+    GPIO_LOGIC_ANALYZER_DONE,
+} GPIOLogicAnalyzerState;
+
+typedef struct {
+    // Pins captured (`pin` is a mask of all of them)
+    GPIOInput input;
+    Sampler sampler;
+
+    // Buffer of 2 * half_count samples (one 16-bit IDR value each)
+    uint16_t* buf;
+    uint32_t half_count;
+    // Actual sample rate
+    uint32_t sample_hz;
+
+    uint16_t trigger_pins;
+    GPIOLogicAnalyzerEdge trigger_edge;
+    // Samples to keep from before the trigger (the capture is half_count
+    // samples in total)
+    uint32_t pre_count;
+
+    volatile GPIOLogicAnalyzerState state;
+    // Number of samples handed to the callback since arming
+    uint32_t samples_seen;
+    // Last sample of the previous half, to find an edge at the start of a half
+    uint16_t last_sample;
+    // Sample number (counting from arming) of the first sample after the edge
+    uint32_t trigger_sample;
+
+    // Result once done: index in buf of the first sample, number of samples,
+    // and number of them before the trigger
+    uint32_t capture_start;
+    uint32_t capture_count;
+    uint32_t capture_pre_count;
+} GPIOLogicAnalyzer;
+
+void gpio_logic_analyzer_init(GPIOLogicAnalyzer* analyzer, MCU* mcu,
+        GPIO_TypeDef* port, uint16_t pins, uint32_t pull, Timer* timer,
+        uint16_t* buf, uint32_t half_count);
+uint32_t gpio_logic_analyzer_arm(GPIOLogicAnalyzer* analyzer,
+        uint32_t sample_hz, uint16_t trigger_pins,
+        GPIOLogicAnalyzerEdge trigger_edge, uint32_t pre_count);
+bool gpio_logic_analyzer_wait(GPIOLogicAnalyzer* analyzer,
+        uint32_t timeout_ms);
+void gpio_logic_analyzer_cancel(GPIOLogicAnalyzer* analyzer);
+uint32_t gpio_logic_analyzer_send(GPIOLogicAnalyzer* analyzer,
+        struct UARTStruct* uart);
+
+#endif /* COMMON_STM32_GPIO_GPIOLOGICANALYZER_H_ */
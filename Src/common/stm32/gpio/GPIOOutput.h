@@ -24,4 +24,39 @@ void gpio_set_low(GPIOOutput* gpio);
 void gpio_set_high(GPIOOutput* gpio);
 void gpio_toggle(GPIOOutput* gpio);
 
+/*
+ * Fast versions of gpio_set() and gpio_toggle(), for bit-banging and timing
+ * critical code. These are inlined and write the port's BSRR (bit set/reset
+ * register) directly, without the HAL's function call and parameter checks.
+ *
+ * A BSRR write only affects the pins whose bits are set in it (the lower 16
+ * bits set pins high, the upper 16 bits set them low), so it is atomic with
+ * respect to other pins on the same port, even if an ISR changes them at the
+ * same time. This is not true of writing ODR, which is a read-modify-write.
+ */
+static inline void gpio_set_fast(GPIOOutput* gpio, GPIO_PinState state) {
+    if (state != GPIO_PIN_RESET) {
+        gpio->port->BSRR = gpio->pin;
+    } else {
+        gpio->port->BSRR = (uint32_t) gpio->pin << 16;
+    }
+}
+
+static inline void gpio_set_high_fast(GPIOOutput* gpio) {
+    gpio->port->BSRR = gpio->pin;
+}
+
+static inline void gpio_set_low_fast(GPIOOutput* gpio) {
+    gpio->port->BSRR = (uint32_t) gpio->pin << 16;
+}
+
+/*
+ * Reads ODR to see which state the pin is in, then sets it to the opposite
+ * state with one BSRR write (so other pins on the port are not affected).
+ */
+static inline void gpio_toggle_fast(GPIOOutput* gpio) {
+    uint32_t odr = gpio->port->ODR;
+    gpio->port->BSRR = ((odr & gpio->pin) << 16) | (~odr & gpio->pin);
+}
+
 #endif /* COMMON_STM32_GPIO_GPIOOUTPUT_H_ */
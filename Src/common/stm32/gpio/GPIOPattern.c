@@ -0,0 +1,227 @@
+/*
+ * GPIOPattern.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Plays multi-pin digital waveforms on a GPIO port, for test fixtures and
+ * sensor wake-up sequences that need precise timing.
+ *
+ * A pattern is a sequence of BSRR words (see gpio_pattern_word()), each of
+ * which sets and clears any of the pins at once. A timer triggers a DMA
+ * transfer of one word to the port's BSRR each period (see Sampler.c), so
+ * every change happens on an exact timer tick, with no CPU involvement and no
+ * interrupt jitter (only a few bus cycles of DMA arbitration).
+ *
+ * The DMA plays a buffer of two halves circularly. While one half plays, the
+ * interrupt for the other one refills it from the pattern, so patterns can be
+ * any length: either a table in memory (gpio_pattern_play(), optionally
+ * looped), or generated on the fly by a callback (gpio_pattern_stream()).
+ * When the pattern runs out, the rest of the buffer is filled with 0 words,
+ * which don't change any pins, and the timer is stopped once only those are
+ * left. The pins then stay in the state the last word left them in.
+ *
+ * Like Sampler, the buffer must be in memory the DMA can access (e.g. not DTCM
+ * on the H743).
+ */
+
+#include <common/stm32/gpio/GPIOPattern.h>
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/timer/Clock.h>
+
+
+/*
+ * Fill callback for gpio_pattern_play(), which copies from the table (looping
+ * as many times as requested).
+ */
+FAST_CODE static uint32_t gpio_pattern_fill_table(void* context, uint32_t* words,
+        uint32_t count) {
+    GPIOPattern* pattern = (GPIOPattern*) context;
+    // Only allow the words to change the pattern's pins
+    uint32_t mask = ((uint32_t) pattern->bus.mask << 16) | pattern->bus.mask;
+
+    uint32_t filled = 0;
+    while (filled < count) {
+        if (pattern->table_index >= pattern->table_count) {
+            if (!pattern->loop_forever) {
+                pattern->loops_left--;
+                if (pattern->loops_left == 0) {
+                    break;
+                }
+            }
+            pattern->table_index = 0;
+        }
+
+        uint32_t chunk = pattern->table_count - pattern->table_index;
+        if (chunk > count - filled) {
+            chunk = count - filled;
+        }
+        const uint32_t* src = &pattern->table[pattern->table_index];
+        for (uint32_t i = 0; i < chunk; i++) {
+            words[filled + i] = src[i] & mask;
+        }
+        filled += chunk;
+        pattern->table_index += chunk;
+    }
+    return filled;
+}
+
+/*
+ * Fills one half of the buffer from the pattern, padding with 0 words once it
+ * runs out.
+ */
+static void gpio_pattern_fill_half(GPIOPattern* pattern, uint32_t half) {
+    uint32_t* words = &pattern->buf[half * pattern->half_count];
+    uint32_t filled = 0;
+    if (!pattern->ending) {
+        filled = pattern->fill(pattern->context, words, pattern->half_count);
+        if (filled < pattern->half_count) {
+            pattern->ending = true;
+        }
+    }
+    for (uint32_t i = filled; i < pattern->half_count; i++) {
+        words[i] = 0;
+    }
+    pattern->half_has_data[half] = (filled > 0);
+}
+
+/*
+ * Called from the DMA interrupt each time half of the buffer has been played.
+ */
+FAST_CODE static void gpio_pattern_cb(void* context, void* half, uint32_t count) {
+    GPIOPattern* pattern = (GPIOPattern*) context;
+    uint32_t index = (half == pattern->buf) ? 0 : 1;
+
+    gpio_pattern_fill_half(pattern, index);
+
+    // Once neither half has anything left to play, stop the DMA requests
+    // (the half playing now is all 0 words, so it doesn't matter where in it
+    // this stops)
+    if (!pattern->half_has_data[0] && !pattern->half_has_data[1]) {
+        timer_stop(pattern->sampler.timer);
+        pattern->running = false;
+    }
+}
+
+/*
+ * Sets up the pins as outputs and the sampler (does not start playing).
+ *
+ * GPIO_TypeDef* port: port to drive
+ * uint16_t pins: pins the pattern can change (e.g. GPIO_PIN_0 | GPIO_PIN_1)
+ * uint16_t initial: initial state of the pins (one bit per pin)
+ * Timer* timer: timer that sets the rate, set up and initialized without
+ *               interrupts (see Sampler.c); not used by anything else
+ * uint32_t* buf: buffer of 2 * half_count words
+ * uint32_t half_count: number of words refilled at a time
+ */
+void gpio_pattern_init(GPIOPattern* pattern, MCU* mcu, GPIO_TypeDef* port,
+        uint16_t pins, uint16_t initial, Timer* timer, uint32_t* buf,
+        uint32_t half_count) {
+    gpio_bus_init(&pattern->bus, mcu, port, pins, GPIO_MODE_OUTPUT_PP,
+            GPIO_NOPULL, initial);
+
+    pattern->buf = buf;
+    pattern->half_count = half_count;
+    pattern->word_hz = 0;
+    pattern->fill = NULL;
+    pattern->context = NULL;
+    pattern->running = false;
+    pattern->table = NULL;
+    pattern->table_count = 0;
+
+    sampler_init(&pattern->sampler, timer, TIM_DMA_UPDATE, &port->BSRR,
+            SAMPLER_MEMORY_TO_PERIPH, sizeof(uint32_t), buf, half_count,
+            gpio_pattern_cb, pattern);
+}
+
+/*
+ * Starts playing words from a fill callback (see GPIOPatternFillCB) at
+ * `word_hz` words per second, until the callback runs out.
+ *
+ * The first word is played one timer period after this is called.
+ * Returns the actual rate, or 0 if it can't be reached.
+ */
+uint32_t gpio_pattern_stream(GPIOPattern* pattern, uint32_t word_hz,
+        GPIOPatternFillCB fill, void* context) {
+    gpio_pattern_stop(pattern);
+
+    pattern->word_hz = timer_setup_hz(pattern->sampler.timer, word_hz);
+    if (pattern->word_hz == 0) {
+        return 0;
+    }
+
+    pattern->fill = fill;
+    pattern->context = context;
+    pattern->ending = false;
+    gpio_pattern_fill_half(pattern, 0);
+    gpio_pattern_fill_half(pattern, 1);
+    if (!pattern->half_has_data[0]) {
+        // Nothing to play
+        return pattern->word_hz;
+    }
+
+    pattern->running = true;
+    sampler_start(&pattern->sampler);
+    return pattern->word_hz;
+}
+
+/*
+ * Starts playing a table of BSRR words at `word_hz` words per second, `loops`
+ * times in a row (0 to loop until gpio_pattern_stop()). Bits in the words for
+ * pins that aren't part of the pattern are ignored.
+ *
+ * The table is copied into the DMA buffer a half at a time, so it can be any
+ * length and can be in any memory, but must stay valid while playing.
+ * Returns the actual rate, or 0 if it can't be reached.
+ */
+uint32_t gpio_pattern_play(GPIOPattern* pattern, uint32_t word_hz,
+        const uint32_t* table, uint32_t count, uint32_t loops) {
+    if (count == 0) {
+        Error_Handler();
+        return 0;
+    }
+    gpio_pattern_stop(pattern);
+
+    pattern->table = table;
+    pattern->table_count = count;
+    pattern->table_index = 0;
+    pattern->loops_left = loops;
+    pattern->loop_forever = (loops == 0);
+    return gpio_pattern_stream(pattern, word_hz, gpio_pattern_fill_table,
+            pattern);
+}
+
+/*
+ * Condition for gpio_pattern_wait() (called with interrupts disabled).
+ */
+static bool gpio_pattern_is_finished(void* context) {
+    GPIOPattern* pattern = (GPIOPattern*) context;
+    return !pattern->running;
+}
+
+/*
+ * Waits (sleeping) for the pattern to finish.
+ * Returns true if it finished, or false if it timed out (it keeps playing).
+ */
+bool gpio_pattern_wait(GPIOPattern* pattern, uint32_t timeout_ms) {
+    // The sampler's DMA interrupt wakes this up every half
+    uint64_t deadline = clock_deadline_ms(timeout_ms);
+    if (!idle_sleep_until_cond(deadline, gpio_pattern_is_finished, pattern)) {
+        return false;
+    }
+
+    // Release the DMA until the next pattern
+    sampler_deinit(&pattern->sampler);
+    return true;
+}
+
+/*
+ * Stops playing immediately, leaving the pins in their current state, and
+ * releases the sampler's DMA (the next pattern takes it again). Must be called
+ * before the pattern goes out of scope.
+ */
+void gpio_pattern_stop(GPIOPattern* pattern) {
+    sampler_deinit(&pattern->sampler);
+    pattern->running = false;
+}
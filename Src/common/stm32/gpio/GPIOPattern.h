@@ -0,0 +1,70 @@
+/*
+ * GPIOPattern.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_GPIO_GPIOPATTERN_H_
+#define COMMON_STM32_GPIO_GPIOPATTERN_H_
+
+#include <common/stm32/gpio/GPIOBus.h>
+#include <common/stm32/timer/Sampler.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Called from the DMA interrupt to get the next `count` BSRR words to play
+// into `words`
+// Returns the number of words written; fewer than `count` (including 0) ends
+// the pattern after those words have been played
+typedef uint32_t (*GPIOPatternFillCB)(void* context, uint32_t* words,
+        uint32_t count);
+
+typedef struct {
+    // Pins the pattern drives
+    GPIOBus bus;
+    Sampler sampler;
+
+    // DMA buffer of 2 * half_count BSRR words
+    uint32_t* buf;
+    uint32_t half_count;
+    // Actual rate words are played at
+    uint32_t word_hz;
+
+    GPIOPatternFillCB fill;
+    void* context;
+    // Whether each half of the buffer has any words from the pattern (the rest
+    // is padded with 0, which doesn't change any pins)
+    bool half_has_data[2];
+    // Set once the fill callback has run out of words
+    bool ending;
+    volatile bool running;
+
+    // Table being played by gpio_pattern_play()
+    const uint32_t* table;
+    uint32_t table_count;
+    uint32_t table_index;
+    // Number of times left to play the table (0 = forever)
+    uint32_t loops_left;
+    bool loop_forever;
+} GPIOPattern;
+
+/*
+ * Returns the BSRR word that sets `set_pins` high and `clear_pins` low at the
+ * same time (if a pin is in both, it is set high).
+ */
+static inline uint32_t gpio_pattern_word(uint16_t set_pins,
+        uint16_t clear_pins) {
+    return ((uint32_t) clear_pins << 16) | set_pins;
+}
+
+void gpio_pattern_init(GPIOPattern* pattern, MCU* mcu, GPIO_TypeDef* port,
+        uint16_t pins, uint16_t initial, Timer* timer, uint32_t* buf,
+        uint32_t half_count);
+uint32_t gpio_pattern_play(GPIOPattern* pattern, uint32_t word_hz,
+        const uint32_t* table, uint32_t count, uint32_t loops);
+uint32_t gpio_pattern_stream(GPIOPattern* pattern, uint32_t word_hz,
+        GPIOPatternFillCB fill, void* context);
+bool gpio_pattern_wait(GPIOPattern* pattern, uint32_t timeout_ms);
+void gpio_pattern_stop(GPIOPattern* pattern);
+
+#endif /* COMMON_STM32_GPIO_GPIOPATTERN_H_ */
@@ -0,0 +1,230 @@
+/*
+ * Idle.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Idle (sleep) support for code that has to wait for something.
+ *
+ * Busy-waiting keeps the core running flat out (up to 480 MHz on the H743)
+ * just to check a flag. Instead, waits can call idle_sleep_until_cond(), which
+ * stops the core with WFI until the next interrupt or a deadline, and checks
+ * the caller's condition each time it wakes up:
+ *     bool done(void* context) {
+ *         return ((Transfer*) context)->finished;
+ *     }
+ *     ...
+ *     if (!idle_sleep_until_cond(clock_deadline_ms(100), done, &transfer)) {
+ *         // Timed out
+ *     }
+ * This only works if whatever the caller is waiting for raises an interrupt
+ * (e.g. a DMA transfer completing). Otherwise, the caller should pass a
+ * shorter deadline to poll at a reasonable rate.
+ *
+ * The condition is checked with interrupts disabled, right before WFI. If it
+ * was checked with interrupts enabled instead (then calling
+ * idle_sleep_until()), the interrupt that makes it true could run between the
+ * check and WFI, and the core would sleep until the deadline even though the
+ * wait was already over. With interrupts disabled, that interrupt stays
+ * pending, so WFI returns immediately. idle_sleep_until() on its own is only
+ * for waits that just depend on the time.
+ *
+ * The deadline uses the clock's wakeup compare (clock_set_wakeup()). If the
+ * sleep is long (at least IDLE_TICKLESS_MIN_US), the SysTick interrupt is also
+ * turned off so it doesn't wake the core every millisecond for nothing. The
+ * SysTick counter keeps running, so when the core wakes up, HAL_GetTick() is
+ * advanced by the number of ticks that were missed (accurate to within one
+ * tick), and stays in step with the SysTick.
+ *
+ * Interrupts are disabled (PRIMASK) around WFI, so the time spent asleep can
+ * be measured before the interrupt that woke the core runs. This gives the
+ * idle time (time asleep) since idle_reset_stats(), for measuring CPU load.
+ * Any pending interrupt still wakes the core with PRIMASK set.
+ *
+ * If there is no clock, idle_sleep_until() still works but relies on the
+ * SysTick to wake up every millisecond to check the deadline.
+ *
+ * HAL_Delay() (weak in the HAL) is also overridden here so it sleeps instead
+ * of spinning.
+ */
+
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/timer/Clock.h>
+
+
+// Idle time accounting since the last idle_reset_stats(), only changed with
+// interrupts disabled
+static uint64_t g_idle_start_us = 0;
+static uint64_t g_idle_us = 0;
+static uint32_t g_idle_sleeps = 0;
+static uint32_t g_idle_tickless_sleeps = 0;
+
+
+/*
+ * Advances the HAL tick by the number of SysTick interrupts that were skipped
+ * while the SysTick interrupt was off.
+ *
+ * uint32_t phase: SysTick cycles into the current tick when it was turned off
+ * uint64_t elapsed_us: time it was off for
+ */
+static void idle_compensate_ticks(uint32_t phase, uint64_t elapsed_us) {
+    uint64_t tick_cycles = (uint64_t) SysTick->LOAD + 1;
+    uint64_t tick_us = (uint64_t) uwTickFreq * 1000;
+    uint64_t phase_us = (phase * tick_us) / tick_cycles;
+    uint32_t missed = (uint32_t) ((phase_us + elapsed_us) / tick_us);
+    uwTick += missed * uwTickFreq;
+}
+
+/*
+ * Sleeps with WFI (with interrupts disabled, PRIMASK already set by the
+ * caller) and adds the time asleep to the stats.
+ */
+static void idle_wfi(uint64_t start_us, uint8_t tickless) {
+    uint32_t phase = 0;
+    if (tickless) {
+        // SysTick counts down from LOAD
+        phase = SysTick->LOAD - SysTick->VAL;
+        SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+    }
+
+    __DSB();
+    __WFI();
+    __ISB();
+
+    uint64_t end_us = clock_now_us();
+    if (tickless) {
+        SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+        idle_compensate_ticks(phase, end_us - start_us);
+        g_idle_tickless_sleeps++;
+    }
+    g_idle_us += end_us - start_us;
+    g_idle_sleeps++;
+}
+
+/*
+ * Sleeps until the next interrupt (including the SysTick, so at most one
+ * tick).
+ */
+void idle_sleep(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    idle_wfi(clock_now_us(), 0);
+    __set_PRIMASK(primask);
+}
+
+/*
+ * Sleeps until the next interrupt or `deadline_us`, with interrupts already
+ * disabled by the caller. Returns false without sleeping if the deadline has
+ * passed.
+ */
+static bool idle_sleep_locked(uint64_t deadline_us) {
+    uint64_t start_us = clock_now_us();
+    if (start_us >= deadline_us) {
+        return false;
+    }
+
+    uint8_t tickless = 0;
+    if (g_clock_def != NULL) {
+        if (!clock_set_wakeup(deadline_us)) {
+            return false;
+        }
+        if (deadline_us - start_us >= IDLE_TICKLESS_MIN_US) {
+            tickless = 1;
+        }
+    }
+
+    idle_wfi(start_us, tickless);
+    clock_cancel_wakeup();
+    return true;
+}
+
+/*
+ * Sleeps until the next interrupt or `deadline_us` (a clock_now_us() time),
+ * whichever comes first. Returns immediately if the deadline has passed.
+ */
+void idle_sleep_until(uint64_t deadline_us) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    idle_sleep_locked(deadline_us);
+    __set_PRIMASK(primask);
+}
+
+/*
+ * Sleeps until `done(context)` returns true or `deadline_us` (a clock_now_us()
+ * time) passes. `done` is called with interrupts disabled, so it must be short
+ * and must not wait for an interrupt itself.
+ * Returns true if `done` returned true (even if the deadline has also passed),
+ * or false if it timed out.
+ */
+bool idle_sleep_until_cond(uint64_t deadline_us, IdleCond done,
+        void* context) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    bool result = true;
+    while (!done(context)) {
+        if (!idle_sleep_locked(deadline_us)) {
+            result = false;
+            break;
+        }
+        // Let the interrupt that woke the core run before checking again
+        __set_PRIMASK(primask);
+        __ISB();
+        __disable_irq();
+    }
+
+    __set_PRIMASK(primask);
+    return result;
+}
+
+/*
+ * Gets the idle time accounting since the stats were last reset.
+ */
+void idle_get_stats(IdleStats* stats) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    stats->total_us = clock_now_us() - g_idle_start_us;
+    stats->idle_us = g_idle_us;
+    stats->sleeps = g_idle_sleeps;
+    stats->tickless_sleeps = g_idle_tickless_sleeps;
+    __set_PRIMASK(primask);
+}
+
+/*
+ * Returns the percentage of time the CPU was busy (not asleep) since the stats
+ * were last reset.
+ */
+uint32_t idle_get_load_percent(void) {
+    IdleStats stats;
+    idle_get_stats(&stats);
+    if (stats.total_us == 0) {
+        return 0;
+    }
+    return (uint32_t) (((stats.total_us - stats.idle_us) * 100) /
+            stats.total_us);
+}
+
+void idle_reset_stats(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    g_idle_start_us = clock_now_us();
+    g_idle_us = 0;
+    g_idle_sleeps = 0;
+    g_idle_tickless_sleeps = 0;
+    __set_PRIMASK(primask);
+}
+
+/*
+ * Overrides the HAL's busy-waiting HAL_Delay().
+ */
+void HAL_Delay(uint32_t Delay) {
+    uint64_t delay_us = (uint64_t) Delay * 1000;
+    // Like the HAL, wait one extra tick when only the tick is available, since
+    // the current tick may be almost over
+    if (g_clock_def == NULL) {
+        delay_us += (uint64_t) uwTickFreq * 1000;
+    }
+    uint64_t deadline_us = clock_now_us() + delay_us;
+    while (!clock_deadline_passed(deadline_us)) {
+        idle_sleep_until(deadline_us);
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * Idle.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_MCU_IDLE_H_
+#define COMMON_STM32_MCU_IDLE_H_
+
+#include <common/stm32/mcu/HAL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Sleeps at least this long (in us) stop the SysTick interrupt (see Idle.c)
+#define IDLE_TICKLESS_MIN_US 2000
+
+typedef struct {
+    // Time since the stats were last reset
+    uint64_t total_us;
+    // Time spent asleep in idle_sleep(), idle_sleep_until() and
+    // idle_sleep_until_cond()
+    uint64_t idle_us;
+    // Number of sleeps, and how many of them stopped the SysTick
+    uint32_t sleeps;
+    uint32_t tickless_sleeps;
+} IdleStats;
+
+// Condition for idle_sleep_until_cond(), called with interrupts disabled
+typedef bool (*IdleCond)(void* context);
+
+void idle_sleep(void);
+void idle_sleep_until(uint64_t deadline_us);
+bool idle_sleep_until_cond(uint64_t deadline_us, IdleCond done,
+        void* context);
+
+void idle_get_stats(IdleStats* stats);
+uint32_t idle_get_load_percent(void);
+void idle_reset_stats(void);
+
+#endif /* COMMON_STM32_MCU_IDLE_H_ */
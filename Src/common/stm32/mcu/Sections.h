@@ -0,0 +1,61 @@
+/*
+ * Sections.h
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Attributes that place code and data in a particular memory, using the
+ * sections in the linker scripts. On the H743:
+ * - FAST_CODE: ITCM (64K at 0x00000000), zero wait state instruction memory,
+ *   copied from flash by the startup, instead of flash (wait states, only
+ *   partly hidden by the ART accelerator)
+ * - FAST_DATA/FAST_BSS: DTCM (128K at 0x20000000), zero wait state data memory
+ *   (FAST_DATA is initialized from flash and FAST_BSS is zeroed by the startup)
+ *   instead of AXI SRAM (RAM_D1)
+ * - DMA_BUFFER: D2 SRAM (RAM_D2), zeroed by the startup and aligned to a cache
+ *   line. DTCM is not accessible by the DMA1/DMA2 controllers, so anything a
+ *   DMA reads or writes must NOT be FAST_DATA/FAST_BSS.
+ * - NOINIT: D3 SRAM (RAM_D3), not initialized by the startup, so it keeps its
+ *   value through a reset
+ *
+ * The G474 only has one RAM with no wait states (and a flash accelerator), so
+ * FAST_* and DMA_BUFFER do nothing and NOINIT puts data at the end of RAM.
+ *
+ * The stack stays in AXI SRAM since some drivers are used from main()'s
+ * locals (e.g. UART, whose buffers are used by the DMA).
+ *
+ * FAST_CODE functions are not inlined (so they run from ITCM even when called
+ * from flash), and calls between flash and ITCM go through linker veneers, so
+ * it is only worth it for functions that do a fair amount of work per call
+ * (e.g. ISRs and loops). Functions called from FAST_CODE (including libc ones)
+ * still run from flash.
+ *
+ * Define SECTIONS_DISABLED to leave everything except NOINIT in the default
+ * sections (e.g. to compare the speed of a build without them).
+ *
+ * Usage:
+ *     FAST_BSS static uint32_t g_counts[16];
+ *     FAST_CODE void handler(void) { ... }
+ */
+
+#ifndef COMMON_STM32_MCU_SECTIONS_H_
+#define COMMON_STM32_MCU_SECTIONS_H_
+
+#if defined(STM32H7) && !defined(SECTIONS_DISABLED)
+
+#define FAST_CODE __attribute__((section(".itcm_text"), noinline))
+#define FAST_DATA __attribute__((section(".dtcm_data")))
+#define FAST_BSS __attribute__((section(".dtcm_bss")))
+#define DMA_BUFFER __attribute__((section(".dma_buffer"), aligned(32)))
+#define NOINIT __attribute__((section(".noinit")))
+
+#else
+
+#define FAST_CODE
+#define FAST_DATA
+#define FAST_BSS
+#define DMA_BUFFER
+#define NOINIT __attribute__((section(".noinit")))
+
+#endif
+
+#endif /* COMMON_STM32_MCU_SECTIONS_H_ */
@@ -0,0 +1,311 @@
+/*
+ * Stack.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Measures how much of the main stack (MSP) is used, since overflowing it
+ * silently corrupts the heap below it (see Heap.c and sysmem.c).
+ *
+ * The stack is the last _Min_Stack_Size bytes below _estack (set in the linker
+ * script). The Reset_Handler fills all of it with STACK_PAINT before anything
+ * is pushed onto it, so stack_high_water() can find the deepest point the
+ * stack has ever reached by looking for the lowest word that was overwritten.
+ *
+ * ISRs can also sample how deep the stack is when they run with
+ * STACK_SAMPLE_ISR() (see Stack.h), to find which interrupts run when the stack
+ * is already deep (the high-water mark only gives the total).
+ *
+ * stack_guard_enable() makes the bottom STACK_GUARD_SIZE bytes of the stack
+ * inaccessible with the MPU, so an overflow causes a MemManage fault instead
+ * of corrupting the heap. MemManage_Handler() (see it.c) jumps to
+ * stack_mem_manage_handler(), which moves the stack pointer to a separate
+ * fault stack if the fault was an overflow, since there is no stack left to
+ * run the handler on. The fault stack is the _Fault_Stack_Size bytes right
+ * below the main stack (reserved in the linker script, and left out of the
+ * heap), so the handler does not overwrite anything on the main stack, e.g.
+ * the UART and Log that main() usually keeps there and the error is logged
+ * with.
+ */
+
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/mcu/Stack.h>
+#include <string.h>
+
+// Symbol defined in the linker script (see sysmem.c)
+extern uint32_t _Min_Stack_Size;
+
+FAST_BSS static StackISR g_stack_isrs[STACK_MAX_ISRS];
+static uint32_t g_stack_isr_count = 0;
+
+// Used if the ISR table is full, so STACK_SAMPLE_ISR() always has an entry to
+// record into (never reported)
+static StackISR g_stack_overflow_isr;
+
+// End of the guard region (the lowest usable stack address), or 0 if the
+// guard is not enabled. Read by stack_mem_manage_handler() before it has a
+// stack, so must not be static.
+uint32_t g_stack_guard_end = 0;
+
+
+/*
+ * Returns the lowest address of the stack.
+ */
+static uint32_t stack_get_bottom(void) {
+    return (uint32_t) &_estack - (uint32_t) &_Min_Stack_Size;
+}
+
+/*
+ * Returns the lowest stack address that can be read (the guard region faults
+ * if it is enabled).
+ */
+static uint32_t* stack_get_readable_bottom(void) {
+    if (g_stack_guard_end != 0) {
+        return (uint32_t*) g_stack_guard_end;
+    }
+    return (uint32_t*) stack_get_bottom();
+}
+
+/*
+ * Returns the size of the stack in bytes (_Min_Stack_Size).
+ */
+uint32_t stack_get_size(void) {
+    return (uint32_t) &_Min_Stack_Size;
+}
+
+/*
+ * Returns the number of bytes on the stack right now.
+ */
+uint32_t stack_get_used(void) {
+    return (uint32_t) &_estack - __get_MSP();
+}
+
+/*
+ * Returns the most bytes that have been on the stack since reset.
+ *
+ * Takes time proportional to the part of the stack that has never been used
+ * (about 1 cycle per unused word), so it is cheap enough to call periodically.
+ */
+uint32_t stack_high_water(void) {
+    uint32_t* word = stack_get_readable_bottom();
+    uint32_t* top = (uint32_t*) &_estack;
+    while (word < top && *word == STACK_PAINT) {
+        word++;
+    }
+    return (uint32_t) top - (uint32_t) word;
+}
+
+/*
+ * Paints the stack again below the current stack pointer (which is not in use),
+ * so stack_high_water() only counts what is used from now on, e.g. to measure
+ * one function. Interrupts can stay enabled, since an ISR's stack is only in
+ * use while it runs.
+ */
+void stack_repaint(void) {
+    uint32_t* word = stack_get_readable_bottom();
+    uint32_t* sp = (uint32_t*) __get_MSP();
+    while (word < sp) {
+        *word = STACK_PAINT;
+        word++;
+    }
+}
+
+/*
+ * Returns true if the stack has reached its lowest usable word, in which case
+ * it has probably overflowed into the heap below it (unless the guard was
+ * enabled, which would have faulted instead).
+ */
+bool stack_reached_limit(void) {
+    return *stack_get_readable_bottom() != STACK_PAINT;
+}
+
+/*
+ * Makes the bottom STACK_GUARD_SIZE bytes of the stack inaccessible with the
+ * MPU, so a stack overflow causes a MemManage fault instead of overwriting the
+ * heap. This leaves STACK_GUARD_SIZE fewer bytes for the stack.
+ *
+ * Any other MPU regions that are already set up are kept, and the default
+ * memory map is used everywhere else.
+ */
+void stack_guard_enable(void) {
+    if (!stack_guard_try_enable()) {
+        Error_Handler();
+    }
+}
+
+/*
+ * Same as stack_guard_enable(), but returns false instead of reporting an
+ * error if the guard can't be enabled, so it can be called with interrupts
+ * disabled (e.g. by the heap when it is set up, see Heap.c).
+ */
+bool stack_guard_try_enable(void) {
+    uint32_t bottom = stack_get_bottom();
+    if ((bottom % STACK_GUARD_SIZE) != 0) {
+        return false;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    // The stack is already inside the region the guard would cover
+    if (__get_MSP() < bottom + STACK_GUARD_SIZE) {
+        __set_PRIMASK(primask);
+        return false;
+    }
+
+    uint32_t ctrl = MPU->CTRL & ~MPU_CTRL_ENABLE_Msk;
+    HAL_MPU_Disable();
+
+    MPU_Region_InitTypeDef region = {0};
+    region.Enable = MPU_REGION_ENABLE;
+    region.Number = STACK_GUARD_MPU_REGION;
+    region.BaseAddress = bottom;
+    region.Size = MPU_REGION_SIZE_32B;
+    region.SubRegionDisable = 0;
+    region.TypeExtField = MPU_TEX_LEVEL0;
+    region.AccessPermission = MPU_REGION_NO_ACCESS;
+    region.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+    region.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+    region.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+    region.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&region);
+
+    HAL_MPU_Enable(ctrl | MPU_PRIVILEGED_DEFAULT);
+    // Without this, the fault escalates to a HardFault (the G474's HAL does
+    // not set it)
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk;
+    g_stack_guard_end = bottom + STACK_GUARD_SIZE;
+
+    __set_PRIMASK(primask);
+    return true;
+}
+
+bool stack_guard_is_enabled(void) {
+    return g_stack_guard_end != 0;
+}
+
+/*
+ * Called by stack_mem_manage_handler() (with a usable stack). `overflowed` is
+ * true if the fault was the stack running into the guard.
+ */
+void stack_mem_manage_fault(uint32_t overflowed) {
+    if (overflowed) {
+        if (g_log_def != NULL) {
+            // The UART interrupt that ends a DMA transfer cannot run during
+            // this fault, so stop any transfer in progress instead of waiting
+            // for it, otherwise this message would never be sent
+            HAL_UART_AbortTransmit(&g_log_def->uart->handle);
+            error(g_log_def, "Stack overflow: used more than %lu bytes "
+                    "(MemManage fault at the guard)",
+                    stack_get_size() - STACK_GUARD_SIZE);
+        }
+    } else {
+        Error_Handler();
+    }
+
+    while (1) {
+    }
+}
+
+/*
+ * Called by MemManage_Handler(). Must be naked, since an overflow leaves the
+ * stack pointer inside (or below) the guard, so any push would fault again.
+ * If the stack pointer is below the end of the guard, moves it to the top of
+ * the fault stack (the bottom of the main stack, which the fault stack grows
+ * down from) before calling stack_mem_manage_fault().
+ */
+__attribute__((naked)) void stack_mem_manage_handler(void) {
+    __asm volatile(
+        "ldr r1, =g_stack_guard_end\n"
+        "ldr r1, [r1]\n"
+        "mov r2, sp\n"
+        "movs r0, #0\n"
+        "cmp r2, r1\n"
+        "bhs 1f\n"
+        "ldr r2, =_estack\n"
+        "ldr r3, =_Min_Stack_Size\n"
+        "subs r2, r2, r3\n"
+        "msr msp, r2\n"
+        "movs r0, #1\n"
+        "1:\n"
+        "b stack_mem_manage_fault\n"
+    );
+}
+
+/*
+ * Returns the ISR entry with the given name, adding it to the table if this is
+ * the first time it is used. Each STACK_SAMPLE_ISR() only calls this once, and
+ * handlers can share an entry by using the same name.
+ */
+StackISR* stack_get_isr(char* name) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    StackISR* isr = &g_stack_overflow_isr;
+    for (uint32_t i = 0; i < g_stack_isr_count; i++) {
+        if (strcmp(g_stack_isrs[i].name, name) == 0) {
+            isr = &g_stack_isrs[i];
+            break;
+        }
+    }
+    if (isr == &g_stack_overflow_isr &&
+            g_stack_isr_count < STACK_MAX_ISRS) {
+        isr = &g_stack_isrs[g_stack_isr_count];
+        isr->name = name;
+        isr->count = 0;
+        isr->max_depth = 0;
+        g_stack_isr_count++;
+    }
+
+    __set_PRIMASK(primask);
+    return isr;
+}
+
+/*
+ * Clears the samples of all ISRs (the ISRs stay in the table).
+ */
+void stack_reset_isrs(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t i = 0; i < g_stack_isr_count; i++) {
+        g_stack_isrs[i].count = 0;
+        g_stack_isrs[i].max_depth = 0;
+    }
+    __set_PRIMASK(primask);
+}
+
+/*
+ * Reports the stack's size, current use and high-water mark, whether the guard
+ * is enabled, and the deepest the stack was when each sampled ISR ran, e.g.
+ *     Stack: 1024 bytes at 0x2001FC00, using 184, most used 612 (59%)
+ *     ISR timer_irq: 20000 calls, max depth 296 bytes
+ */
+void stack_dump(Log* log) {
+    uint32_t size = stack_get_size();
+    uint32_t high_water = stack_high_water();
+    info(log, "Stack: %lu bytes at 0x%08lX, using %lu, most used %lu (%lu%%)",
+            size, stack_get_bottom(), stack_get_used(), high_water,
+            high_water * 100 / size);
+
+    if (stack_guard_is_enabled()) {
+        info(log, "Stack guard: %lu bytes at 0x%08lX",
+                (uint32_t) STACK_GUARD_SIZE, stack_get_bottom());
+    }
+    if (stack_reached_limit()) {
+        warning(log, "Stack reached its limit, it has probably overflowed "
+                "into the heap");
+    }
+
+    uint32_t isr_count = g_stack_isr_count;
+    for (uint32_t i = 0; i < isr_count; i++) {
+        // Copy the entry so the values are consistent
+        StackISR isr;
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        isr = g_stack_isrs[i];
+        __set_PRIMASK(primask);
+
+        info(log, "ISR %s: %lu calls, max depth %lu bytes", isr.name,
+                isr.count, isr.max_depth);
+    }
+}
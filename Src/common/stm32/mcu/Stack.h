@@ -0,0 +1,90 @@
+/*
+ * Stack.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_MCU_STACK_H_
+#define COMMON_STM32_MCU_STACK_H_
+
+#include <common/stm32/mcu/HAL.h>
+#include <common/stm32/uart/Log.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Value the Reset_Handler fills the stack with before anything is pushed onto
+// it (must match the one in the startup_(...).s files)
+#define STACK_PAINT 0xA5A5A5A5
+// Size of the MPU guard region at the bottom of the stack, which is the
+// smallest MPU region (the bottom of the stack must be aligned to it)
+#define STACK_GUARD_SIZE 32
+// MPU region used for the guard (the highest region number common to both
+// MCUs, so it takes priority over any other region that overlaps it)
+#define STACK_GUARD_MPU_REGION MPU_REGION_NUMBER7
+// Maximum number of ISRs (each name used with STACK_SAMPLE_ISR() takes one the
+// first time it runs)
+#define STACK_MAX_ISRS 16
+
+// Top of the stack (the MSP starts here and grows down), defined in the linker
+// script
+extern uint8_t _estack;
+
+typedef struct {
+    char* name;
+    uint32_t count;
+    // Most bytes that were on the stack (including whatever the ISR
+    // interrupted) when the ISR sampled it
+    uint32_t max_depth;
+} StackISR;
+
+// Samples how deep the stack is when an ISR runs, so it can be reported by
+// stack_dump(). Put it at the start of the handler (usage, where the name must
+// be a valid identifier):
+//     STACK_SAMPLE_ISR(timer_irq);
+// This is only a few instructions after the first call, so it is compiled in
+// unless STACK_ISR_DISABLED is defined.
+#ifndef STACK_ISR_DISABLED
+
+#define STACK_SAMPLE_ISR(name) \
+    do { \
+        static StackISR* stack_isr_##name = NULL; \
+        if (stack_isr_##name == NULL) { \
+            stack_isr_##name = stack_get_isr(#name); \
+        } \
+        stack_sample_isr(stack_isr_##name); \
+    } while (0)
+
+#else
+
+#define STACK_SAMPLE_ISR(name)
+
+#endif
+
+uint32_t stack_get_size(void);
+uint32_t stack_get_used(void);
+uint32_t stack_high_water(void);
+void stack_repaint(void);
+bool stack_reached_limit(void);
+
+void stack_guard_enable(void);
+bool stack_guard_try_enable(void);
+bool stack_guard_is_enabled(void);
+
+StackISR* stack_get_isr(char* name);
+void stack_reset_isrs(void);
+void stack_dump(Log* log);
+
+/*
+ * Records the current depth of the stack for an ISR. This is not locked, since
+ * an ISR can only be interrupted by other ISRs (unless handlers at different
+ * priorities share a name, which can rarely lose a sample).
+ */
+static inline void stack_sample_isr(StackISR* isr) {
+    uint32_t depth = (uint32_t) &_estack - __get_MSP();
+    isr->count++;
+    if (depth > isr->max_depth) {
+        isr->max_depth = depth;
+    }
+}
+
+#endif /* COMMON_STM32_MCU_STACK_H_ */
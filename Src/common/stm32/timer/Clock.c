@@ -0,0 +1,346 @@
+/*
+ * Clock.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Microsecond clock service, for measuring time and implementing timeouts and
+ * short delays.
+ *
+ * HAL_GetTick() only counts milliseconds, which is too coarse for timing short
+ * operations or for timeouts shorter than a few ms. Instead, a 32-bit timer
+ * (TIM2 or TIM5) is set up to count up from 0 at 1 MHz and wrap around, which
+ * it does about every 71.6 minutes. Every time it wraps, the update interrupt
+ * increments `overflows`, which becomes the upper 32 bits of a 64-bit time in
+ * us (which will not wrap for over 500,000 years).
+ *
+ * Reading the time does not disable interrupts or lock anything - see
+ * clock_now_us() for how it gets a consistent counter and overflow count.
+ *
+ * The clock also has one alarm (clock_set_alarm()), which uses the timer's
+ * compare channel 1 to interrupt at a given time, without needing another
+ * timer or a periodic tick. Services that need many timeouts (e.g. TimerWheel)
+ * multiplex them onto this alarm. Separately, compare channel 2 provides a
+ * wakeup interrupt with no callback (clock_set_wakeup()), which Idle uses to
+ * sleep until a deadline without disturbing the alarm.
+ *
+ * If the clock has not been initialized, the clock_...() functions still work
+ * but fall back to HAL_GetTick(), so the time only has 1 ms resolution. This
+ * means drivers can always use the clock for their timeouts, whether or not
+ * the application has started one.
+ */
+
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/uart/Log.h>
+
+
+// Global pointer to the running clock (used by all clock functions and the IRQ
+// handler)
+Clock* g_clock_def = NULL;
+
+FAST_CODE static void clock_irq_handler(Timer* timer);
+
+
+/*
+ * Sets up and starts the clock on a 32-bit timer (TIM2 or TIM5), and makes it
+ * the clock used by all clock_...() functions.
+ */
+void clock_init(Clock* clock, TIM_TypeDef* timer_reg) {
+    // The overflow handling assumes the counter is 32 bits
+    if (!IS_TIM_32B_COUNTER_INSTANCE(timer_reg)) {
+        Error_Handler();
+        return;
+    }
+
+    clock->overflows = 0;
+    clock->alarm_set = false;
+    clock->alarm_time_us = 0;
+    clock->alarm_cb = NULL;
+    clock->alarm_context = NULL;
+    clock->wakeup_set = false;
+    clock->wakeup_time_us = 0;
+
+    // Count up through the full 32-bit range, interrupting when it wraps
+    timer_setup(&clock->timer, 0, 0xFFFFFFFF, 1);
+    timer_customize(&clock->timer, timer_reg, 1, 0, 0);
+    clock->timer.irq_handler = clock_irq_handler;
+
+    // Divide the timer's input clock down to 1 MHz
+    uint32_t input_freq = timer_get_input_clock_freq(&clock->timer);
+    if (input_freq < CLOCK_TICK_FREQ_HZ) {
+        Error_Handler();
+        return;
+    }
+    if (input_freq % CLOCK_TICK_FREQ_HZ != 0 && g_log_def != NULL) {
+        warning(g_log_def, "Clock timer input %lu Hz is not a multiple of "
+                "%lu Hz, clock will drift", input_freq,
+                (uint32_t) CLOCK_TICK_FREQ_HZ);
+    }
+    clock->timer.handle.Init.Prescaler =
+            (input_freq / CLOCK_TICK_FREQ_HZ) - 1;
+
+    if (timer_init(&clock->timer) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+
+    // Nothing can be allowed to preempt the overflow interrupt, otherwise it
+    // could read the time while `overflows` and the update flag disagree (see
+    // clock_now_us())
+    HAL_NVIC_SetPriority((timer_reg == TIM2) ? TIM2_IRQn : TIM5_IRQn, 0, 0);
+
+    g_clock_def = clock;
+    if (timer_start(&clock->timer) != HAL_OK) {
+        g_clock_def = NULL;
+        Error_Handler();
+    }
+}
+
+/*
+ * Programs compare channel 1 to interrupt when the counter reaches the low 32
+ * bits of the alarm time.
+ *
+ * If the alarm is more than one counter period away, the compare will match
+ * early (possibly several times); clock_check_alarm() just programs it again
+ * each time until the alarm time is actually reached.
+ */
+static void clock_arm_compare(Clock* clock) {
+    TIM_TypeDef* instance = clock->timer.handle.Instance;
+    instance->SR = ~((uint32_t) TIM_SR_CC1IF);
+    instance->CCR1 = (uint32_t) clock->alarm_time_us;
+    instance->DIER |= TIM_DIER_CC1IE;
+
+    // If the alarm time already passed (or the counter reached it while the
+    // compare was being set up), the match was missed, so generate the compare
+    // event in software instead
+    if (clock_now_us() >= clock->alarm_time_us) {
+        instance->EGR = TIM_EGR_CC1G;
+    }
+}
+
+/*
+ * Called from the compare interrupt. Runs the alarm callback if the alarm time
+ * has been reached, otherwise waits for the next match.
+ */
+static void clock_check_alarm(Clock* clock) {
+    if (!clock->alarm_set) {
+        return;
+    }
+
+    if (clock_now_us() < clock->alarm_time_us) {
+        clock_arm_compare(clock);
+        return;
+    }
+
+    // Clear the alarm before calling the callback so it can set a new one
+    clock->alarm_set = false;
+    clock->timer.handle.Instance->DIER &= ~TIM_DIER_CC1IE;
+    if (clock->alarm_cb != NULL) {
+        clock->alarm_cb(clock->alarm_context);
+    }
+}
+
+/*
+ * Handles the clock timer's interrupt (set as the Timer's irq_handler).
+ *
+ * This is used instead of HAL_TIM_IRQHandler() so the flag is cleared in the
+ * same place the overflow is counted.
+ */
+FAST_CODE static void clock_irq_handler(Timer* timer) {
+    if (g_clock_def == NULL) {
+        return;
+    }
+
+    TIM_TypeDef* instance = timer->handle.Instance;
+    if (instance->SR & TIM_SR_UIF) {
+        // Status flags are cleared by writing 0 (writing 1 has no effect)
+        instance->SR = ~((uint32_t) TIM_SR_UIF);
+        g_clock_def->overflows++;
+    }
+
+    // CC1IF is set on every match even when the alarm is not in use, so only
+    // check it if the interrupt is enabled
+    if ((instance->SR & TIM_SR_CC1IF) && (instance->DIER & TIM_DIER_CC1IE)) {
+        instance->SR = ~((uint32_t) TIM_SR_CC1IF);
+        clock_check_alarm(g_clock_def);
+    }
+
+    // The wakeup only needs to interrupt (which wakes the CPU), so just turn
+    // it off once the time is reached
+    if ((instance->SR & TIM_SR_CC2IF) && (instance->DIER & TIM_DIER_CC2IE)) {
+        instance->SR = ~((uint32_t) TIM_SR_CC2IF);
+        if (clock_now_us() >= g_clock_def->wakeup_time_us) {
+            g_clock_def->wakeup_set = false;
+            instance->DIER &= ~TIM_DIER_CC2IE;
+        }
+    }
+}
+
+/*
+ * Returns the time in us since the clock was started.
+ *
+ * The upper 32 bits (`overflows`) and lower 32 bits (the counter) can't be
+ * read at the same time, so:
+ * - If the interrupt runs between reading them, `overflows` will have changed,
+ *   so read everything again
+ * - If the counter has wrapped but the interrupt has not run yet (because
+ *   interrupts are disabled, or this is called from an ISR that blocks it), the
+ *   update flag is still set. If the counter value is small it must have been
+ *   read after the wrap, so add the overflow that hasn't been counted yet.
+ */
+FAST_CODE uint64_t clock_now_us(void) {
+    Clock* clock = g_clock_def;
+    if (clock == NULL) {
+        // Note this wraps around after about 49 days
+        return (uint64_t) HAL_GetTick() * 1000;
+    }
+
+    TIM_TypeDef* instance = clock->timer.handle.Instance;
+    uint32_t high;
+    uint32_t low;
+    uint32_t status;
+    do {
+        high = clock->overflows;
+        low = instance->CNT;
+        status = instance->SR;
+    } while (high != clock->overflows);
+
+    if ((status & TIM_SR_UIF) && low < 0x80000000) {
+        high++;
+    }
+
+    return ((uint64_t) high << 32) | low;
+}
+
+/*
+ * Returns the time in ms since the clock was started (a drop-in replacement
+ * for HAL_GetTick()).
+ */
+uint32_t clock_now_ms(void) {
+    return (uint32_t) (clock_now_us() / 1000);
+}
+
+/*
+ * Returns the number of us since `start_us` (a previous clock_now_us() value).
+ */
+uint64_t clock_elapsed_us(uint64_t start_us) {
+    return clock_now_us() - start_us;
+}
+
+/*
+ * Busy-waits for at least `delay_us` microseconds.
+ */
+void clock_delay_us(uint32_t delay_us) {
+    uint64_t deadline = clock_deadline_us(delay_us);
+    while (!clock_deadline_passed(deadline)) {
+    }
+}
+
+/*
+ * Returns the time `timeout_us` from now, to be checked with
+ * clock_deadline_passed(). For example:
+ *     uint64_t deadline = clock_deadline_ms(100);
+ *     while (!done()) {
+ *         if (clock_deadline_passed(deadline)) {
+ *             // Timed out
+ *         }
+ *     }
+ *
+ * Since the time is 64 bits it never wraps around, so deadlines can be
+ * compared directly (unlike HAL_GetTick() values).
+ */
+uint64_t clock_deadline_us(uint32_t timeout_us) {
+    return clock_now_us() + timeout_us;
+}
+
+uint64_t clock_deadline_ms(uint32_t timeout_ms) {
+    return clock_now_us() + ((uint64_t) timeout_ms * 1000);
+}
+
+bool clock_deadline_passed(uint64_t deadline_us) {
+    return clock_now_us() >= deadline_us;
+}
+
+/*
+ * Sets the clock's alarm to call `callback` (from the clock's timer interrupt)
+ * once the time reaches `time_us`. If the time has already passed, the
+ * callback is called as soon as possible.
+ *
+ * There is only one alarm, so this replaces any alarm that was already set.
+ * The clock's interrupt has the highest priority, so the callback should be
+ * short.
+ */
+void clock_set_alarm(uint64_t time_us, ClockAlarmCB callback, void* context) {
+    if (g_clock_def == NULL) {
+        Error_Handler();
+        return;
+    }
+
+    // Don't let the interrupt see a half-updated alarm
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    g_clock_def->alarm_time_us = time_us;
+    g_clock_def->alarm_cb = callback;
+    g_clock_def->alarm_context = context;
+    g_clock_def->alarm_set = true;
+    clock_arm_compare(g_clock_def);
+    __set_PRIMASK(primask);
+}
+
+void clock_cancel_alarm(void) {
+    if (g_clock_def == NULL) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    g_clock_def->alarm_set = false;
+    g_clock_def->timer.handle.Instance->DIER &= ~TIM_DIER_CC1IE;
+    __set_PRIMASK(primask);
+}
+
+/*
+ * Makes the clock's timer interrupt at `time_us` (compare channel 2), to wake
+ * the CPU from WFI. Unlike the alarm, nothing is called. If the time is more
+ * than one counter period away, the interrupt also happens early each time
+ * the low 32 bits match, so sleepers should check the time when they wake.
+ *
+ * Returns false (without setting anything) if there is no clock or the time
+ * has already passed, in which case there is nothing to wait for.
+ */
+bool clock_set_wakeup(uint64_t time_us) {
+    Clock* clock = g_clock_def;
+    if (clock == NULL) {
+        return false;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TIM_TypeDef* instance = clock->timer.handle.Instance;
+    clock->wakeup_time_us = time_us;
+    clock->wakeup_set = true;
+    instance->SR = ~((uint32_t) TIM_SR_CC2IF);
+    instance->CCR2 = (uint32_t) time_us;
+    instance->DIER |= TIM_DIER_CC2IE;
+    // Same as clock_arm_compare(), the match could have been missed
+    bool passed = clock_now_us() >= time_us;
+    if (passed) {
+        clock->wakeup_set = false;
+        instance->DIER &= ~TIM_DIER_CC2IE;
+    }
+    __set_PRIMASK(primask);
+    return !passed;
+}
+
+void clock_cancel_wakeup(void) {
+    if (g_clock_def == NULL) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    g_clock_def->wakeup_set = false;
+    g_clock_def->timer.handle.Instance->DIER &= ~TIM_DIER_CC2IE;
+    __set_PRIMASK(primask);
+}
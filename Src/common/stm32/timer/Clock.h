@@ -0,0 +1,58 @@
+/*
+ * Clock.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_TIMER_CLOCK_H_
+#define COMMON_STM32_TIMER_CLOCK_H_
+
+#include <common/stm32/timer/Timer.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Frequency the clock's counter runs at (one tick per microsecond)
+#define CLOCK_TICK_FREQ_HZ 1000000
+
+// Called when the clock's alarm goes off (from the clock's timer interrupt)
+typedef void (*ClockAlarmCB)(void* context);
+
+// A free-running 32-bit timer, extended to 64 bits by counting overflows
+typedef struct {
+    Timer timer;
+    // Number of times the 32-bit counter has wrapped around (the upper 32
+    // bits of the 64-bit time), incremented in the timer's update interrupt
+    volatile uint32_t overflows;
+
+    // Single alarm, using the timer's capture/compare channel 1
+    volatile bool alarm_set;
+    uint64_t alarm_time_us;
+    ClockAlarmCB alarm_cb;
+    void* alarm_context;
+
+    // Wakeup interrupt (no callback) for sleeping until a time, using
+    // capture/compare channel 2
+    volatile bool wakeup_set;
+    uint64_t wakeup_time_us;
+} Clock;
+
+extern Clock* g_clock_def;
+
+void clock_init(Clock* clock, TIM_TypeDef* timer_reg);
+
+uint64_t clock_now_us(void);
+uint32_t clock_now_ms(void);
+uint64_t clock_elapsed_us(uint64_t start_us);
+void clock_delay_us(uint32_t delay_us);
+
+uint64_t clock_deadline_us(uint32_t timeout_us);
+uint64_t clock_deadline_ms(uint32_t timeout_ms);
+bool clock_deadline_passed(uint64_t deadline_us);
+
+void clock_set_alarm(uint64_t time_us, ClockAlarmCB callback, void* context);
+void clock_cancel_alarm(void);
+
+bool clock_set_wakeup(uint64_t time_us);
+void clock_cancel_wakeup(void);
+
+#endif /* COMMON_STM32_TIMER_CLOCK_H_ */
@@ -0,0 +1,280 @@
+/*
+ * InputCapture.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Input capture on a timer channel: on each selected edge of the input pin,
+ * the timer latches its counter into the channel's capture register and a
+ * DMA request copies it into a ring buffer. Edges are timestamped in hardware
+ * at the timer clock's resolution, with no interrupts, so pulse widths and
+ * external sync signals can be measured far more precisely (and with less CPU
+ * time) than by polling the pin.
+ *
+ * The DMA runs in circular mode over the ring, and the read position is kept
+ * in software, so input_capture_read() just compares it to the DMA's current
+ * position. The ring must be read often enough that the DMA never laps the
+ * reader (i.e. fewer than ring_count edges between reads), otherwise the
+ * oldest timestamps are overwritten.
+ *
+ * The timer must be set up and initialized first (timer_setup(),
+ * timer_customize() to pick the timer and count up, timer_init()), without
+ * interrupts. Timestamps are counter values, so they wrap around at the
+ * timer's period; input_capture_ticks_between() handles this, as long as the
+ * edges are less than one period apart. Using the maximum period (0xFFFF, or
+ * 0xFFFFFFFF for 32-bit timers) and a prescaler of 0 gives the best resolution
+ * and range.
+ *
+ * DMA allocation: input captures use DMA2 channels 3-4 (G4) / streams 2-3
+ * (H7), after the ones used by Sampler.c. Like UART, the ring must be in
+ * memory the DMA can access (e.g. not DTCM on the H743).
+ *
+ * An input capture holds its DMA channel/stream from input_capture_init()
+ * until input_capture_deinit(), which must be called before the InputCapture
+ * goes out of scope (or to free the channel/stream for another one).
+ */
+
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/timer/InputCapture.h>
+
+
+// DMA channels/streams available for input captures
+#if defined(STM32G4)
+static DMA_Channel_TypeDef* const
+        g_input_capture_dma_instances[INPUT_CAPTURE_MAX_COUNT] = {
+    DMA2_Channel3,
+    DMA2_Channel4,
+};
+#elif defined(STM32H7)
+static DMA_Stream_TypeDef* const
+        g_input_capture_dma_instances[INPUT_CAPTURE_MAX_COUNT] = {
+    DMA2_Stream2,
+    DMA2_Stream3,
+};
+#endif
+
+// Input capture using each DMA channel/stream (NULL if unused)
+InputCapture* g_input_captures[INPUT_CAPTURE_MAX_COUNT] = {NULL};
+
+
+// Returns the TIM_DMA_CCx request for a channel (TIM_CHANNEL_x is 4 * (x - 1)
+// and the CCxDE bits are consecutive)
+static uint32_t input_capture_dma_source(InputCapture* capture) {
+    return TIM_DMA_CC1 << (capture->channel / 4);
+}
+
+/*
+ * Returns the index of the DMA channel/stream the input capture holds, or -1
+ * if it doesn't hold one.
+ */
+static int32_t input_capture_find(InputCapture* capture) {
+    for (int32_t i = 0; i < INPUT_CAPTURE_MAX_COUNT; i++) {
+        if (g_input_captures[i] == capture) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Sets up a timer channel to capture edges into a ring (does not start it).
+ *
+ * uint32_t channel: TIM_CHANNEL_1 to TIM_CHANNEL_4
+ * uint32_t polarity: TIM_INPUTCHANNELPOLARITY_RISING, _FALLING or _BOTHEDGE
+ * uint32_t filter: input filter (0 to 15, see the ICxF bits in the reference
+ *                  manual), to reject glitches shorter than a few clock cycles
+ * GPIO_TypeDef* port, uint16_t pin: pin connected to the channel's input
+ * uint8_t alternate: the pin's alternate function for the channel
+ * uint32_t pull: GPIO_NOPULL, GPIO_PULLUP or GPIO_PULLDOWN, e.g. to keep an
+ *                open-drain or disconnected input at a known level
+ * uint32_t* ring: buffer for ring_count timestamps
+ */
+void input_capture_init(InputCapture* capture, Timer* timer, uint32_t channel,
+        uint32_t polarity, uint32_t filter, MCU* mcu, GPIO_TypeDef* port,
+        uint16_t pin, uint8_t alternate, uint32_t pull, uint32_t* ring,
+        uint32_t ring_count) {
+    // Find a free DMA channel/stream
+    int32_t index = -1;
+    for (int32_t i = 0; i < INPUT_CAPTURE_MAX_COUNT; i++) {
+        if (g_input_captures[i] == NULL || g_input_captures[i] == capture) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0 || !IS_TIM_CCX_INSTANCE(timer->handle.Instance, channel) ||
+            ring_count == 0 || ring_count > 0xFFFF) {
+        Error_Handler();
+        return;
+    }
+
+    capture->timer = timer;
+    capture->channel = channel;
+    capture->ring = ring;
+    capture->ring_count = ring_count;
+    capture->read_index = 0;
+    capture->running = false;
+
+    uint32_t request = timer_get_dma_request(timer,
+            input_capture_dma_source(capture));
+    if (request == 0) {
+        Error_Handler();
+        return;
+    }
+
+    TIM_IC_InitTypeDef config = {
+        .ICPolarity = polarity,
+        .ICSelection = TIM_ICSELECTION_DIRECTTI,
+        .ICPrescaler = TIM_ICPSC_DIV1,
+        .ICFilter = filter,
+    };
+    if (HAL_TIM_IC_ConfigChannel(&timer->handle, &config, channel) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+
+    gpio_alt_func_init(&capture->gpio, mcu, port, pin, alternate,
+            GPIO_MODE_AF_PP, pull, GPIO_SPEED_FREQ_LOW);
+
+    // This MUST come BEFORE calling HAL_DMA_Init() (see uart_init_dma())
+    __HAL_RCC_DMA2_CLK_ENABLE();
+#if defined(STM32G4)
+    // The G4 routes requests to channels through the DMAMUX
+    __HAL_RCC_DMAMUX1_CLK_ENABLE();
+#endif
+
+    // The capture registers are 32 bits (the upper half is 0 for 16-bit
+    // timers), so always transfer words
+    capture->dma_handle.Instance = g_input_capture_dma_instances[index];
+    capture->dma_handle.Init.Request = request;
+    capture->dma_handle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    capture->dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    capture->dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    capture->dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    capture->dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    capture->dma_handle.Init.Mode = DMA_CIRCULAR;
+    // A capture must be copied before the next edge overwrites it
+    capture->dma_handle.Init.Priority = DMA_PRIORITY_HIGH;
+#if defined(STM32H7)
+    capture->dma_handle.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    capture->dma_handle.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_1QUARTERFULL;
+    capture->dma_handle.Init.MemBurst = DMA_MBURST_SINGLE;
+    capture->dma_handle.Init.PeriphBurst = DMA_PBURST_SINGLE;
+#endif
+    if (HAL_DMA_Init(&capture->dma_handle) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+    capture->dma_handle.Parent = capture;
+
+    g_input_captures[index] = capture;
+}
+
+/*
+ * Discards any timestamps still in the ring and starts capturing (and the
+ * timer's counter, if it isn't already running).
+ */
+void input_capture_start(InputCapture* capture) {
+    capture->read_index = 0;
+
+    // The capture register (CCR1-CCR4) for the channel
+    volatile uint32_t* ccr = &capture->timer->handle.Instance->CCR1 +
+            (capture->channel / 4);
+    // No interrupts are needed, the ring is read using the DMA's position
+    if (HAL_DMA_Start(&capture->dma_handle, (uint32_t) ccr,
+            (uint32_t) capture->ring, capture->ring_count) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+
+    __HAL_TIM_ENABLE_DMA(&capture->timer->handle,
+            input_capture_dma_source(capture));
+    if (HAL_TIM_IC_Start(&capture->timer->handle, capture->channel) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+    capture->running = true;
+}
+
+/*
+ * Stops capturing. The timer's counter is stopped once no channels are using
+ * it.
+ */
+void input_capture_stop(InputCapture* capture) {
+    HAL_TIM_IC_Stop(&capture->timer->handle, capture->channel);
+    __HAL_TIM_DISABLE_DMA(&capture->timer->handle,
+            input_capture_dma_source(capture));
+    HAL_DMA_Abort(&capture->dma_handle);
+    capture->running = false;
+}
+
+/*
+ * Stops capturing if it is running, and releases the DMA channel/stream and
+ * the pin, so another input capture can use them. Does nothing if the input
+ * capture does not hold a DMA channel/stream.
+ */
+void input_capture_deinit(InputCapture* capture) {
+    int32_t index = input_capture_find(capture);
+    if (index < 0) {
+        return;
+    }
+    if (capture->running) {
+        input_capture_stop(capture);
+    }
+
+    HAL_DMA_DeInit(&capture->dma_handle);
+    HAL_GPIO_DeInit(capture->gpio.port, capture->gpio.pin);
+
+    g_input_captures[index] = NULL;
+}
+
+/*
+ * Returns the number of timestamps that can be read.
+ */
+uint32_t input_capture_available(InputCapture* capture) {
+    // The DMA counts down the number of transfers left before it wraps around
+    uint32_t write_index = capture->ring_count -
+            __HAL_DMA_GET_COUNTER(&capture->dma_handle);
+    if (write_index == capture->ring_count) {
+        write_index = 0;
+    }
+    if (write_index >= capture->read_index) {
+        return write_index - capture->read_index;
+    }
+    return capture->ring_count - capture->read_index + write_index;
+}
+
+/*
+ * Reads the oldest timestamp (timer counter value at the edge) that hasn't
+ * been read yet. Returns false if there are none.
+ */
+bool input_capture_read(InputCapture* capture, uint32_t* timestamp) {
+    if (input_capture_available(capture) == 0) {
+        return false;
+    }
+    *timestamp = capture->ring[capture->read_index];
+    capture->read_index++;
+    if (capture->read_index == capture->ring_count) {
+        capture->read_index = 0;
+    }
+    return true;
+}
+
+/*
+ * Returns the number of timer ticks from one timestamp to a later one,
+ * accounting for the counter wrapping around at the timer's period.
+ */
+uint32_t input_capture_ticks_between(InputCapture* capture, uint32_t start,
+        uint32_t end) {
+    if (end >= start) {
+        return end - start;
+    }
+    return (capture->timer->handle.Init.Period - start) + end + 1;
+}
+
+/*
+ * Returns the rate the timestamps count at, in Hz (e.g. for converting ticks
+ * to seconds).
+ */
+uint32_t input_capture_get_tick_freq(InputCapture* capture) {
+    return timer_get_input_clock_freq(capture->timer) /
+            (capture->timer->handle.Init.Prescaler + 1);
+}
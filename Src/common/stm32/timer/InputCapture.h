@@ -0,0 +1,49 @@
+/*
+ * InputCapture.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_TIMER_INPUTCAPTURE_H_
+#define COMMON_STM32_TIMER_INPUTCAPTURE_H_
+
+#include <common/stm32/gpio/GPIOAltFunc.h>
+#include <common/stm32/timer/Timer.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Maximum number of input captures running at the same time (one DMA
+// channel/stream each)
+#define INPUT_CAPTURE_MAX_COUNT 2
+
+typedef struct {
+    // Timer whose counter value is captured on each edge
+    Timer* timer;
+    // TIM_CHANNEL_1 to TIM_CHANNEL_4
+    uint32_t channel;
+    GPIOAltFunc gpio;
+
+    DMA_HandleTypeDef dma_handle;
+
+    // Ring of captured counter values, written by the DMA
+    uint32_t* ring;
+    uint32_t ring_count;
+    // Index of the next value to read from the ring
+    uint32_t read_index;
+    bool running;
+} InputCapture;
+
+void input_capture_init(InputCapture* capture, Timer* timer, uint32_t channel,
+        uint32_t polarity, uint32_t filter, MCU* mcu, GPIO_TypeDef* port,
+        uint16_t pin, uint8_t alternate, uint32_t pull, uint32_t* ring,
+        uint32_t ring_count);
+void input_capture_deinit(InputCapture* capture);
+void input_capture_start(InputCapture* capture);
+void input_capture_stop(InputCapture* capture);
+uint32_t input_capture_available(InputCapture* capture);
+bool input_capture_read(InputCapture* capture, uint32_t* timestamp);
+uint32_t input_capture_ticks_between(InputCapture* capture, uint32_t start,
+        uint32_t end);
+uint32_t input_capture_get_tick_freq(InputCapture* capture);
+
+#endif /* COMMON_STM32_TIMER_INPUTCAPTURE_H_ */
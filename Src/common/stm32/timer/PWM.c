@@ -0,0 +1,187 @@
+/*
+ * PWM.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * PWM output on a timer channel, with the frequency set in Hz and the duty
+ * cycle in percent.
+ *
+ * The frequency is a property of the whole timer (its prescaler and period),
+ * so all channels of a timer share it, and changing it through one channel
+ * changes it for the others. Each channel has its own duty cycle (compare
+ * value), which pwm_set_freq() keeps the same for the channel it is called
+ * on; other channels should call pwm_set_duty() again afterwards.
+ *
+ * The timer must be set up and initialized first (timer_setup(),
+ * timer_customize() to pick the timer and count up, timer_init()), without
+ * interrupts. Its prescaler and period are then replaced by pwm_set_freq().
+ *
+ * Changes to the frequency and duty cycle are preloaded, so they take effect
+ * at the start of the next PWM period without glitching the output. The one
+ * exception is switching to or from 100% when the compare register can't hold
+ * period + 1 (see pwm_update_compare()), which takes effect immediately.
+ *
+ * The pin's alternate function for the timer channel (e.g. GPIO_AF2_TIM3) can
+ * be found in the datasheets listed in GPIO.h.
+ */
+
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/timer/PWM.h>
+
+/*
+ * Sets the channel's output compare mode (TIM_OCMODE_...), which is not
+ * preloaded. The HAL only sets it with HAL_TIM_PWM_ConfigChannel(), which also
+ * turns the output off.
+ */
+static void pwm_set_mode(PWM* pwm, uint32_t mode) {
+    TIM_TypeDef* instance = pwm->timer->handle.Instance;
+    switch (pwm->channel) {
+        case TIM_CHANNEL_1:
+            MODIFY_REG(instance->CCMR1, TIM_CCMR1_OC1M, mode);
+            break;
+        case TIM_CHANNEL_2:
+            MODIFY_REG(instance->CCMR1, TIM_CCMR1_OC2M, mode << 8);
+            break;
+        case TIM_CHANNEL_3:
+            MODIFY_REG(instance->CCMR2, TIM_CCMR2_OC3M, mode);
+            break;
+        case TIM_CHANNEL_4:
+            MODIFY_REG(instance->CCMR2, TIM_CCMR2_OC4M, mode << 8);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Sets the compare value for the duty cycle, using the timer's current period.
+ */
+static void pwm_update_compare(PWM* pwm) {
+    // The output is active while the counter is below the compare value, so
+    // a compare value of period + 1 gives 100%
+    // Integer math, since a float only has 24 bits and a 32-bit timer's
+    // period can be up to 2^32 ticks
+    uint64_t ticks = (uint64_t) pwm->timer->handle.Init.Period + 1;
+    uint64_t compare = (ticks * pwm->duty) / PWM_DUTY_MAX;
+
+    // A 16-bit timer with a period of 0xFFFF (or a 32-bit timer with
+    // 0xFFFFFFFF) can't hold period + 1, so force the output active instead
+    uint64_t max_compare = IS_TIM_32B_COUNTER_INSTANCE(
+            pwm->timer->handle.Instance) ? 0xFFFFFFFF : 0xFFFF;
+    if (compare > max_compare) {
+        pwm_set_mode(pwm, TIM_OCMODE_FORCED_ACTIVE);
+        compare = max_compare;
+    } else {
+        pwm_set_mode(pwm, TIM_OCMODE_PWM1);
+    }
+    __HAL_TIM_SET_COMPARE(&pwm->timer->handle, pwm->channel,
+            (uint32_t) compare);
+}
+
+/*
+ * Sets up a timer channel for PWM output (does not start it). The output is
+ * high for the duty cycle at the start of each period, with a duty cycle of
+ * 0% until pwm_set_duty() is called.
+ *
+ * uint32_t channel: TIM_CHANNEL_1 to TIM_CHANNEL_4
+ * GPIO_TypeDef* port, uint16_t pin: pin connected to the channel's output
+ * uint8_t alternate: the pin's alternate function for the channel
+ */
+void pwm_init(PWM* pwm, Timer* timer, uint32_t channel, MCU* mcu,
+        GPIO_TypeDef* port, uint16_t pin, uint8_t alternate) {
+    if (!IS_TIM_CCX_INSTANCE(timer->handle.Instance, channel)) {
+        Error_Handler();
+        return;
+    }
+
+    pwm->timer = timer;
+    pwm->channel = channel;
+    pwm->duty = 0;
+    pwm->running = false;
+
+    TIM_OC_InitTypeDef config = {
+        .OCMode = TIM_OCMODE_PWM1,
+        .Pulse = 0,
+        .OCPolarity = TIM_OCPOLARITY_HIGH,
+        .OCNPolarity = TIM_OCNPOLARITY_HIGH,
+        .OCFastMode = TIM_OCFAST_DISABLE,
+        .OCIdleState = TIM_OCIDLESTATE_RESET,
+        .OCNIdleState = TIM_OCNIDLESTATE_RESET,
+    };
+    // Also enables the compare preload
+    if (HAL_TIM_PWM_ConfigChannel(&timer->handle, &config, channel) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+
+    // The pin may be toggled at up to the timer clock, so don't use low speed
+    gpio_alt_func_init(&pwm->gpio, mcu, port, pin, alternate, GPIO_MODE_AF_PP,
+            GPIO_NOPULL, GPIO_SPEED_FREQ_HIGH);
+}
+
+/*
+ * Sets the timer's PWM frequency (see timer_setup_hz()). Returns the actual
+ * frequency, which can differ from freq_hz since the period is a whole number
+ * of timer clock cycles.
+ */
+uint32_t pwm_set_freq(PWM* pwm, uint32_t freq_hz) {
+    uint32_t actual_hz = timer_setup_hz(pwm->timer, freq_hz);
+    if (actual_hz == 0) {
+        Error_Handler();
+        return 0;
+    }
+    pwm_update_compare(pwm);
+    return actual_hz;
+}
+
+/*
+ * Returns the timer's current PWM frequency (rounded to the nearest Hz).
+ */
+uint32_t pwm_get_freq(PWM* pwm) {
+    return (uint32_t) (timer_get_freq(pwm->timer) + 0.5f);
+}
+
+/*
+ * Sets the duty cycle, in percent (clamped to 0 to 100). The resolution is
+ * 0.01% or one timer clock cycle (100% / (period + 1)), whichever is coarser.
+ */
+void pwm_set_duty(PWM* pwm, float duty_percent) {
+    if (duty_percent < 0.0f) {
+        duty_percent = 0.0f;
+    } else if (duty_percent > 100.0f) {
+        duty_percent = 100.0f;
+    }
+    pwm_set_duty_hundredths(pwm, (uint32_t) (duty_percent * 100.0f + 0.5f));
+}
+
+/*
+ * Sets the duty cycle, in hundredths of a percent (clamped to 0 to
+ * PWM_DUTY_MAX), without any floating-point math.
+ */
+void pwm_set_duty_hundredths(PWM* pwm, uint32_t duty) {
+    if (duty > PWM_DUTY_MAX) {
+        duty = PWM_DUTY_MAX;
+    }
+    pwm->duty = duty;
+    pwm_update_compare(pwm);
+}
+
+/*
+ * Starts the output (and the timer's counter, if it isn't already running).
+ */
+void pwm_start(PWM* pwm) {
+    if (HAL_TIM_PWM_Start(&pwm->timer->handle, pwm->channel) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+    pwm->running = true;
+}
+
+/*
+ * Stops the output, leaving the pin low. The timer's counter is stopped once
+ * no channels are using it.
+ */
+void pwm_stop(PWM* pwm) {
+    HAL_TIM_PWM_Stop(&pwm->timer->handle, pwm->channel);
+    pwm->running = false;
+}
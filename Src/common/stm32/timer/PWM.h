@@ -0,0 +1,38 @@
+/*
+ * PWM.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_TIMER_PWM_H_
+#define COMMON_STM32_TIMER_PWM_H_
+
+#include <common/stm32/gpio/GPIOAltFunc.h>
+#include <common/stm32/timer/Timer.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Duty cycles are stored in hundredths of a percent, so this is 100%
+#define PWM_DUTY_MAX 10000
+
+typedef struct {
+    // Timer (shared by all of its channels) that sets the PWM frequency
+    Timer* timer;
+    // TIM_CHANNEL_1 to TIM_CHANNEL_4
+    uint32_t channel;
+    GPIOAltFunc gpio;
+    // Duty cycle last set, in hundredths of a percent (0 to PWM_DUTY_MAX)
+    uint32_t duty;
+    bool running;
+} PWM;
+
+void pwm_init(PWM* pwm, Timer* timer, uint32_t channel, MCU* mcu,
+        GPIO_TypeDef* port, uint16_t pin, uint8_t alternate);
+uint32_t pwm_set_freq(PWM* pwm, uint32_t freq_hz);
+uint32_t pwm_get_freq(PWM* pwm);
+void pwm_set_duty(PWM* pwm, float duty_percent);
+void pwm_set_duty_hundredths(PWM* pwm, uint32_t duty);
+void pwm_start(PWM* pwm);
+void pwm_stop(PWM* pwm);
+
+#endif /* COMMON_STM32_TIMER_PWM_H_ */
@@ -0,0 +1,336 @@
+/*
+ * Sampler.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Timer-triggered DMA sampling: a timer event (update or channel 1 compare)
+ * triggers a DMA transfer of one sample between a peripheral register and a
+ * RAM buffer, so samples are taken at exactly the timer's rate with no CPU
+ * involvement (and no interrupt jitter) per sample.
+ *
+ * The DMA runs in circular mode over a buffer of 2 * half_count samples. When
+ * the first half is done, the half-transfer interrupt hands it to the callback
+ * while the DMA carries on with the second half, and vice versa, so the CPU
+ * only gets one interrupt per half_count samples. This works for both
+ * directions:
+ * - PERIPH_TO_MEMORY: sampling an input (e.g. GPIO IDR, ADC DR); the callback
+ *   gets a full half to process
+ * - MEMORY_TO_PERIPH: generating an output (e.g. GPIO BSRR, DAC DHR); the
+ *   callback gets the half that was just sent, to refill with new data
+ *
+ * The timer must be set up and initialized (timer_setup(), timer_init()) with
+ * its period set to the sample rate, without interrupts. For the CC1 trigger,
+ * the compare value (__HAL_TIM_SET_COMPARE()) sets where in each period the
+ * sample is taken.
+ *
+ * DMA allocation: UART uses DMA1 channels 1-2 (G4) / streams 0-1 (H7), so
+ * samplers use DMA2 channels 1-2 (G4) / streams 0-1 (H7), allowing up to
+ * SAMPLER_MAX_COUNT samplers at once.
+ *
+ * Like UART, the buffer must be in memory the DMA can access (e.g. not DTCM
+ * on the H743).
+ *
+ * A sampler holds its DMA channel/stream from sampler_init() until
+ * sampler_deinit(), which must be called before the Sampler goes out of scope
+ * (the DMA interrupt looks it up in g_samplers[]).
+ */
+
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/mcu/Stack.h>
+#include <common/stm32/timer/Sampler.h>
+
+
+// DMA channels/streams available for samplers, and their interrupts
+#if defined(STM32G4)
+static DMA_Channel_TypeDef* const g_sampler_dma_instances[SAMPLER_MAX_COUNT] = {
+    DMA2_Channel1,
+    DMA2_Channel2,
+};
+static const IRQn_Type g_sampler_dma_irqs[SAMPLER_MAX_COUNT] = {
+    DMA2_Channel1_IRQn,
+    DMA2_Channel2_IRQn,
+};
+#elif defined(STM32H7)
+static DMA_Stream_TypeDef* const g_sampler_dma_instances[SAMPLER_MAX_COUNT] = {
+    DMA2_Stream0,
+    DMA2_Stream1,
+};
+static const IRQn_Type g_sampler_dma_irqs[SAMPLER_MAX_COUNT] = {
+    DMA2_Stream0_IRQn,
+    DMA2_Stream1_IRQn,
+};
+#endif
+
+// Sampler using each DMA channel/stream (NULL if unused) - needed in ISRs
+FAST_BSS Sampler* g_samplers[SAMPLER_MAX_COUNT] = {NULL};
+
+
+static void sampler_half_cplt_cb(DMA_HandleTypeDef* hdma) {
+    Sampler* sampler = (Sampler*) hdma->Parent;
+    sampler->halves_done++;
+    if (sampler->callback != NULL) {
+        sampler->callback(sampler->context, sampler->buf, sampler->half_count);
+    }
+}
+
+static void sampler_cplt_cb(DMA_HandleTypeDef* hdma) {
+    Sampler* sampler = (Sampler*) hdma->Parent;
+    sampler->halves_done++;
+    if (sampler->callback != NULL) {
+        sampler->callback(sampler->context,
+                &sampler->buf[sampler->half_count * sampler->sample_size],
+                sampler->half_count);
+    }
+}
+
+static void sampler_error_cb(DMA_HandleTypeDef* hdma) {
+    Sampler* sampler = (Sampler*) hdma->Parent;
+    sampler->errors++;
+}
+
+/*
+ * Returns the index of the DMA channel/stream the sampler holds, or -1 if it
+ * does not hold one.
+ */
+static int32_t sampler_find(Sampler* sampler) {
+    for (int32_t i = 0; i < SAMPLER_MAX_COUNT; i++) {
+        if (g_samplers[i] == sampler) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Sets up a sampler (does not start it).
+ *
+ * Timer* timer: timer (already initialized) that triggers each sample
+ * uint32_t trigger: TIM_DMA_UPDATE or TIM_DMA_CC1
+ * volatile void* periph_addr: peripheral register to read from or write to
+ *                             (e.g. &GPIOA->IDR)
+ * SamplerDirection direction: whether samples go from the register to the
+ *                             buffer or the other way
+ * uint32_t sample_size: bytes per sample and register access size (1, 2 or 4)
+ * void* buf: buffer of at least 2 * half_count samples
+ * uint32_t half_count: number of samples per half of the buffer
+ * SamplerCB callback: called each time a half is done (can be NULL)
+ */
+void sampler_init(Sampler* sampler, Timer* timer, uint32_t trigger,
+        volatile void* periph_addr, SamplerDirection direction,
+        uint32_t sample_size, void* buf, uint32_t half_count,
+        SamplerCB callback, void* context) {
+    // Find a free DMA channel/stream
+    int32_t index = -1;
+    for (int32_t i = 0; i < SAMPLER_MAX_COUNT; i++) {
+        if (g_samplers[i] == NULL || g_samplers[i] == sampler) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        Error_Handler();
+        return;
+    }
+
+    uint32_t periph_align;
+    uint32_t mem_align;
+    if (sample_size == 1) {
+        periph_align = DMA_PDATAALIGN_BYTE;
+        mem_align = DMA_MDATAALIGN_BYTE;
+    } else if (sample_size == 2) {
+        periph_align = DMA_PDATAALIGN_HALFWORD;
+        mem_align = DMA_MDATAALIGN_HALFWORD;
+    } else if (sample_size == 4) {
+        periph_align = DMA_PDATAALIGN_WORD;
+        mem_align = DMA_MDATAALIGN_WORD;
+    } else {
+        Error_Handler();
+        return;
+    }
+
+    uint32_t request = timer_get_dma_request(timer, trigger);
+    // The DMA transfers at most 65535 items, and the buffer is 2 halves
+    if (request == 0 || half_count == 0 || half_count > 0xFFFF / 2) {
+        Error_Handler();
+        return;
+    }
+
+    sampler->timer = timer;
+    sampler->trigger = trigger;
+    sampler->direction = direction;
+    sampler->periph_addr = (uint32_t) periph_addr;
+    sampler->buf = (uint8_t*) buf;
+    sampler->half_count = half_count;
+    sampler->sample_size = sample_size;
+    sampler->callback = callback;
+    sampler->context = context;
+    sampler->halves_done = 0;
+    sampler->errors = 0;
+    sampler->running = false;
+
+    // This MUST come BEFORE calling HAL_DMA_Init() (see uart_init_dma())
+    __HAL_RCC_DMA2_CLK_ENABLE();
+#if defined(STM32G4)
+    // The G4 routes requests to channels through the DMAMUX
+    __HAL_RCC_DMAMUX1_CLK_ENABLE();
+#endif
+
+    sampler->dma_handle.Instance = g_sampler_dma_instances[index];
+    sampler->dma_handle.Init.Request = request;
+    sampler->dma_handle.Init.Direction =
+            (direction == SAMPLER_PERIPH_TO_MEMORY) ?
+            DMA_PERIPH_TO_MEMORY : DMA_MEMORY_TO_PERIPH;
+    sampler->dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    sampler->dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    sampler->dma_handle.Init.PeriphDataAlignment = periph_align;
+    sampler->dma_handle.Init.MemDataAlignment = mem_align;
+    sampler->dma_handle.Init.Mode = DMA_CIRCULAR;
+    // Samples are time-critical, so they should win over UART (low/medium)
+    sampler->dma_handle.Init.Priority = DMA_PRIORITY_HIGH;
+#if defined(STM32H7)
+    // Direct mode, so each sample is transferred as soon as it is requested
+    // instead of waiting in the FIFO
+    sampler->dma_handle.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    sampler->dma_handle.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_1QUARTERFULL;
+    sampler->dma_handle.Init.MemBurst = DMA_MBURST_SINGLE;
+    sampler->dma_handle.Init.PeriphBurst = DMA_PBURST_SINGLE;
+#endif
+    if (HAL_DMA_Init(&sampler->dma_handle) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+    sampler->dma_handle.Parent = sampler;
+
+    // Higher priority than UART (8) so a half is handed off promptly, since
+    // the callback has to finish before the other half is done
+    sampler->dma_irq = g_sampler_dma_irqs[index];
+    HAL_NVIC_SetPriority(sampler->dma_irq, 6, 0);
+    HAL_NVIC_EnableIRQ(sampler->dma_irq);
+
+    g_samplers[index] = sampler;
+}
+
+/*
+ * Starts the DMA, then the timer, so the first sample is taken one timer
+ * period after this is called.
+ *
+ * If sampler_deinit() was called, the sampler is set up again first with the
+ * same settings.
+ */
+void sampler_start(Sampler* sampler) {
+    if (sampler_find(sampler) < 0) {
+        sampler_init(sampler, sampler->timer, sampler->trigger,
+                (volatile void*) sampler->periph_addr, sampler->direction,
+                sampler->sample_size, sampler->buf, sampler->half_count,
+                sampler->callback, sampler->context);
+        if (sampler_find(sampler) < 0) {
+            return;
+        }
+    }
+    sampler->halves_done = 0;
+
+    // HAL_DMA_Init() clears the callbacks, so set them here
+    // The half transfer interrupt is only enabled if its callback is set
+    sampler->dma_handle.XferHalfCpltCallback = sampler_half_cplt_cb;
+    sampler->dma_handle.XferCpltCallback = sampler_cplt_cb;
+    sampler->dma_handle.XferErrorCallback = sampler_error_cb;
+
+    uint32_t src;
+    uint32_t dst;
+    if (sampler->direction == SAMPLER_PERIPH_TO_MEMORY) {
+        src = sampler->periph_addr;
+        dst = (uint32_t) sampler->buf;
+    } else {
+        src = (uint32_t) sampler->buf;
+        dst = sampler->periph_addr;
+    }
+    if (HAL_DMA_Start_IT(&sampler->dma_handle, src, dst,
+            sampler->half_count * 2) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+
+    __HAL_TIM_ENABLE_DMA(&sampler->timer->handle, sampler->trigger);
+    if (timer_start(sampler->timer) != HAL_OK) {
+        Error_Handler();
+        return;
+    }
+    sampler->running = true;
+}
+
+/*
+ * Stops the timer and the DMA. Any samples in the half currently being
+ * transferred are not passed to the callback.
+ */
+void sampler_stop(Sampler* sampler) {
+    timer_stop(sampler->timer);
+    __HAL_TIM_DISABLE_DMA(&sampler->timer->handle, sampler->trigger);
+    HAL_DMA_Abort(&sampler->dma_handle);
+    sampler->running = false;
+}
+
+/*
+ * Stops the sampler if it is running and releases its DMA channel/stream, so
+ * another sampler can use it. Does nothing if the sampler does not hold one.
+ */
+void sampler_deinit(Sampler* sampler) {
+    int32_t index = sampler_find(sampler);
+    if (index < 0) {
+        return;
+    }
+    if (sampler->running) {
+        sampler_stop(sampler);
+    }
+
+    HAL_NVIC_DisableIRQ(sampler->dma_irq);
+    HAL_DMA_DeInit(&sampler->dma_handle);
+
+    // The DMA interrupt reads this, but it is disabled by now
+    g_samplers[index] = NULL;
+}
+
+/*
+ * Returns the index in the buffer (0 to 2 * half_count - 1) of the next sample
+ * the DMA will transfer. This is only valid while the sampler is running, or
+ * after its timer has been stopped but before sampler_stop().
+ */
+uint32_t sampler_get_index(Sampler* sampler) {
+    // The DMA's counter counts down from the number of samples in the buffer,
+    // and is reloaded when it reaches 0
+    uint32_t total = sampler->half_count * 2;
+    uint32_t remaining = __HAL_DMA_GET_COUNTER(&sampler->dma_handle);
+    return (total - remaining) % total;
+}
+
+
+
+
+// -----------------------------------------------------------------------------
+// Interrupt handlers
+
+FAST_CODE static void sampler_irq_handler(uint32_t index) {
+    if (g_samplers[index] == NULL) {
+        return;
+    }
+    STACK_SAMPLE_ISR(sampler_dma_irq);
+    HAL_DMA_IRQHandler(&g_samplers[index]->dma_handle);
+}
+
+#if defined(STM32G4)
+void DMA2_Channel1_IRQHandler(void)
+#elif defined(STM32H7)
+void DMA2_Stream0_IRQHandler(void)
+#endif
+{
+    sampler_irq_handler(0);
+}
+
+#if defined(STM32G4)
+void DMA2_Channel2_IRQHandler(void)
+#elif defined(STM32H7)
+void DMA2_Stream1_IRQHandler(void)
+#endif
+{
+    sampler_irq_handler(1);
+}
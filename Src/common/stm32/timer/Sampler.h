@@ -0,0 +1,71 @@
+/*
+ * Sampler.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_TIMER_SAMPLER_H_
+#define COMMON_STM32_TIMER_SAMPLER_H_
+
+#include <common/stm32/timer/Timer.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Maximum number of samplers running at the same time (one DMA channel/stream
+// each)
+#define SAMPLER_MAX_COUNT 2
+
+typedef enum {
+    // Each timer event copies one sample from the peripheral register into
+    // the buffer (e.g. reading GPIO IDR or an ADC data register)
+    SAMPLER_PERIPH_TO_MEMORY,
+    // Each timer event copies one sample from the buffer into the peripheral
+    // register (e.g. writing GPIO BSRR or a DAC data register)
+    SAMPLER_MEMORY_TO_PERIPH,
+} SamplerDirection;
+
+// Called from the DMA interrupt when one half of the buffer is done (filled
+// for PERIPH_TO_MEMORY, sent for MEMORY_TO_PERIPH), with a pointer to that
+// half and its number of samples
+// The DMA is working on the other half in the meantime, so this half must be
+// processed (or refilled) before the other half is done
+typedef void (*SamplerCB)(void* context, void* half, uint32_t count);
+
+typedef struct {
+    // Timer that generates the DMA requests (one sample per request)
+    Timer* timer;
+    // TIM_DMA_UPDATE or TIM_DMA_CC1
+    uint32_t trigger;
+
+    DMA_HandleTypeDef dma_handle;
+    IRQn_Type dma_irq;
+    SamplerDirection direction;
+    // Address of the peripheral register to read from or write to
+    uint32_t periph_addr;
+
+    // Buffer of 2 * half_count samples, used as two halves
+    uint8_t* buf;
+    uint32_t half_count;
+    // Bytes per sample (1, 2 or 4)
+    uint32_t sample_size;
+
+    SamplerCB callback;
+    void* context;
+
+    // Number of halves completed since the sampler was started
+    volatile uint32_t halves_done;
+    // Number of DMA transfer errors
+    volatile uint32_t errors;
+    bool running;
+} Sampler;
+
+void sampler_init(Sampler* sampler, Timer* timer, uint32_t trigger,
+        volatile void* periph_addr, SamplerDirection direction,
+        uint32_t sample_size, void* buf, uint32_t half_count,
+        SamplerCB callback, void* context);
+void sampler_start(Sampler* sampler);
+void sampler_stop(Sampler* sampler);
+void sampler_deinit(Sampler* sampler);
+uint32_t sampler_get_index(Sampler* sampler);
+
+#endif /* COMMON_STM32_TIMER_SAMPLER_H_ */
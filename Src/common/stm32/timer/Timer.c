@@ -9,18 +9,202 @@ Wrapper for the HAL timer (TIM) drivers. Configured with TIM5 peripheral enabled
 by default. Currently supported are base timers with confiigurations and
 interrupts, for general-purpose and low-power timers.
 
+Channel modes are in separate files, which use a Timer set up here
+  * pulse width modulation (PWM) - PWM.c
+  * input capture (IC) - latch counter value after a signal is recieved,
+    timestamps are copied into a ring by DMA - InputCapture.c
+
 Not currently supported
   * output compare (OC) - modify signal when counter == catch/capture register
-  * pulse width modulation (PWM)
   * OnePulse mode (variant of Oc)
-  * input capture (IC) - latch counter value after a signal is recieved
-  * DMA burst mode
+  * DMA burst mode (single DMA requests on update/CC1 are used by Sampler.c)
   * HRTIM1
 
-Still need to determine which timers will be enabled
+Interrupts: this file defines the IRQ handlers for every timer vector, so
+applications never need to write TIMx_IRQHandler() themselves. timer_init()
+registers the Timer in a table indexed by peripheral, and each handler looks
+up its Timer directly and passes the interrupt to HAL_TIM_IRQHandler() (or the
+Timer's irq_handler, if set). Vectors shared between timers (e.g.
+TIM1_UP_TIM16) check which timer has a pending interrupt.
  */
 
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/mcu/Stack.h>
 #include <common/stm32/timer/Timer.h>
+#include <common/stm32/util/Profile.h>
+
+// Indices into the timer descriptor table
+typedef enum {
+    TIMER_INDEX_TIM1,
+    TIMER_INDEX_TIM2,
+    TIMER_INDEX_TIM3,
+    TIMER_INDEX_TIM4,
+    TIMER_INDEX_TIM5,
+    TIMER_INDEX_TIM6,
+    TIMER_INDEX_TIM7,
+    TIMER_INDEX_TIM8,
+#ifdef STM32H7
+    TIMER_INDEX_TIM12,
+    TIMER_INDEX_TIM13,
+    TIMER_INDEX_TIM14,
+#endif
+    TIMER_INDEX_TIM15,
+    TIMER_INDEX_TIM16,
+    TIMER_INDEX_TIM17,
+#ifdef STM32G4
+    TIMER_INDEX_TIM20,
+#endif
+    TIMER_INDEX_COUNT,
+} TimerIndex;
+
+// Maximum number of interrupt vectors for one timer (advanced-control timers
+// have separate update, capture/compare, break and trigger/commutation
+// vectors)
+#define TIMER_MAX_IRQS 4
+
+// Status flags that can generate an interrupt, which are in the same bit
+// positions in DIER as their interrupt enable bits (update, capture/compare
+// 1-4, commutation, trigger and break)
+#define TIMER_IT_FLAGS_MASK 0xFF
+
+// Everything needed to set up a timer peripheral
+typedef struct {
+    TIM_TypeDef* instance;
+    // RCC register and bit to enable the timer's clock
+    volatile uint32_t* rcc_enr;
+    uint32_t rcc_en_bit;
+    // 1 if the timer is on APB2, 0 if on APB1
+    uint8_t apb2;
+    // Interrupt vectors the timer uses, some of which may be shared with other
+    // timers (see the handlers at the end of this file)
+    IRQn_Type irqs[TIMER_MAX_IRQS];
+    uint32_t irq_count;
+    // DMAMUX request IDs for the update and channel 1-4 capture/compare events
+    // (0 if the timer can't generate that request)
+    uint32_t dma_request_up;
+    uint32_t dma_request_cc[4];
+} TimerDesc;
+
+#ifdef STM32G4
+// RM0440 Section 7.4.16, 7.4.18, Table 97
+static const TimerDesc g_timer_descs[TIMER_INDEX_COUNT] = {
+    [TIMER_INDEX_TIM1] = {TIM1, &RCC->APB2ENR, RCC_APB2ENR_TIM1EN, 1,
+            {TIM1_UP_TIM16_IRQn, TIM1_CC_IRQn, TIM1_BRK_TIM15_IRQn,
+            TIM1_TRG_COM_TIM17_IRQn}, 4,
+            DMA_REQUEST_TIM1_UP, {DMA_REQUEST_TIM1_CH1, DMA_REQUEST_TIM1_CH2,
+            DMA_REQUEST_TIM1_CH3, DMA_REQUEST_TIM1_CH4}},
+    [TIMER_INDEX_TIM2] = {TIM2, &RCC->APB1ENR1, RCC_APB1ENR1_TIM2EN, 0,
+            {TIM2_IRQn}, 1,
+            DMA_REQUEST_TIM2_UP, {DMA_REQUEST_TIM2_CH1, DMA_REQUEST_TIM2_CH2,
+            DMA_REQUEST_TIM2_CH3, DMA_REQUEST_TIM2_CH4}},
+    [TIMER_INDEX_TIM3] = {TIM3, &RCC->APB1ENR1, RCC_APB1ENR1_TIM3EN, 0,
+            {TIM3_IRQn}, 1,
+            DMA_REQUEST_TIM3_UP, {DMA_REQUEST_TIM3_CH1, DMA_REQUEST_TIM3_CH2,
+            DMA_REQUEST_TIM3_CH3, DMA_REQUEST_TIM3_CH4}},
+    [TIMER_INDEX_TIM4] = {TIM4, &RCC->APB1ENR1, RCC_APB1ENR1_TIM4EN, 0,
+            {TIM4_IRQn}, 1,
+            DMA_REQUEST_TIM4_UP, {DMA_REQUEST_TIM4_CH1, DMA_REQUEST_TIM4_CH2,
+            DMA_REQUEST_TIM4_CH3, DMA_REQUEST_TIM4_CH4}},
+    [TIMER_INDEX_TIM5] = {TIM5, &RCC->APB1ENR1, RCC_APB1ENR1_TIM5EN, 0,
+            {TIM5_IRQn}, 1,
+            DMA_REQUEST_TIM5_UP, {DMA_REQUEST_TIM5_CH1, DMA_REQUEST_TIM5_CH2,
+            DMA_REQUEST_TIM5_CH3, DMA_REQUEST_TIM5_CH4}},
+    [TIMER_INDEX_TIM6] = {TIM6, &RCC->APB1ENR1, RCC_APB1ENR1_TIM6EN, 0,
+            {TIM6_DAC_IRQn}, 1,
+            DMA_REQUEST_TIM6_UP, {0}},
+    [TIMER_INDEX_TIM7] = {TIM7, &RCC->APB1ENR1, RCC_APB1ENR1_TIM7EN, 0,
+            {TIM7_DAC_IRQn}, 1,
+            DMA_REQUEST_TIM7_UP, {0}},
+    [TIMER_INDEX_TIM8] = {TIM8, &RCC->APB2ENR, RCC_APB2ENR_TIM8EN, 1,
+            {TIM8_UP_IRQn, TIM8_CC_IRQn, TIM8_BRK_IRQn, TIM8_TRG_COM_IRQn}, 4,
+            DMA_REQUEST_TIM8_UP, {DMA_REQUEST_TIM8_CH1, DMA_REQUEST_TIM8_CH2,
+            DMA_REQUEST_TIM8_CH3, DMA_REQUEST_TIM8_CH4}},
+    [TIMER_INDEX_TIM15] = {TIM15, &RCC->APB2ENR, RCC_APB2ENR_TIM15EN, 1,
+            {TIM1_BRK_TIM15_IRQn}, 1,
+            DMA_REQUEST_TIM15_UP, {DMA_REQUEST_TIM15_CH1}},
+    [TIMER_INDEX_TIM16] = {TIM16, &RCC->APB2ENR, RCC_APB2ENR_TIM16EN, 1,
+            {TIM1_UP_TIM16_IRQn}, 1,
+            DMA_REQUEST_TIM16_UP, {DMA_REQUEST_TIM16_CH1}},
+    [TIMER_INDEX_TIM17] = {TIM17, &RCC->APB2ENR, RCC_APB2ENR_TIM17EN, 1,
+            {TIM1_TRG_COM_TIM17_IRQn}, 1,
+            DMA_REQUEST_TIM17_UP, {DMA_REQUEST_TIM17_CH1}},
+    [TIMER_INDEX_TIM20] = {TIM20, &RCC->APB2ENR, RCC_APB2ENR_TIM20EN, 1,
+            {TIM20_UP_IRQn, TIM20_CC_IRQn, TIM20_BRK_IRQn,
+            TIM20_TRG_COM_IRQn}, 4,
+            DMA_REQUEST_TIM20_UP, {DMA_REQUEST_TIM20_CH1, DMA_REQUEST_TIM20_CH2,
+            DMA_REQUEST_TIM20_CH3, DMA_REQUEST_TIM20_CH4}},
+};
+#elif defined(STM32H7)
+// RM0433 Section 8.7.41, 8.7.44, Table 143
+static const TimerDesc g_timer_descs[TIMER_INDEX_COUNT] = {
+    [TIMER_INDEX_TIM1] = {TIM1, &RCC->APB2ENR, RCC_APB2ENR_TIM1EN, 1,
+            {TIM1_UP_IRQn, TIM1_CC_IRQn, TIM1_BRK_IRQn, TIM1_TRG_COM_IRQn}, 4,
+            DMA_REQUEST_TIM1_UP, {DMA_REQUEST_TIM1_CH1, DMA_REQUEST_TIM1_CH2,
+            DMA_REQUEST_TIM1_CH3, DMA_REQUEST_TIM1_CH4}},
+    [TIMER_INDEX_TIM2] = {TIM2, &RCC->APB1LENR, RCC_APB1LENR_TIM2EN, 0,
+            {TIM2_IRQn}, 1,
+            DMA_REQUEST_TIM2_UP, {DMA_REQUEST_TIM2_CH1, DMA_REQUEST_TIM2_CH2,
+            DMA_REQUEST_TIM2_CH3, DMA_REQUEST_TIM2_CH4}},
+    [TIMER_INDEX_TIM3] = {TIM3, &RCC->APB1LENR, RCC_APB1LENR_TIM3EN, 0,
+            {TIM3_IRQn}, 1,
+            DMA_REQUEST_TIM3_UP, {DMA_REQUEST_TIM3_CH1, DMA_REQUEST_TIM3_CH2,
+            DMA_REQUEST_TIM3_CH3, DMA_REQUEST_TIM3_CH4}},
+    [TIMER_INDEX_TIM4] = {TIM4, &RCC->APB1LENR, RCC_APB1LENR_TIM4EN, 0,
+            {TIM4_IRQn}, 1,
+            DMA_REQUEST_TIM4_UP, {DMA_REQUEST_TIM4_CH1, DMA_REQUEST_TIM4_CH2,
+            DMA_REQUEST_TIM4_CH3, 0}},
+    [TIMER_INDEX_TIM5] = {TIM5, &RCC->APB1LENR, RCC_APB1LENR_TIM5EN, 0,
+            {TIM5_IRQn}, 1,
+            DMA_REQUEST_TIM5_UP, {DMA_REQUEST_TIM5_CH1, DMA_REQUEST_TIM5_CH2,
+            DMA_REQUEST_TIM5_CH3, DMA_REQUEST_TIM5_CH4}},
+    [TIMER_INDEX_TIM6] = {TIM6, &RCC->APB1LENR, RCC_APB1LENR_TIM6EN, 0,
+            {TIM6_DAC_IRQn}, 1,
+            DMA_REQUEST_TIM6_UP, {0}},
+    [TIMER_INDEX_TIM7] = {TIM7, &RCC->APB1LENR, RCC_APB1LENR_TIM7EN, 0,
+            {TIM7_IRQn}, 1,
+            DMA_REQUEST_TIM7_UP, {0}},
+    [TIMER_INDEX_TIM8] = {TIM8, &RCC->APB2ENR, RCC_APB2ENR_TIM8EN, 1,
+            {TIM8_UP_TIM13_IRQn, TIM8_CC_IRQn, TIM8_BRK_TIM12_IRQn,
+            TIM8_TRG_COM_TIM14_IRQn}, 4,
+            DMA_REQUEST_TIM8_UP, {DMA_REQUEST_TIM8_CH1, DMA_REQUEST_TIM8_CH2,
+            DMA_REQUEST_TIM8_CH3, DMA_REQUEST_TIM8_CH4}},
+    [TIMER_INDEX_TIM12] = {TIM12, &RCC->APB1LENR, RCC_APB1LENR_TIM12EN, 0,
+            {TIM8_BRK_TIM12_IRQn}, 1,
+            0, {0}},
+    [TIMER_INDEX_TIM13] = {TIM13, &RCC->APB1LENR, RCC_APB1LENR_TIM13EN, 0,
+            {TIM8_UP_TIM13_IRQn}, 1,
+            0, {0}},
+    [TIMER_INDEX_TIM14] = {TIM14, &RCC->APB1LENR, RCC_APB1LENR_TIM14EN, 0,
+            {TIM8_TRG_COM_TIM14_IRQn}, 1,
+            0, {0}},
+    [TIMER_INDEX_TIM15] = {TIM15, &RCC->APB2ENR, RCC_APB2ENR_TIM15EN, 1,
+            {TIM15_IRQn}, 1,
+            DMA_REQUEST_TIM15_UP, {DMA_REQUEST_TIM15_CH1}},
+    [TIMER_INDEX_TIM16] = {TIM16, &RCC->APB2ENR, RCC_APB2ENR_TIM16EN, 1,
+            {TIM16_IRQn}, 1,
+            DMA_REQUEST_TIM16_UP, {DMA_REQUEST_TIM16_CH1}},
+    [TIMER_INDEX_TIM17] = {TIM17, &RCC->APB2ENR, RCC_APB2ENR_TIM17EN, 1,
+            {TIM17_IRQn}, 1,
+            DMA_REQUEST_TIM17_UP, {DMA_REQUEST_TIM17_CH1}},
+};
+#endif
+
+// Timer registered to receive each timer peripheral's interrupts (NULL if none)
+// Indexed the same as g_timer_descs, so the interrupt handlers can find their
+// Timer without searching
+FAST_BSS static Timer* g_timer_owners[TIMER_INDEX_COUNT] = {NULL};
+
+// Returns the index of a timer peripheral in g_timer_descs, or -1 if it is
+// not a supported timer
+static int32_t timer_find_desc(TIM_TypeDef* instance) {
+    for (int32_t i = 0; i < TIMER_INDEX_COUNT; i++) {
+        if (g_timer_descs[i].instance == instance) {
+            return i;
+        }
+    }
+    return -1;
+}
 
 // Initializes the timer struct (with TIM5 by default), and optionally enables interrupts.
 void timer_setup(Timer* timer, uint32_t prescaler, uint32_t period,
@@ -38,6 +222,9 @@ void timer_setup(Timer* timer, uint32_t prescaler, uint32_t period,
     TIM_HandleTypeDef blank_handle = {.Instance = TIM5, .Init = base_timer};
     timer->handle = blank_handle;
     timer->interrupts_enabled = it_enabled;
+    timer->irq_handler = NULL;
+    timer->solved_num = 0;
+    timer->solved_den = 0;
 }
 
 /* Add additional customizations to the timer driver
@@ -55,6 +242,8 @@ void timer_customize(Timer* timer, TIM_TypeDef* timer_reg, uint8_t count_up,
     
     if (timer_reg != NULL) {
         timer->handle.Instance = timer_reg;
+        // The clock and counter size may be different, so solve again
+        timer->solved_den = 0;
     }
     if (count_up) {
         timer->handle.Init.CounterMode = TIM_COUNTERMODE_UP;
@@ -81,6 +270,10 @@ HAL_StatusTypeDef timer_init(Timer* timer) {
 
 // Deinitializes the timer after it has been stopped
 HAL_StatusTypeDef timer_deinit(Timer* timer) {
+    int32_t index = timer_find_desc(timer->handle.Instance);
+    if (index >= 0 && g_timer_owners[index] == timer) {
+        g_timer_owners[index] = NULL;
+    }
     return HAL_TIM_Base_DeInit(&(timer->handle));
 }
 
@@ -103,68 +296,414 @@ HAL_StatusTypeDef timer_stop(Timer* timer) {
     }
 }
 
-// Enables the timer's clock and interrupt handler
+/* Returns the frequency (in Hz) of the clock going into the timer's prescaler
+(i.e. the frequency the counter would run at with a prescaler of 0)
+
+Timers are clocked from their APB bus clock, but if the APB prescaler is not 1
+the timer clock is doubled (RM0440 Figure 16, RM0433 Table 55). On the H7, the
+TIMPRE bit can also make it run at up to 4 times the APB clock.
+*/
+uint32_t timer_get_input_clock_freq(Timer* timer) {
+    int32_t index = timer_find_desc(timer->handle.Instance);
+    if (index < 0) {
+        Error_Handler();
+        return 0;
+    }
+    uint8_t apb2 = g_timer_descs[index].apb2;
+
+    uint32_t pclk;
+    uint32_t apb_prescaler_bits;
+#ifdef STM32G4
+    if (apb2) {
+        pclk = HAL_RCC_GetPCLK2Freq();
+        apb_prescaler_bits = RCC->CFGR & RCC_CFGR_PPRE2;
+    } else {
+        pclk = HAL_RCC_GetPCLK1Freq();
+        apb_prescaler_bits = RCC->CFGR & RCC_CFGR_PPRE1;
+    }
+#elif defined(STM32H7)
+    if (apb2) {
+        pclk = HAL_RCC_GetPCLK2Freq();
+        apb_prescaler_bits = RCC->D2CFGR & RCC_D2CFGR_D2PPRE2;
+    } else {
+        pclk = HAL_RCC_GetPCLK1Freq();
+        apb_prescaler_bits = RCC->D2CFGR & RCC_D2CFGR_D2PPRE1;
+    }
+
+    if (RCC->CFGR & RCC_CFGR_TIMPRE) {
+        uint32_t hclk = HAL_RCC_GetHCLKFreq();
+        // With TIMPRE set, the timers run at 4 times the APB clock, but no
+        // faster than HCLK
+        if ((uint64_t) pclk * 4 > hclk) {
+            return hclk;
+        }
+        return pclk * 4;
+    }
+#endif
+
+    // A prescaler field of 0 means the APB clock is not divided
+    if (apb_prescaler_bits == 0) {
+        return pclk;
+    }
+    return pclk * 2;
+}
+
+// Number of prescaler values timer_solve() tries above the smallest one that
+// fits, looking for a more exact period (it stops early once the period is as
+// exact as possible)
+#define TIMER_SOLVER_MAX_PRESCALERS 1024
+
+/* Picks the prescaler and period for the timer's update rate to be as close as
+possible to num / den timer clock cycles, and stores them in the handle's Init
+(without writing them to the timer)
+
+The counter range is 16 or 32 bits depending on the timer. The smallest
+prescaler that fits is tried first, then larger ones in case some other
+prescaler/period product is closer to the target (e.g. when the number of
+cycles has no factor that fits in 16 bits), keeping the smallest prescaler for
+the best resolution when they are equally close.
+
+Returns 1 on success, or 0 if the rate can't be reached
+*/
+static uint8_t timer_solve(Timer* timer, uint64_t num, uint64_t den) {
+    uint64_t max_count =
+            IS_TIM_32B_COUNTER_INSTANCE(timer->handle.Instance) ?
+            0x100000000ULL : 0x10000ULL;
+    // The counter needs to count at least 2 values (period of at least 1)
+    if (den == 0 || num < den * 2) {
+        return 0;
+    }
+
+    // Smallest prescaler (plus 1) with (prescaler + 1) * max_count >= cycles
+    uint64_t ceil_cycles = (num + den - 1) / den;
+    uint64_t min_div = (ceil_cycles + max_count - 1) / max_count;
+    if (min_div > 0x10000) {
+        return 0;
+    }
+    uint64_t max_div = min_div + TIMER_SOLVER_MAX_PRESCALERS - 1;
+    if (max_div > 0x10000) {
+        max_div = 0x10000;
+    }
+
+    uint64_t best_div = 0;
+    uint64_t best_count = 0;
+    uint64_t best_error = UINT64_MAX;
+    for (uint64_t div = min_div; div <= max_div; div++) {
+        uint64_t step = den * div;
+        uint64_t count = (num + (step / 2)) / step;
+        if (count < 2) {
+            break;
+        }
+        if (count > max_count) {
+            count = max_count;
+        }
+        uint64_t total = count * step;
+        uint64_t error = (total > num) ? (total - num) : (num - total);
+        if (error < best_error) {
+            best_div = div;
+            best_count = count;
+            best_error = error;
+        }
+        // Can't get closer than the nearest whole number of cycles
+        if (best_error * 2 <= den) {
+            break;
+        }
+    }
+    if (best_div == 0) {
+        return 0;
+    }
+
+    timer->handle.Init.Prescaler = (uint32_t) (best_div - 1);
+    timer->handle.Init.Period = (uint32_t) (best_count - 1);
+    return 1;
+}
+
+/* Sets the timer's update rate to num / den timer clock cycles, reusing the
+previous result if it was solved for the same rate and timer clock
+
+If the timer is already initialized, the new prescaler and period are written
+to it. They are preloaded, so if the timer is running they take effect at the
+next update without a glitch.
+
+Returns 1 on success, or 0 if the rate can't be reached
+*/
+static uint8_t timer_apply_rate(Timer* timer, uint64_t num, uint64_t den) {
+    if (timer->solved_den == 0 || timer->solved_num != num ||
+            timer->solved_den != den) {
+        if (!timer_solve(timer, num, den)) {
+            return 0;
+        }
+        timer->solved_num = num;
+        timer->solved_den = den;
+    }
+
+    if (timer->handle.State != HAL_TIM_STATE_RESET) {
+        __HAL_TIM_SET_PRESCALER(&(timer->handle), timer->handle.Init.Prescaler);
+        __HAL_TIM_SET_AUTORELOAD(&(timer->handle), timer->handle.Init.Period);
+        // The prescaler is only loaded on an update event, so generate one now
+        // if the counter isn't running
+        if ((timer->handle.Instance->CR1 & TIM_CR1_CEN) == 0) {
+            timer->handle.Instance->EGR = TIM_EGR_UG;
+            __HAL_TIM_CLEAR_FLAG(&(timer->handle), TIM_FLAG_UPDATE);
+        }
+    }
+    return 1;
+}
+
+/* Sets the prescaler and period so the timer updates (and interrupts, if
+enabled) at freq_hz, calculated from the current clock tree instead of a
+hardcoded timer clock. Call after timer_setup() and timer_customize() (the
+counter size depends on the timer), before or after timer_init().
+
+Returns the actual frequency (rounded to the nearest Hz), which can differ from
+freq_hz since the period is a whole number of timer clock cycles (see
+timer_get_freq() for the exact value), or 0 if freq_hz can't be reached
+*/
+uint32_t timer_setup_hz(Timer* timer, uint32_t freq_hz) {
+    if (!timer_apply_rate(timer, timer_get_input_clock_freq(timer), freq_hz)) {
+        return 0;
+    }
+    return (uint32_t) (timer_get_freq(timer) + 0.5f);
+}
+
+/* Same as timer_setup_hz(), but with the time between updates in microseconds
+(for rates that aren't a whole number of Hz, including below 1 Hz)
+
+Returns the actual period (rounded to the nearest microsecond), or 0 if
+period_us can't be reached
+*/
+uint32_t timer_setup_period_us(Timer* timer, uint32_t period_us) {
+    uint64_t num = (uint64_t) timer_get_input_clock_freq(timer) * period_us;
+    if (!timer_apply_rate(timer, num, 1000000)) {
+        return 0;
+    }
+    uint64_t cycles = ((uint64_t) timer->handle.Init.Prescaler + 1) *
+            ((uint64_t) timer->handle.Init.Period + 1);
+    uint32_t input_freq = timer_get_input_clock_freq(timer);
+    return (uint32_t) (((cycles * 1000000) + (input_freq / 2)) / input_freq);
+}
+
+/* Returns the timer's update frequency in Hz, from its prescaler, period and
+the current clock tree
+*/
+float timer_get_freq(Timer* timer) {
+    uint64_t cycles = ((uint64_t) timer->handle.Init.Prescaler + 1) *
+            ((uint64_t) timer->handle.Init.Period + 1);
+    return (float) timer_get_input_clock_freq(timer) / (float) cycles;
+}
+
+/* Returns the DMAMUX request ID for a timer DMA request, to be used as the
+DMA's Init.Request
+
+uint32_t tim_dma_source: TIM_DMA_UPDATE or TIM_DMA_CC1-TIM_DMA_CC4 (the same
+                         value passed to __HAL_TIM_ENABLE_DMA() to enable the
+                         request)
+Returns 0 if the timer can't generate that request
+*/
+uint32_t timer_get_dma_request(Timer* timer, uint32_t tim_dma_source) {
+    int32_t index = timer_find_desc(timer->handle.Instance);
+    if (index < 0) {
+        return 0;
+    }
+    if (tim_dma_source == TIM_DMA_UPDATE) {
+        return g_timer_descs[index].dma_request_up;
+    }
+    if (tim_dma_source == TIM_DMA_CC1) {
+        return g_timer_descs[index].dma_request_cc[0];
+    }
+    if (tim_dma_source == TIM_DMA_CC2) {
+        return g_timer_descs[index].dma_request_cc[1];
+    }
+    if (tim_dma_source == TIM_DMA_CC3) {
+        return g_timer_descs[index].dma_request_cc[2];
+    }
+    if (tim_dma_source == TIM_DMA_CC4) {
+        return g_timer_descs[index].dma_request_cc[3];
+    }
+    return 0;
+}
+
+// Enables the timer's clock and interrupt handler(s), and registers the timer
+// to receive its interrupts
 void timer_init_clock_irq(Timer* timer) {
-    if(timer->handle.Instance==TIM2){
-		__HAL_RCC_TIM2_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM2_IRQn);
-	}else if(timer->handle.Instance==TIM3){
-		__HAL_RCC_TIM3_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM3_IRQn);
-	}else if(timer->handle.Instance==TIM4){
-		__HAL_RCC_TIM4_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM4_IRQn);
-	}else if(timer->handle.Instance==TIM5){
-		__HAL_RCC_TIM5_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM5_IRQn);
-	}else if(timer->handle.Instance==TIM6){
-		__HAL_RCC_TIM6_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM6_DAC_IRQn);
-	}
-
-	// MCU-specific timers
-#ifdef STM32G474xx
-	if (timer->handle.Instance==TIM1){
-		__HAL_RCC_TIM1_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM1_UP_TIM16_IRQn);
-	}else if(timer->handle.Instance==TIM7){
-		__HAL_RCC_TIM7_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM7_DAC_IRQn);
-	}else if(timer->handle.Instance==TIM15){
-		__HAL_RCC_TIM15_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM1_BRK_TIM15_IRQn);
-	}else if(timer->handle.Instance==TIM16){
-		__HAL_RCC_TIM16_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM1_UP_TIM16_IRQn);
-	}else if(timer->handle.Instance==TIM17){
-		__HAL_RCC_TIM17_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM1_TRG_COM_TIM17_IRQn);
-	}else if(timer->handle.Instance==TIM20){
-		__HAL_RCC_TIM20_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM20_UP_IRQn);
-	}
-#elif defined(STM32H743xx)
-	if(timer->handle.Instance==TIM1){
-		__HAL_RCC_TIM1_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM1_UP_IRQn);
-	}else if(timer->handle.Instance==TIM7){
-		__HAL_RCC_TIM7_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM7_IRQn);
-	}else if(timer->handle.Instance==TIM12){
-		__HAL_RCC_TIM12_CLK_ENABLE();
-	}else if(timer->handle.Instance==TIM13){
-		__HAL_RCC_TIM13_CLK_ENABLE();
-	}else if(timer->handle.Instance==TIM14){
-		__HAL_RCC_TIM14_CLK_ENABLE();
-	}else if(timer->handle.Instance==TIM15){
-		__HAL_RCC_TIM15_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM15_IRQn);
-	}else if(timer->handle.Instance==TIM16){
-		__HAL_RCC_TIM16_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM16_IRQn);
-	}else if(timer->handle.Instance==TIM17){
-		__HAL_RCC_TIM17_CLK_ENABLE();
-		HAL_NVIC_EnableIRQ(TIM17_IRQn);
-	}
+    int32_t index = timer_find_desc(timer->handle.Instance);
+    if (index < 0) {
+        Error_Handler();
+        return;
+    }
+    const TimerDesc* desc = &g_timer_descs[index];
+
+    *desc->rcc_enr |= desc->rcc_en_bit;
+    // Read back the register so the clock is running before the timer is
+    // accessed (same as the __HAL_RCC_TIMx_CLK_ENABLE() macros)
+    volatile uint32_t tmpreg = *desc->rcc_enr & desc->rcc_en_bit;
+    (void) tmpreg;
+
+    g_timer_owners[index] = timer;
+    for (uint32_t i = 0; i < desc->irq_count; i++) {
+        HAL_NVIC_EnableIRQ(desc->irqs[i]);
+    }
+}
+
+
+
+
+// -----------------------------------------------------------------------------
+// Interrupt handlers
+
+/*
+ * Passes an interrupt to the timer registered for it.
+ */
+FAST_CODE static void timer_dispatch(TimerIndex index) {
+    Timer* timer = g_timer_owners[index];
+    if (timer == NULL) {
+        return;
+    }
+
+    // All timer interrupts are measured as one zone
+    STACK_SAMPLE_ISR(timer_irq);
+    PROFILE_BEGIN(timer_irq);
+    if (timer->irq_handler != NULL) {
+        timer->irq_handler(timer);
+    } else {
+        HAL_TIM_IRQHandler(&timer->handle);
+    }
+    PROFILE_END(timer_irq);
+}
+
+/*
+ * For vectors shared by multiple timers: only passes the interrupt to the
+ * timer if one of its enabled interrupts is pending.
+ */
+static void timer_dispatch_if_pending(TimerIndex index) {
+    Timer* timer = g_timer_owners[index];
+    if (timer == NULL) {
+        return;
+    }
+
+    TIM_TypeDef* instance = timer->handle.Instance;
+    if ((instance->SR & instance->DIER & TIMER_IT_FLAGS_MASK) != 0) {
+        timer_dispatch(index);
+    }
+}
+
+void TIM2_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM2);
+}
+
+void TIM3_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM3);
+}
+
+void TIM4_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM4);
+}
+
+void TIM5_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM5);
+}
+
+// Shared with the DAC underrun interrupt, which is not used
+void TIM6_DAC_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM6);
+}
+
+void TIM1_CC_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM1);
+}
+
+void TIM8_CC_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM8);
+}
+
+#ifdef STM32G4
+void TIM7_DAC_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM7);
+}
+
+void TIM1_UP_TIM16_IRQHandler(void) {
+    timer_dispatch_if_pending(TIMER_INDEX_TIM1);
+    timer_dispatch_if_pending(TIMER_INDEX_TIM16);
+}
+
+void TIM1_BRK_TIM15_IRQHandler(void) {
+    timer_dispatch_if_pending(TIMER_INDEX_TIM1);
+    timer_dispatch_if_pending(TIMER_INDEX_TIM15);
+}
+
+void TIM1_TRG_COM_TIM17_IRQHandler(void) {
+    timer_dispatch_if_pending(TIMER_INDEX_TIM1);
+    timer_dispatch_if_pending(TIMER_INDEX_TIM17);
+}
+
+void TIM8_UP_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM8);
+}
+
+void TIM8_BRK_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM8);
+}
+
+void TIM8_TRG_COM_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM8);
+}
+
+void TIM20_UP_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM20);
+}
+
+void TIM20_CC_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM20);
+}
+
+void TIM20_BRK_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM20);
+}
+
+void TIM20_TRG_COM_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM20);
+}
+#elif defined(STM32H7)
+void TIM7_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM7);
+}
+
+void TIM1_UP_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM1);
+}
+
+void TIM1_BRK_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM1);
+}
+
+void TIM1_TRG_COM_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM1);
+}
+
+void TIM8_UP_TIM13_IRQHandler(void) {
+    timer_dispatch_if_pending(TIMER_INDEX_TIM8);
+    timer_dispatch_if_pending(TIMER_INDEX_TIM13);
+}
+
+void TIM8_BRK_TIM12_IRQHandler(void) {
+    timer_dispatch_if_pending(TIMER_INDEX_TIM8);
+    timer_dispatch_if_pending(TIMER_INDEX_TIM12);
+}
+
+void TIM8_TRG_COM_TIM14_IRQHandler(void) {
+    timer_dispatch_if_pending(TIMER_INDEX_TIM8);
+    timer_dispatch_if_pending(TIMER_INDEX_TIM14);
+}
+
+void TIM15_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM15);
+}
+
+void TIM16_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM16);
+}
+
+void TIM17_IRQHandler(void) {
+    timer_dispatch(TIMER_INDEX_TIM17);
+}
 #endif
-}
\ No newline at end of file
@@ -13,10 +13,19 @@ Header file for timer driver.
 
 #include <common/stm32/mcu/MCU.h>
 
-typedef struct {
+typedef struct Timer {
     TIM_HandleTypeDef handle; // Includes TIM_Base_InitTypeDef
     TIM_ClockConfigTypeDef clock_config;
     uint8_t interrupts_enabled;
+    // Called from the timer's interrupt instead of HAL_TIM_IRQHandler() if not
+    // NULL (for drivers that handle the timer's flags themselves)
+    void (*irq_handler)(struct Timer* timer);
+    // Rate last set by timer_setup_hz()/timer_setup_period_us(), as
+    // solved_num / solved_den timer clock cycles per update (solved_den is 0
+    // if not set), so the prescaler and period are only solved again if the
+    // rate or timer clock changes
+    uint64_t solved_num;
+    uint64_t solved_den;
 } Timer;
 
 void timer_setup(Timer* timer, uint32_t prescaler,
@@ -29,6 +38,11 @@ HAL_StatusTypeDef timer_deinit(Timer* timer);
 
 HAL_StatusTypeDef timer_start(Timer* timer);
 HAL_StatusTypeDef timer_stop(Timer* timer);
+uint32_t timer_get_input_clock_freq(Timer* timer);
+uint32_t timer_setup_hz(Timer* timer, uint32_t freq_hz);
+uint32_t timer_setup_period_us(Timer* timer, uint32_t period_us);
+float timer_get_freq(Timer* timer);
+uint32_t timer_get_dma_request(Timer* timer, uint32_t tim_dma_source);
 void timer_init_clock_irq(Timer* timer);
 
 #endif /* COMMON_STM32_TIMER_TIMER_H_ */
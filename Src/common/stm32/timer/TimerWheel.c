@@ -0,0 +1,424 @@
+/*
+ * TimerWheel.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Hierarchical timer wheel, for running any number of one-shot and periodic
+ * software timers from a single hardware timer.
+ *
+ * timer_setup_callback() can only register one callback per hardware timer, so
+ * without this every periodic job would need its own TIMx peripheral. Instead,
+ * the wheel keeps all the software timers sorted (roughly) by expiry time and
+ * only asks the hardware to interrupt at the next time something needs to
+ * happen, using the clock's alarm (see Clock.c). There is no periodic tick, so
+ * the CPU is not interrupted at all while nothing is due.
+ *
+ * Structure: there are TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots,
+ * each slot holding a linked list of entries. Level L slots are 64^L ticks
+ * wide, so level 0 has one slot per tick for the next 64 ticks, level 1 has
+ * one slot per 64 ticks for the next 4096 ticks, and so on. An entry is put in
+ * the lowest level that can reach its expiry time, in the slot given by the
+ * bits of its expiry time for that level. When the time reaches the start of
+ * a higher-level slot, its entries are "cascaded" (moved down to the lower
+ * levels, which now have enough range to hold them), until they end up in
+ * level 0 and expire.
+ *
+ * - Starting a timer is O(1): pick the level from the highest set bit of the
+ *   delay, then push onto that slot's list
+ * - Cancelling is O(1): unlink from the list
+ * - Finding the next time anything happens is O(levels): each level has a
+ *   bitmap of which slots are non-empty, so the next non-empty slot can be
+ *   found by counting trailing zeros instead of checking every slot
+ * - Each entry is cascaded at most once per level before it expires
+ *
+ * The wheel can run on the clock (timer_wheel_init()), where ticks are us and
+ * callbacks are called from the clock's timer interrupt, or be advanced
+ * manually with timer_wheel_advance() (timer_wheel_init_manual()), e.g. from
+ * the main loop or for testing with a simulated time.
+ */
+
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/timer/Clock.h>
+#include <common/stm32/timer/TimerWheel.h>
+
+
+/*
+ * Disables interrupts so the wheel can't be modified by an ISR (e.g. the clock
+ * alarm) in the middle of an update. Returns the previous state, to be passed
+ * to timer_wheel_unlock().
+ */
+static inline uint32_t timer_wheel_lock(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static inline void timer_wheel_unlock(uint32_t primask) {
+    __set_PRIMASK(primask);
+}
+
+/*
+ * Puts an (unlinked) entry into the slot for its expiry time.
+ */
+static void timer_wheel_link(TimerWheel* wheel, TimerWheelEntry* entry) {
+    // A time that has already been processed would never be reached, so run
+    // the entry at the next tick instead
+    if (entry->expiry < wheel->base) {
+        entry->expiry = wheel->base;
+    }
+
+    uint64_t slot_time = entry->expiry;
+    uint64_t delta = slot_time - wheel->base;
+    uint32_t level = 0;
+    if (delta >= TIMER_WHEEL_SLOTS) {
+        // Index of the highest set bit, divided by the bits per level
+        uint32_t msb = 63 - __builtin_clzll(delta);
+        level = msb / TIMER_WHEEL_SLOT_BITS;
+
+        if (level >= TIMER_WHEEL_LEVELS) {
+            // Further away than the top level can reach, so put it in the
+            // furthest slot; it will be cascaded back into the top level when
+            // that slot is reached
+            level = TIMER_WHEEL_LEVELS - 1;
+            slot_time = wheel->base +
+                    (((uint64_t) 1) << (TIMER_WHEEL_SLOT_BITS *
+                            TIMER_WHEEL_LEVELS)) - 1;
+        }
+    }
+    uint32_t slot = (slot_time >> (level * TIMER_WHEEL_SLOT_BITS)) &
+            (TIMER_WHEEL_SLOTS - 1);
+
+    TimerWheelEntry** head = &wheel->slots[level][slot];
+    entry->next = *head;
+    if (entry->next != NULL) {
+        entry->next->pprev = &entry->next;
+    }
+    entry->pprev = head;
+    *head = entry;
+
+    entry->level = level;
+    entry->slot = slot;
+    wheel->occupied[level] |= ((uint64_t) 1) << slot;
+}
+
+/*
+ * Removes an entry from whichever list it is in.
+ */
+static void timer_wheel_unlink(TimerWheel* wheel, TimerWheelEntry* entry) {
+    *entry->pprev = entry->next;
+    if (entry->next != NULL) {
+        entry->next->pprev = entry->pprev;
+    }
+    entry->next = NULL;
+    entry->pprev = NULL;
+
+    if (wheel->slots[entry->level][entry->slot] == NULL) {
+        wheel->occupied[entry->level] &= ~(((uint64_t) 1) << entry->slot);
+    }
+}
+
+/*
+ * Takes all entries out of a slot, returning them as a list.
+ * The first entry's pprev is pointed at `list` so entries can still be
+ * unlinked (e.g. cancelled by a callback) while the list is being processed.
+ */
+static void timer_wheel_take_slot(TimerWheel* wheel, uint32_t level,
+        uint32_t slot, TimerWheelEntry** list) {
+    *list = wheel->slots[level][slot];
+    if (*list != NULL) {
+        (*list)->pprev = list;
+    }
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~(((uint64_t) 1) << slot);
+}
+
+/*
+ * Finds the first time (>= base) when a non-empty slot in a level is reached.
+ * Returns false if the level is empty.
+ */
+static bool timer_wheel_level_event(TimerWheel* wheel, uint32_t level,
+        uint64_t* time) {
+    uint64_t occupied = wheel->occupied[level];
+    if (occupied == 0) {
+        return false;
+    }
+
+    uint32_t shift = level * TIMER_WHEEL_SLOT_BITS;
+    uint64_t slot_width = ((uint64_t) 1) << shift;
+    // Start of the first slot at or after base
+    uint64_t start = (wheel->base + slot_width - 1) & ~(slot_width - 1);
+    uint32_t start_slot = (start >> shift) & (TIMER_WHEEL_SLOTS - 1);
+
+    // Rotate the bitmap so bit 0 is start_slot, then the number of trailing
+    // zeros is how many slots after start_slot the next non-empty one is
+    if (start_slot != 0) {
+        occupied = (occupied >> start_slot) |
+                (occupied << (TIMER_WHEEL_SLOTS - start_slot));
+    }
+    uint64_t slots_ahead = __builtin_ctzll(occupied);
+
+    *time = start + (slots_ahead << shift);
+    return true;
+}
+
+/*
+ * Finds the next time the wheel needs to be advanced to (the earliest expiry
+ * or cascade) without locking.
+ */
+static bool timer_wheel_next_event_unlocked(TimerWheel* wheel,
+        uint64_t* time) {
+    bool found = false;
+    for (uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t level_time;
+        if (timer_wheel_level_event(wheel, level, &level_time) &&
+                (!found || level_time < *time)) {
+            *time = level_time;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static void timer_wheel_alarm_cb(void* context) {
+    TimerWheel* wheel = (TimerWheel*) context;
+    timer_wheel_advance(wheel, clock_now_us());
+}
+
+/*
+ * If running on the clock, sets the clock's alarm for the next time the wheel
+ * needs to be advanced.
+ */
+static void timer_wheel_update_alarm(TimerWheel* wheel) {
+    if (!wheel->use_clock) {
+        return;
+    }
+
+    uint64_t time;
+    if (timer_wheel_next_event_unlocked(wheel, &time)) {
+        clock_set_alarm(time, timer_wheel_alarm_cb, wheel);
+    } else {
+        clock_cancel_alarm();
+    }
+}
+
+/*
+ * Returns the current time in ticks, for calculating expiry times.
+ */
+static uint64_t timer_wheel_now(TimerWheel* wheel) {
+    if (wheel->use_clock) {
+        return clock_now_us();
+    }
+    return wheel->now;
+}
+
+static void timer_wheel_clear(TimerWheel* wheel, uint64_t now) {
+    for (uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (uint32_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            wheel->slots[level][slot] = NULL;
+        }
+        wheel->occupied[level] = 0;
+    }
+    wheel->base = now;
+    wheel->now = now;
+    wheel->count = 0;
+}
+
+/*
+ * Initializes a wheel that runs on the clock (ticks are us). clock_init()
+ * must have been called first.
+ *
+ * The wheel takes over the clock's alarm, so only one wheel can run on the
+ * clock. Callbacks are called from the clock's timer interrupt, which has the
+ * highest priority, so they should be short.
+ */
+void timer_wheel_init(TimerWheel* wheel) {
+    if (g_clock_def == NULL) {
+        Error_Handler();
+        return;
+    }
+
+    timer_wheel_clear(wheel, clock_now_us());
+    wheel->use_clock = true;
+}
+
+/*
+ * Initializes a wheel that is advanced by calling timer_wheel_advance(),
+ * starting at time `now` (in whatever units of ticks the caller chooses).
+ * Callbacks are called from timer_wheel_advance().
+ */
+void timer_wheel_init_manual(TimerWheel* wheel, uint64_t now) {
+    timer_wheel_clear(wheel, now);
+    wheel->use_clock = false;
+}
+
+void timer_wheel_entry_init(TimerWheelEntry* entry, TimerWheelCB callback,
+        void* context) {
+    entry->next = NULL;
+    entry->pprev = NULL;
+    entry->expiry = 0;
+    entry->period = 0;
+    entry->callback = callback;
+    entry->context = context;
+    entry->level = 0;
+    entry->slot = 0;
+    entry->active = false;
+}
+
+/*
+ * Starts (or restarts) a timer. period is 0 for a one-shot timer.
+ */
+static void timer_wheel_start(TimerWheel* wheel, TimerWheelEntry* entry,
+        uint32_t delay, uint32_t period) {
+    uint32_t primask = timer_wheel_lock();
+
+    if (entry->active) {
+        timer_wheel_unlink(wheel, entry);
+        wheel->count--;
+    }
+
+    uint64_t now = timer_wheel_now(wheel);
+    // If the wheel is empty there is nothing to cascade, so it can skip
+    // straight to the current time (keeping expiries close to base so they
+    // go into low levels)
+    if (wheel->count == 0 && now > wheel->base) {
+        wheel->base = now;
+    }
+
+    entry->expiry = now + delay;
+    entry->period = period;
+    entry->active = true;
+    wheel->count++;
+    timer_wheel_link(wheel, entry);
+
+    timer_wheel_update_alarm(wheel);
+    timer_wheel_unlock(primask);
+}
+
+/*
+ * Starts (or restarts) a timer to call its callback once, `delay` ticks from
+ * now.
+ */
+void timer_wheel_start_oneshot(TimerWheel* wheel, TimerWheelEntry* entry,
+        uint32_t delay) {
+    timer_wheel_start(wheel, entry, delay, 0);
+}
+
+/*
+ * Starts (or restarts) a timer to call its callback every `period` ticks,
+ * starting `period` ticks from now.
+ *
+ * Each expiry is scheduled from the previous expiry (not from when the
+ * callback ran), so the timer does not drift. If the wheel falls behind by
+ * more than a period, the missed expiries are skipped.
+ */
+void timer_wheel_start_periodic(TimerWheel* wheel, TimerWheelEntry* entry,
+        uint32_t period) {
+    if (period == 0) {
+        period = 1;
+    }
+    timer_wheel_start(wheel, entry, period, period);
+}
+
+/*
+ * Stops a timer. Does nothing if the timer is not active.
+ */
+void timer_wheel_cancel(TimerWheel* wheel, TimerWheelEntry* entry) {
+    uint32_t primask = timer_wheel_lock();
+    if (entry->active) {
+        timer_wheel_unlink(wheel, entry);
+        entry->active = false;
+        wheel->count--;
+        // The alarm is left as it is - if it goes off with nothing to do, it
+        // is just set again for the next event
+    }
+    timer_wheel_unlock(primask);
+}
+
+/*
+ * Processes all ticks up to and including `now`, calling the callbacks of all
+ * timers that expire (in order of expiry time).
+ *
+ * For a wheel on the clock, this is called automatically by the clock's alarm.
+ */
+void timer_wheel_advance(TimerWheel* wheel, uint64_t now) {
+    uint32_t primask = timer_wheel_lock();
+
+    if (!wheel->use_clock) {
+        wheel->now = now;
+    }
+
+    // Jump straight from one event to the next, skipping the ticks in between
+    uint64_t time;
+    while (timer_wheel_next_event_unlocked(wheel, &time) && time <= now) {
+        wheel->base = time;
+
+        // Cascade any higher-level slots that start at this time, from the
+        // top level down, so entries expiring now end up in level 0
+        for (uint32_t level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+            uint32_t shift = level * TIMER_WHEEL_SLOT_BITS;
+            if ((time & ((((uint64_t) 1) << shift) - 1)) != 0) {
+                continue;
+            }
+
+            TimerWheelEntry* list;
+            timer_wheel_take_slot(wheel, level,
+                    (time >> shift) & (TIMER_WHEEL_SLOTS - 1), &list);
+            while (list != NULL) {
+                TimerWheelEntry* entry = list;
+                list = entry->next;
+                timer_wheel_link(wheel, entry);
+            }
+        }
+
+        // Every entry in this level 0 slot expires now
+        TimerWheelEntry* list;
+        timer_wheel_take_slot(wheel, 0, time & (TIMER_WHEEL_SLOTS - 1), &list);
+        while (list != NULL) {
+            TimerWheelEntry* entry = list;
+            timer_wheel_unlink(wheel, entry);
+
+            if (entry->period != 0) {
+                entry->expiry += entry->period;
+                // If the wheel fell behind (e.g. `now` is several periods
+                // after `time`), skip the expiries that have already passed
+                // instead of calling the callback once for each of them
+                if (entry->expiry <= now) {
+                    uint64_t missed = (now - entry->expiry) / entry->period + 1;
+                    entry->expiry += missed * entry->period;
+                }
+                timer_wheel_link(wheel, entry);
+            } else {
+                entry->active = false;
+                wheel->count--;
+            }
+
+            // Allow interrupts while the callback runs
+            // The callback is allowed to start or cancel any timer (including
+            // entries still in `list`, which unlinking handles)
+            timer_wheel_unlock(primask);
+            if (entry->callback != NULL) {
+                entry->callback(entry->context);
+            }
+            primask = timer_wheel_lock();
+        }
+    }
+
+    if (now >= wheel->base) {
+        wheel->base = now + 1;
+    }
+
+    timer_wheel_update_alarm(wheel);
+    timer_wheel_unlock(primask);
+}
+
+/*
+ * Gets the next time the wheel needs to be advanced to, which is either when
+ * the next timer expires or earlier (when entries need to be cascaded).
+ * Returns false if there are no active timers.
+ */
+bool timer_wheel_next_event(TimerWheel* wheel, uint64_t* time) {
+    uint32_t primask = timer_wheel_lock();
+    bool found = timer_wheel_next_event_unlocked(wheel, time);
+    timer_wheel_unlock(primask);
+    return found;
+}
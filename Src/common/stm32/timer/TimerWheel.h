@@ -0,0 +1,83 @@
+/*
+ * TimerWheel.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_TIMER_TIMERWHEEL_H_
+#define COMMON_STM32_TIMER_TIMERWHEEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Each level of the wheel has 2^6 = 64 slots, so one bit per slot fits in a
+// uint64_t
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+// 6 levels of 6 bits cover 2^36 ticks (over 19 hours at 1 tick/us), which is
+// more than the longest possible delay (2^32 - 1 ticks)
+#define TIMER_WHEEL_LEVELS 6
+
+// Called when a timer expires
+typedef void (*TimerWheelCB)(void* context);
+
+// One software timer
+// The struct is owned by the caller and must stay valid while the timer is
+// active (e.g. a global or static variable)
+typedef struct TimerWheelEntry {
+    // Links in the list of entries in the same slot
+    struct TimerWheelEntry* next;
+    // Points to the previous entry's `next` (or the slot's list head), so the
+    // entry can be removed without searching the list
+    struct TimerWheelEntry** pprev;
+
+    // Time (in ticks) when the timer expires
+    uint64_t expiry;
+    // Ticks between expiries for a periodic timer, 0 for a one-shot timer
+    uint32_t period;
+
+    TimerWheelCB callback;
+    void* context;
+
+    // Slot the entry is currently in
+    uint8_t level;
+    uint8_t slot;
+    // true if the timer is waiting to expire
+    volatile bool active;
+} TimerWheelEntry;
+
+typedef struct {
+    // Lists of entries in each slot
+    TimerWheelEntry* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    // Bit i of occupied[level] is set if slots[level][i] is not empty
+    uint64_t occupied[TIMER_WHEEL_LEVELS];
+
+    // All ticks before this have been processed
+    uint64_t base;
+    // Current time in ticks, for calculating expiries (only used if not
+    // running on the clock)
+    uint64_t now;
+    // Number of active entries
+    uint32_t count;
+
+    // true if ticks are clock us and the wheel advances itself using the
+    // clock's alarm, false if the time is advanced by calling
+    // timer_wheel_advance()
+    bool use_clock;
+} TimerWheel;
+
+void timer_wheel_init(TimerWheel* wheel);
+void timer_wheel_init_manual(TimerWheel* wheel, uint64_t now);
+
+void timer_wheel_entry_init(TimerWheelEntry* entry, TimerWheelCB callback,
+        void* context);
+void timer_wheel_start_oneshot(TimerWheel* wheel, TimerWheelEntry* entry,
+        uint32_t delay);
+void timer_wheel_start_periodic(TimerWheel* wheel, TimerWheelEntry* entry,
+        uint32_t period);
+void timer_wheel_cancel(TimerWheel* wheel, TimerWheelEntry* entry);
+
+void timer_wheel_advance(TimerWheel* wheel, uint64_t now);
+bool timer_wheel_next_event(TimerWheel* wheel, uint64_t* time);
+
+#endif /* COMMON_STM32_TIMER_TIMERWHEEL_H_ */
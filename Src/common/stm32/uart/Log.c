@@ -26,9 +26,10 @@
  */
 
 
+#include <common/stm32/mcu/Sections.h>
 #include <common/stm32/uart/Log.h>
-#include <common/stm32/util/Util.h>
-#include <stdio.h>
+#include <common/stm32/util/Profile.h>
+#include <common/stm32/util/StrBuf.h>
 
 
 // This is the "default" Log struct
@@ -41,8 +42,20 @@ Log* g_log_def = NULL;
 // display more verbose output
 LogLevel g_log_global_level = LOG_LEVEL_INFO;
 
+// Buffers for formatting messages, shared by all Logs instead of being on the
+// stack (see LOG_POOL_COUNT)
+// They are only used by the CPU, so they can be in DTCM on the H743
+Pool g_log_pool;
+FAST_BSS static uint8_t g_log_blocks[LOG_POOL_COUNT][UART_TX_BUF_SIZE]
+        __attribute__((aligned(4)));
+
 
 void log_init(Log* log, UART* uart) {
+    // Until this is done, messages are dropped (pool_alloc() always fails)
+    if (g_log_pool.start == NULL) {
+        pool_init(&g_log_pool, g_log_blocks, UART_TX_BUF_SIZE, LOG_POOL_COUNT);
+    }
+
     log->uart = uart;
     // Want a level of info by default
     log->level = LOG_LEVEL_INFO;
@@ -90,40 +103,49 @@ void log_set_global_level(LogLevel level) {
  * Note this may not work correctly if you call it from an ISR (see
  * uart_write_dma()).
  */
-void log_write_msg(Log* log, LogLevel level, char* msg) {
+FAST_CODE void log_write_msg(Log* log, LogLevel level, char* msg) {
     // Must prepare our bytes in a separate buffer from the UART's TX buffer
-    char buf[UART_TX_BUF_SIZE];
+    // If all buffers are in use, the message is dropped (counted in
+    // g_log_pool.failures)
+    char* buf = pool_alloc(&g_log_pool);
+    if (buf == NULL) {
+        return;
+    }
+    StrBuf line;
+    strbuf_init(&line, buf, UART_TX_BUF_SIZE);
 
     // Start the string in the buffer with the current system (tick) time
-    // This operates very similar to `vsnprintf` except we pass in the variable
-    // arguments directly rather than as a `va_list`
-    snprintf(buf, sizeof(buf), "%lums: ", HAL_GetTick());
+    // Append the number directly instead of going through snprintf() since
+    // this happens for every single line
+    strbuf_append_u32(&line, HAL_GetTick());
+    strbuf_append(&line, "ms: ");
 
     // Add the string for the message's log level
-    util_safe_strncat(buf, sizeof(buf), log_get_level_string(level));
+    strbuf_append(&line, log_get_level_string(level));
 
     // Add a colon and space after the message's log level
-    util_safe_strncat(buf, sizeof(buf), ": ");
+    strbuf_append(&line, ": ");
 
     // Add the main string (the message)
-    util_safe_strncat(buf, sizeof(buf), msg);
+    strbuf_append(&line, msg);
 
     // Add a newline after the message
     // \r is also called CR, while \n is also called LF
     // Normally we would only need \n, but we choose to include \r as well
     // because if you only use \n, some serial monitors (viewers) go to the
     // next line but do not reset the cursor all the way to the left
-    util_safe_strncat(buf, sizeof(buf), "\r\n");
+    strbuf_append(&line, "\r\n");
 
     // Now that the actual characters/bytes we want to send over UART are
     // ready in `buf`, send them over UART
     // Use DMA mode instead of blocking mode so we don't have to wait in this
     // function until it's done
-    // Number of characters from the buffer to actually send is determined
-    // using `strlen` since there is a \0 character in the buffer
+    // The StrBuf already knows the number of characters in the buffer, so we
+    // don't need to call strlen()
     // Note the uart_write_dma() function will copy the contents of `buf` to the
     // UART TX buffer, then transfer them over DMA
-    uart_write_dma(log->uart, (uint8_t*) buf, strlen(buf));
+    uart_write_dma(log->uart, (uint8_t*) buf, line.len);
+    pool_free(&g_log_pool, buf);
 }
 
 /*
@@ -152,7 +174,7 @@ bool log_should_write_msg(Log* log, LogLevel level) {
  * Note that %llu and %lld format specifiers do not appear to work, as they just
  * print "lu" and "ld" (without any numbers) respectively
  */
-void log_log(Log* log, LogLevel level, char* format, va_list args) {
+FAST_CODE void log_log(Log* log, LogLevel level, char* format, va_list args) {
     // Do this check before calling vsnprintf in case the argument
     // parsing/formatting takes a long time
     // Can bail out early if the message won't be written to UART
@@ -166,17 +188,22 @@ void log_log(Log* log, LogLevel level, char* format, va_list args) {
     // - `msg` is the buffer where the resulting string is stored, i.e.
     //   the format string with the placeholders replaced by the values of
     //   the variable arguments
-    // - `sizeof(msg)` is the size of the buffer, i.e. the number of
-    //   bytes (characters) it can hold
-    // - Use `vsnprintf` instead of `vsprintf` so we can specify the size of
-    //   the buffer (using `sizeof`) to ensure we do not write past the
-    //   buffer boundary and overflow it
+    // - The StrBuf knows the size of the buffer, so it never writes past the
+    //   buffer boundary (it uses `vsnprintf` internally)
     // - This automatically adds a terminating nul ('\0') character at the
     //   appropriate place in the buffer
-    char msg[UART_TX_BUF_SIZE];
-    vsnprintf(msg, sizeof(msg), format, args);
+    char* msg = pool_alloc(&g_log_pool);
+    if (msg == NULL) {
+        return;
+    }
+    PROFILE_BEGIN(log_log);
+    StrBuf msg_sb;
+    strbuf_init(&msg_sb, msg, UART_TX_BUF_SIZE);
+    strbuf_vappendf(&msg_sb, format, args);
 
     log_write_msg(log, level, msg);
+    PROFILE_END(log_log);
+    pool_free(&g_log_pool, msg);
 }
 
 void error(Log* log, char* format, ...) {
@@ -229,41 +256,47 @@ void log_log_bytes(Log* log, LogLevel level, uint8_t* bytes, uint32_t count,
     }
 
     // Format the prefix message (standard printf-style)
-    char msg[UART_TX_BUF_SIZE];
-    vsnprintf(msg, sizeof(msg), prefix_format, prefix_args);
+    char* msg = pool_alloc(&g_log_pool);
+    if (msg == NULL) {
+        return;
+    }
+    StrBuf msg_sb;
+    strbuf_init(&msg_sb, msg, UART_TX_BUF_SIZE);
+    strbuf_vappendf(&msg_sb, prefix_format, prefix_args);
 
     // Add a colon and space after the message prefix, only if the prefix is not
     // empty
-    if (strlen(msg) > 0) {
-        util_safe_strncat(msg, sizeof(msg), ": ");
+    if (msg_sb.len > 0) {
+        strbuf_append(&msg_sb, ": ");
     }
 
     // Add a string to describe the number of bytes
-    // Since there is already a string in the buffer that we are appending to,
-    // call snprintf() at a point in the buffer that is not the start
-    size_t len = strlen(msg);
-    snprintf(&msg[len], sizeof(msg) - len,
-            "%lu %s", count, (count == 1) ? "byte" : "bytes");
+    strbuf_append_u32(&msg_sb, count);
+    strbuf_append(&msg_sb, (count == 1) ? " byte" : " bytes");
 
     // Add the "0x" prefix and the first byte
     // "0x" signifies all bytes are written in hex format
     if (count > 0) {
-        len = strlen(msg);
-        snprintf(&msg[len], sizeof(msg) - len, ": 0x%.2X", bytes[0]);
+        strbuf_append(&msg_sb, ": 0x");
+        strbuf_append_hex(&msg_sb, bytes[0], 2);
     }
 
     // Add all other bytes with a ":" prefix to separate bytes
-    len = strlen(msg);
+    // Converting each byte directly is much cheaper than calling snprintf()
+    // once per byte
     for (uint32_t i = 1; i < count; i++) {
-        snprintf(&msg[len], sizeof(msg) - len, ":%.2X", bytes[i]);
-        // Manually add 3 instead of calling strlen() every time through the
-        // loop because we know 3 bytes are added (colon and 2 digits)
-        len += 3;
+        // Stop early once the buffer is full, since nothing more will fit
+        if (msg_sb.truncated) {
+            break;
+        }
+        strbuf_append_char(&msg_sb, ':');
+        strbuf_append_hex(&msg_sb, bytes[i], 2);
     }
 
-    // snprintf() always adds a terminating null character, so `msg` is now a C
+    // The StrBuf always keeps a terminating null character, so `msg` is now a C
     // string
     log_write_msg(log, level, msg);
+    pool_free(&g_log_pool, msg);
 }
 
 void error_bytes(Log* log, uint8_t* bytes, uint32_t count,
@@ -16,6 +16,14 @@
 
 extern Log* g_log_def;
 
+// Number of message buffers (UART_TX_BUF_SIZE bytes each) in g_log_pool
+// Each message being logged takes 2 (the message and the full line) while it
+// is formatted and sent, so this allows messages logged from interrupts to
+// nest a few levels deep
+#define LOG_POOL_COUNT 8
+
+extern Pool g_log_pool;
+
 
 void log_init(Log* log, UART* uart);
 void log_set_level(Log* log, LogLevel level);
@@ -87,8 +87,14 @@ __io_getchar() functions
 
 
 #include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Idle.h>
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/mcu/Stack.h>
+#include <common/stm32/timer/Clock.h>
 #include <common/stm32/uart/Log.h>
 #include <common/stm32/uart/uart.h>
+#include <common/stm32/util/Profile.h>
+#include <common/stm32/util/StrBuf.h>
 #include <common/stm32/util/Util.h>
 #include <nucleo_g474re/G474REConfig.h>
 #include <nucleo_h743zi2/H743ZI2Config.h>
@@ -109,6 +115,17 @@ UART* g_uart_lpuart1 = NULL;
 // Default UART - can be used globally
 UART* g_uart_def = NULL;
 
+// TX and RX buffers for all UARTs, handed out when each UART is initialized
+// These must be in memory the DMA can access (DMA_BUFFER is D2 SRAM on the
+// H743, never DTCM)
+Pool g_uart_tx_pool;
+Pool g_uart_rx_pool;
+DMA_BUFFER static uint8_t g_uart_tx_blocks[UART_MAX_COUNT][UART_TX_BUF_SIZE]
+        __attribute__((aligned(4)));
+DMA_BUFFER static uint8_t g_uart_rx_blocks[UART_MAX_COUNT][UART_RX_BUF_SIZE]
+        __attribute__((aligned(4)));
+static bool g_uart_pools_initialized = false;
+
 
 void uart_init_dma(UART* uart, USART_TypeDef* instance) {
     // Currently, the DMA allocations only work if there is only one normal
@@ -382,12 +399,38 @@ void uart_init_clk_and_nvic(UART* uart, USART_TypeDef* instance) {
 
 /*
  * alternate - e.g. GPIO_AF7_USART3 for an instance of USART3
+ * Returns false if there are no TX/RX buffers left in the pools (nothing is
+ * initialized).
  */
-void uart_init_base(UART* uart, MCU* mcu,
+bool uart_init_base(UART* uart, MCU* mcu,
         USART_TypeDef* instance, UARTBaud baud, uint8_t alternate,
         GPIO_TypeDef* tx_port, uint16_t tx_pin,
         GPIO_TypeDef* rx_port, uint16_t rx_pin) {
 
+    // Take TX and RX buffers from the shared pools
+    if (!g_uart_pools_initialized) {
+        pool_init(&g_uart_tx_pool, g_uart_tx_blocks, UART_TX_BUF_SIZE,
+                UART_MAX_COUNT);
+        pool_init(&g_uart_rx_pool, g_uart_rx_blocks, UART_RX_BUF_SIZE,
+                UART_MAX_COUNT);
+        g_uart_pools_initialized = true;
+    }
+    uart->tx_buf = pool_alloc(&g_uart_tx_pool);
+    uart->rx_buf = pool_alloc(&g_uart_rx_pool);
+    if (uart->tx_buf == NULL || uart->rx_buf == NULL) {
+        // Give back whichever one was taken
+        if (uart->tx_buf != NULL) {
+            pool_free(&g_uart_tx_pool, (void*) uart->tx_buf);
+            uart->tx_buf = NULL;
+        }
+        if (uart->rx_buf != NULL) {
+            pool_free(&g_uart_rx_pool, (void*) uart->rx_buf);
+            uart->rx_buf = NULL;
+        }
+        Error_Handler();
+        return false;
+    }
+
     // Initialize DMA
     uart_init_dma(uart, instance);
 
@@ -434,6 +477,8 @@ void uart_init_base(UART* uart, MCU* mcu,
     if (HAL_UARTEx_EnableFifoMode(&uart->handle) != HAL_OK) {
         Error_Handler();
     }
+
+    return true;
 }
 
 /*
@@ -483,8 +528,10 @@ void uart_init(UART* uart, MCU* mcu,
         GPIO_TypeDef* tx_port, uint16_t tx_pin,
         GPIO_TypeDef* rx_port, uint16_t rx_pin) {
 
-    uart_init_base(uart, mcu, instance, baud, alternate, tx_port, tx_pin,
-            rx_port, rx_pin);
+    if (!uart_init_base(uart, mcu, instance, baud, alternate, tx_port,
+            tx_pin, rx_port, rx_pin)) {
+        return;
+    }
 
     if (HAL_UART_Init(&uart->handle) != HAL_OK) {
         Error_Handler();
@@ -492,10 +539,14 @@ void uart_init(UART* uart, MCU* mcu,
 
     // Common buffer for printing messages
     char buf[140];
+    StrBuf msg;
+    strbuf_init(&msg, buf, sizeof(buf));
 
     // Print message at original baud rate
-    snprintf(buf, sizeof(buf), "Started UART at %lu baud\r\n", (uint32_t) baud);
-    uart_write(uart, (uint8_t*) buf, strlen(buf));
+    strbuf_append(&msg, "Started UART at ");
+    strbuf_append_u32(&msg, baud);
+    strbuf_append(&msg, " baud\r\n");
+    uart_write(uart, (uint8_t*) buf, msg.len);
 
     // Serial monitors often default to 9600 baud, so in case the user has
     // theirs set to 9600, we switch the MCU's UART to 9600, print a warning
@@ -506,14 +557,15 @@ void uart_init(UART* uart, MCU* mcu,
         // Print warning message at 9600 baud
         // Note this takes over 100ms to write to UART at 9600 baud, so it can
         // be disabled if you need to speed up MCU initialization
-        snprintf(buf, sizeof(buf),
-                "WARNING: UART will be operating at %lu baud\r\n"
+        strbuf_clear(&msg);
+        strbuf_append(&msg, "WARNING: UART will be operating at ");
+        strbuf_append_u32(&msg, baud);
+        strbuf_append(&msg, " baud\r\n"
                 "Your serial monitor is set to 9600 baud\r\n"
-                "Change your serial monitor's baud rate!\r\n",
-                (uint32_t) baud);
+                "Change your serial monitor's baud rate!\r\n");
         // Must use uart_write here because the Log struct has not been
         // initialized yet
-        uart_write(uart, (uint8_t*) buf, strlen(buf));
+        uart_write(uart, (uint8_t*) buf, msg.len);
 
         // Restore the original baud rate and reinitialize UART
         uart_set_baud(uart, baud);
@@ -526,8 +578,9 @@ void uart_init(UART* uart, MCU* mcu,
     // Start receiving data through RX DMA
     uart_restart_rx_dma(uart);
 
-    snprintf(buf, sizeof(buf), "Initialized UART\r\n");
-    uart_write(uart, (uint8_t*) buf, strlen(buf));
+    strbuf_clear(&msg);
+    strbuf_append(&msg, "Initialized UART\r\n");
+    uart_write(uart, (uint8_t*) buf, msg.len);
 
     log_init(&uart->log, uart);
 }
@@ -560,8 +613,10 @@ void uart_init_with_rs485(UART* uart, MCU* mcu,
         GPIO_TypeDef* rx_port, uint16_t rx_pin,
         GPIO_TypeDef* de_port, uint16_t de_pin) {
 
-    uart_init_base(uart, mcu, instance, baud, alternate, tx_port, tx_pin,
-            rx_port, rx_pin);
+    if (!uart_init_base(uart, mcu, instance, baud, alternate, tx_port,
+            tx_pin, rx_port, rx_pin)) {
+        return;
+    }
 
     // RS-485 DE pin init
     gpio_alt_func_init(&uart->de_gpio, mcu, de_port, de_pin, alternate,
@@ -582,6 +637,49 @@ void uart_init_with_rs485(UART* uart, MCU* mcu,
     }
 }
 
+/*
+ * Stops the UART and gives its TX and RX buffers back to the pools, so another
+ * UART can be initialized with them. The UART can be initialized again
+ * afterwards. Does nothing if it was already deinitialized (or its
+ * initialization failed).
+ */
+void uart_deinit(UART* uart) {
+    if (uart->tx_buf == NULL) {
+        return;
+    }
+
+    HAL_UART_Abort(&uart->handle);
+    HAL_UART_DeInit(&uart->handle);
+
+    // Stop the IRQ handlers from using this UART (they do nothing when their
+    // global is NULL)
+    UART** globals[] = {
+        &g_uart_usart1, &g_uart_usart2, &g_uart_usart3, &g_uart_uart4,
+        &g_uart_uart5, &g_uart_usart6, &g_uart_uart7, &g_uart_uart8,
+        &g_uart_lpuart1,
+    };
+    for (uint32_t i = 0; i < sizeof(globals) / sizeof(globals[0]); i++) {
+        if (*globals[i] == uart) {
+            *globals[i] = NULL;
+        }
+    }
+    // The DMA channels/streams belong to the default UART (see
+    // uart_init_dma())
+    if (g_uart_def == uart) {
+        HAL_DMA_DeInit(&uart->tx_dma_handle);
+        HAL_DMA_DeInit(&uart->rx_dma_handle);
+        g_uart_def = NULL;
+    }
+    if (g_log_def == &uart->log) {
+        g_log_def = NULL;
+    }
+
+    pool_free(&g_uart_tx_pool, (void*) uart->tx_buf);
+    pool_free(&g_uart_rx_pool, (void*) uart->rx_buf);
+    uart->tx_buf = NULL;
+    uart->rx_buf = NULL;
+}
+
 /*
  * This should only be used to change the baud after initializing UART.
  */
@@ -598,6 +696,14 @@ void uart_set_baud(UART* uart, UARTBaud baud) {
     }
 }
 
+/*
+ * Condition for uart_wait_for_tx_ready() (called with interrupts disabled).
+ */
+static bool uart_is_tx_ready(void* context) {
+    UART* uart = (UART*) context;
+    return uart->handle.gState == HAL_UART_STATE_READY;
+}
+
 void uart_wait_for_tx_ready(UART* uart) {
     // If a TX process is already ongoing, wait for it to finish
     // If a previous DMA TX is in progress, when the TX is done the UART ISR
@@ -605,16 +711,15 @@ void uart_wait_for_tx_ready(UART* uart) {
     // This is necessary because if you call HAL_UART_Transmit() or
     // HAL_UART_Transmit_DMA() when gState is not ready, it fails and returns
     // busy (without transmitting anything)
-    uint32_t start = HAL_GetTick();
-    while (uart->handle.gState != HAL_UART_STATE_READY) {
+    // The TX DMA interrupt wakes this up when the transfer is done
+    uint64_t deadline = clock_deadline_ms(UART_TX_TIMEOUT_MS);
+    if (!idle_sleep_until_cond(deadline, uart_is_tx_ready, uart)) {
         // Timeout (this should never happen)
-        if (HAL_GetTick() > start + UART_TX_TIMEOUT_MS) {
-            // Note that this could get stuck infinitely because Error_Handler()
-            // logs a message over UART, which calls uart_wait_for_tx_ready()
-            // first, which can call Error_Handler() again, and so on
-            Error_Handler();
-            return;
-        }
+        // Note that this could get stuck infinitely because Error_Handler()
+        // logs a message over UART, which calls uart_wait_for_tx_ready()
+        // first, which can call Error_Handler() again, and so on
+        Error_Handler();
+        return;
     }
 }
 
@@ -639,6 +744,7 @@ void uart_write(UART* uart, uint8_t* buf, uint32_t count) {
  * Note that buf should be a SEPARATE BUFFER from uart->tx_buf
  */
 void uart_write_dma(UART* uart, uint8_t* buf, uint32_t count) {
+    PROFILE_BEGIN(uart_write_dma);
     // Must wait until the previous TX DMA transfer has completed
     uart_wait_for_tx_ready(uart);
 
@@ -652,11 +758,12 @@ void uart_write_dma(UART* uart, uint8_t* buf, uint32_t count) {
     // it overwrites the data of the previous transfer and corrupts the bytes
     // that have not been sent out yet by the previous transfer
     // Note the cast discards the `volatile` qualifier
-    util_safe_memcpy((uint8_t*) uart->tx_buf, sizeof(uart->tx_buf), buf, count);
+    util_safe_memcpy((uint8_t*) uart->tx_buf, UART_TX_BUF_SIZE, buf, count);
 
     // Transmit the data from the UART struct's TX buffer
     // Note the cast discards the `volatile` qualifier
     HAL_UART_Transmit_DMA(&uart->handle, (uint8_t*) uart->tx_buf, count);
+    PROFILE_END(uart_write_dma);
 
     // In the future, could modify this implementation so it doesn't have to
     // wait for the previous DMA transfer to finish before starting the next
@@ -692,7 +799,7 @@ void uart_restart_rx_dma(UART* uart) {
     // buffer
     // Note the cast discards the `volatile` qualifier
     HAL_UART_Receive_DMA(&uart->handle, (uint8_t*) uart->rx_buf,
-            sizeof(uart->rx_buf));
+            UART_RX_BUF_SIZE);
 }
 
 /*
@@ -714,7 +821,7 @@ uint32_t uart_get_rx_count(UART* uart) {
             ((DMA_Stream_TypeDef*) uart->rx_dma_handle.Instance)->NDTR;
 #endif
 
-    return sizeof(uart->rx_buf) - ndtr;
+    return UART_RX_BUF_SIZE - ndtr;
 }
 
 bool uart_is_newline_char(char c) {
@@ -787,6 +894,7 @@ uint64_t uart_read_value(UART* uart, char* tx_format, va_list tx_args,
         }
 
         // If using an RTOS, should yield the thread right here
+        idle_sleep_until(clock_deadline_ms(UART_RX_POLL_MS));
     }
 
     uart_restart_rx_dma(uart);
@@ -893,6 +1001,7 @@ void uart_wait_for_key_press(UART* uart) {
         }
 
         // If using an RTOS, should yield the thread right here
+        idle_sleep_until(clock_deadline_ms(UART_RX_POLL_MS));
     }
 }
 
@@ -923,6 +1032,7 @@ void DMA1_Stream0_IRQHandler(void)
     if (g_uart_def == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_dma_irq);
     HAL_DMA_IRQHandler(&g_uart_def->tx_dma_handle);
 }
 
@@ -935,6 +1045,7 @@ void USART3_IRQHandler(void) {
     if (g_uart_usart3 == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_irq);
 
     // Must call this here so that after a DMA transmission is complete, it
     // changes the UART handle's gState from busy to ready, allowing it to do
@@ -950,48 +1061,56 @@ void USART1_IRQHandler(void) {
     if (g_uart_usart1 == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_irq);
     HAL_UART_IRQHandler(&g_uart_usart1->handle);
 }
 void USART2_IRQHandler(void) {
     if (g_uart_usart2 == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_irq);
     HAL_UART_IRQHandler(&g_uart_usart2->handle);
 }
 void UART4_IRQHandler(void) {
     if (g_uart_uart4 == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_irq);
     HAL_UART_IRQHandler(&g_uart_uart4->handle);
 }
 void UART5_IRQHandler(void) {
     if (g_uart_uart5 == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_irq);
     HAL_UART_IRQHandler(&g_uart_uart5->handle);
 }
 void USART6_IRQHandler(void) {
     if (g_uart_usart6 == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_irq);
     HAL_UART_IRQHandler(&g_uart_usart6->handle);
 }
 void UART7_IRQHandler(void) {
     if (g_uart_uart7 == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_irq);
     HAL_UART_IRQHandler(&g_uart_uart7->handle);
 }
 void UART8_IRQHandler(void) {
     if (g_uart_uart8 == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_irq);
     HAL_UART_IRQHandler(&g_uart_uart8->handle);
 }
 void LPUART1_IRQHandler(void) {
     if (g_uart_lpuart1 == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_irq);
     HAL_UART_IRQHandler(&g_uart_lpuart1->handle);
 }
 
@@ -1012,6 +1131,7 @@ void DMA1_Stream1_IRQHandler(void)
     if (g_uart_def == NULL) {
         return;
     }
+    STACK_SAMPLE_ISR(uart_dma_irq);
     HAL_DMA_IRQHandler(&g_uart_def->rx_dma_handle);
 }
 
@@ -9,6 +9,7 @@
 #define COMMON_STM32_UART_UART_H_
 
 #include <common/stm32/uart/UARTLog.h>
+#include <common/stm32/util/Pool.h>
 
 // See uart_log.h for enum and struct definitions
 
@@ -17,6 +18,11 @@
 // max 160 bytes per line, plus a lot of margin
 #define UART_TX_TIMEOUT_MS 400
 
+// How often (in ms) to check for received bytes while waiting for input
+// RX DMA only interrupts when the buffer is half or completely full, so waits
+// sleep for this long between checks instead of until an interrupt
+#define UART_RX_POLL_MS 10
+
 // Default baud rate (as high as reasonably possible)
 // Choose 230,400 because it is the highest preset baud rate value in CoolTerm
 // It is also a preset value in the terminal extension for STM32CubeIDE
@@ -30,6 +36,9 @@ typedef enum {
     UART_BAUD_230400 = 230400,
 } UARTBaud;
 
+// Pools of TX and RX buffers shared by all UARTs (UART_MAX_COUNT each)
+extern Pool g_uart_tx_pool;
+extern Pool g_uart_rx_pool;
 
 void uart_init(UART* uart, MCU* mcu,
         USART_TypeDef* instance, UARTBaud baud, uint8_t alternate,
@@ -41,6 +50,7 @@ void uart_init_with_rs485(UART* uart, MCU* mcu,
         GPIO_TypeDef* tx_port, uint16_t tx_pin,
         GPIO_TypeDef* rx_port, uint16_t rx_pin,
         GPIO_TypeDef* de_port, uint16_t de_pin);
+void uart_deinit(UART* uart);
 
 void uart_set_baud(UART* uart, UARTBaud baud);
 
@@ -47,8 +47,10 @@ typedef struct {
 // from assert_failed() with long file paths, so 160 should be sufficient
 #define UART_TX_BUF_SIZE 160
 #define UART_RX_BUF_SIZE 80
+// Number of UARTs that can be initialized at the same time (the number of
+// TX/RX buffers in the pools in UART.c)
+#define UART_MAX_COUNT 4
 
-// If using C++ in the future, should use a template to specify the buffer sizes
 typedef struct UARTStruct {
     MCU* mcu;
 
@@ -62,18 +64,21 @@ typedef struct UARTStruct {
     GPIOAltFunc rx_gpio;
     GPIOAltFunc de_gpio;
 
-    // Store a buffer of bytes (characters) in this UART struct to be sent by
-    // the TX DMA
-    // It should be in the UART struct instead of the Log struct because we
-    // expect to have many Log structs for each UART struct, so having a buffer
-    // in each Log struct would be a big waste of memory
+    // Buffer of UART_TX_BUF_SIZE bytes (characters) to be sent by the TX DMA
+    // It belongs to the UART instead of the Log because we expect to have many
+    // Log structs for each UART struct, so having a buffer in each Log struct
+    // would be a big waste of memory
+    // It comes from a pool shared by all UARTs (g_uart_tx_pool) in memory the
+    // DMA can access, so the UART struct itself can be anywhere (e.g. on the
+    // stack, even if that is in DTCM)
     // Must be volatile so that all writes to the buffer are actually writes to
     // memory (that the DMA reads from)
-    volatile uint8_t tx_buf[UART_TX_BUF_SIZE];
-    // Buffer for receiving bytes through the RX DMA
+    volatile uint8_t* tx_buf;
+    // Buffer of UART_RX_BUF_SIZE bytes for receiving bytes through the RX DMA
+    // (from g_uart_rx_pool)
     // Must be volatile so that all reads from the buffer are actually reads
     // from memory (that the DMA writes to)
-    volatile uint8_t rx_buf[UART_RX_BUF_SIZE];
+    volatile uint8_t* rx_buf;
 
     // Default Log struct for this UART
     Log log;
@@ -0,0 +1,235 @@
+/*
+ * Heap.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Replaces newlib's malloc() family (including the reentrant _malloc_r()
+ * versions it calls internally, e.g. from vsnprintf() and sscanf()) with a
+ * TLSF pool (see TLSF.c), so every allocation and free takes a bounded time.
+ *
+ * By default, the first allocation takes all of the memory _sbrk() has left
+ * (from the end of .bss up to the stack's reserved _Min_Stack_Size and the
+ * fault handler's _Fault_Stack_Size below it, which are in RAM_D1 on the H743)
+ * for the pool. To use another region instead (e.g. a FAST_BSS array in DTCM on
+ * the H743), call heap_init() before anything allocates (including the first
+ * log message that formats a float). Since nothing is left between the pool and
+ * the stack, setting up the default pool also enables the stack's MPU guard
+ * (see Stack.c), so a stack overflow faults instead of corrupting the pool.
+ *
+ * Each call runs with interrupts disabled, so the heap can be used from ISRs
+ * too (TLSF keeps that time short and constant).
+ *
+ * Define HEAP_NEWLIB to leave newlib's allocator in place (e.g. to compare
+ * them).
+ */
+
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/HAL.h>
+#include <common/stm32/mcu/Stack.h>
+#include <common/stm32/util/Heap.h>
+#include <errno.h>
+#include <string.h>
+
+#if !defined(HEAP_NEWLIB)
+
+// Symbols defined in the linker script (see sysmem.c)
+extern uint8_t _estack;
+extern uint32_t _Min_Stack_Size;
+extern uint32_t _Fault_Stack_Size;
+
+void* _sbrk(ptrdiff_t incr);
+
+// Declared in newlib's <reent.h>, only passed through here
+struct _reent;
+
+static TLSF g_heap;
+static bool g_heap_initialized = false;
+static bool g_heap_failure_reported = false;
+
+
+/*
+ * Sets up the pool over the rest of the _sbrk() heap if heap_init() was not
+ * called. Must be called with interrupts disabled.
+ *
+ * Returns NULL if the pool could not be set up (the caller reports it with
+ * heap_report_failure() once it has restored PRIMASK).
+ */
+static TLSF* heap_get(void) {
+    if (!g_heap_initialized) {
+        uint8_t* start = (uint8_t*) _sbrk(0);
+        uint8_t* limit = (uint8_t*) ((uint32_t) &_estack -
+                (uint32_t) &_Min_Stack_Size - (uint32_t) &_Fault_Stack_Size);
+        if (start == (uint8_t*) -1 || limit <= start ||
+                !tlsf_init(&g_heap, start, limit - start) ||
+                _sbrk(limit - start) == (void*) -1) {
+            return NULL;
+        }
+        g_heap_initialized = true;
+
+        // The pool now ends right below the stacks, so make an overflow fault
+        // at the stack's guard instead of silently running into the heap
+        stack_guard_try_enable();
+    }
+    return &g_heap;
+}
+
+/*
+ * Reports that heap_get() failed. Only reports it the first time, since
+ * logging the error can allocate again (e.g. vsnprintf() formatting a float).
+ */
+static void heap_report_failure(void) {
+    if (!g_heap_failure_reported) {
+        g_heap_failure_reported = true;
+        Error_Handler();
+    }
+}
+
+/*
+ * Uses `bytes` bytes of memory starting at `mem` for the heap.
+ *
+ * Returns false if the heap was already set up (by an earlier call or
+ * allocation) or the memory is too small.
+ */
+bool heap_init(void* mem, size_t bytes) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool ok = !g_heap_initialized && tlsf_init(&g_heap, mem, bytes);
+    if (ok) {
+        g_heap_initialized = true;
+    }
+    __set_PRIMASK(primask);
+    return ok;
+}
+
+/*
+ * Gets the heap's stats (all zero if the heap could not be set up).
+ */
+void heap_get_stats(TLSFStats* stats) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TLSF* heap = heap_get();
+    if (heap != NULL) {
+        tlsf_get_stats(heap, stats);
+    }
+    __set_PRIMASK(primask);
+
+    if (heap == NULL) {
+        memset(stats, 0, sizeof(TLSFStats));
+        heap_report_failure();
+    }
+}
+
+/*
+ * Checks the heap's structure (see tlsf_check()), which takes time
+ * proportional to the number of blocks with interrupts disabled.
+ */
+bool heap_check(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TLSF* heap = heap_get();
+    bool ok = (heap != NULL) && tlsf_check(heap);
+    __set_PRIMASK(primask);
+
+    if (heap == NULL) {
+        heap_report_failure();
+    }
+    return ok;
+}
+
+
+
+
+// -----------------------------------------------------------------------------
+// newlib hooks
+
+void* malloc(size_t size) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TLSF* heap = heap_get();
+    void* ptr = (heap != NULL) ? tlsf_malloc(heap, size) : NULL;
+    __set_PRIMASK(primask);
+
+    if (heap == NULL) {
+        heap_report_failure();
+    }
+    if (ptr == NULL && size != 0) {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+void free(void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TLSF* heap = heap_get();
+    // Freeing something that was not allocated here would corrupt the pool
+    if (heap == NULL || !tlsf_owns(heap, ptr)) {
+        __set_PRIMASK(primask);
+        Error_Handler();
+        return;
+    }
+    tlsf_free(heap, ptr);
+    __set_PRIMASK(primask);
+}
+
+void* realloc(void* ptr, size_t size) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TLSF* heap = heap_get();
+    if (heap == NULL) {
+        __set_PRIMASK(primask);
+        heap_report_failure();
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (ptr != NULL && !tlsf_owns(heap, ptr)) {
+        __set_PRIMASK(primask);
+        Error_Handler();
+        return NULL;
+    }
+    void* new_ptr = tlsf_realloc(heap, ptr, size);
+    __set_PRIMASK(primask);
+
+    if (new_ptr == NULL && size != 0) {
+        errno = ENOMEM;
+    }
+    return new_ptr;
+}
+
+void* calloc(size_t count, size_t size) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    TLSF* heap = heap_get();
+    void* ptr = (heap != NULL) ? tlsf_calloc(heap, count, size) : NULL;
+    __set_PRIMASK(primask);
+
+    if (heap == NULL) {
+        heap_report_failure();
+    }
+    if (ptr == NULL && count != 0 && size != 0) {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+void* _malloc_r(struct _reent* reent, size_t size) {
+    return malloc(size);
+}
+
+void _free_r(struct _reent* reent, void* ptr) {
+    free(ptr);
+}
+
+void* _realloc_r(struct _reent* reent, void* ptr, size_t size) {
+    return realloc(ptr, size);
+}
+
+void* _calloc_r(struct _reent* reent, size_t count, size_t size) {
+    return calloc(count, size);
+}
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * Heap.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_UTIL_HEAP_H_
+#define COMMON_STM32_UTIL_HEAP_H_
+
+#include <common/stm32/util/TLSF.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+bool heap_init(void* mem, size_t bytes);
+void heap_get_stats(TLSFStats* stats);
+bool heap_check(void);
+
+#endif /* COMMON_STM32_UTIL_HEAP_H_ */
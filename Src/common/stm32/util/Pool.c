@@ -0,0 +1,135 @@
+/*
+ * Pool.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Fixed-size block pool, for buffers that are passed around or shared between
+ * several users (e.g. UART buffers, log lines, sensor frames, packets) instead
+ * of each struct or stack frame having its own array.
+ *
+ * The free blocks form a singly linked list through their own first bytes (so
+ * there is no memory used per block), and allocating or freeing a block only
+ * pops or pushes the head of the list, which takes constant time.
+ *
+ * The list is updated with LDREX/STREX instead of disabling interrupts, so
+ * interrupts are never delayed and the pool can be used from ISRs of any
+ * priority. If an interrupt runs between the LDREX and STREX (and possibly
+ * changes the list), the exception clears the exclusive monitor, so the STREX
+ * fails and the operation is retried. This also means a pop can't succeed
+ * with a stale `next` link (the ABA problem), since the link is read between
+ * the LDREX and STREX. This relies on there being only one core.
+ */
+
+#include <common/stm32/mcu/Errors.h>
+#include <common/stm32/util/Pool.h>
+
+
+/*
+ * Adds delta to a counter atomically and returns the new value.
+ */
+static inline uint32_t pool_atomic_add(volatile uint32_t* value,
+        uint32_t delta) {
+    uint32_t result;
+    do {
+        result = __LDREXW(value) + delta;
+    } while (__STREXW(result, value) != 0);
+    return result;
+}
+
+/*
+ * Raises the peak to at least in_use atomically.
+ */
+static inline void pool_update_peak(Pool* pool, uint32_t in_use) {
+    do {
+        if (__LDREXW(&pool->peak_in_use) >= in_use) {
+            __CLREX();
+            return;
+        }
+    } while (__STREXW(in_use, &pool->peak_in_use) != 0);
+}
+
+/*
+ * Sets up a pool of `count` blocks of `block_size` bytes each, in `mem` (at
+ * least block_size * count bytes, aligned to 4 bytes).
+ *
+ * block_size must be a multiple of 4 and at least the size of a pointer (see
+ * POOL_BLOCK_SIZE()).
+ */
+void pool_init(Pool* pool, void* mem, uint32_t block_size, uint32_t count) {
+    if (block_size < sizeof(PoolBlock) || block_size % 4 != 0 ||
+            ((uint32_t) mem) % 4 != 0) {
+        Error_Handler();
+        return;
+    }
+
+    pool->start = (uint8_t*) mem;
+    pool->block_size = block_size;
+    pool->count = count;
+    pool->in_use = 0;
+    pool->peak_in_use = 0;
+    pool->failures = 0;
+
+    // Link the blocks in order, so they are handed out from the start
+    PoolBlock* next = NULL;
+    for (uint32_t i = count; i > 0; i--) {
+        PoolBlock* block = (PoolBlock*) (pool->start + (i - 1) * block_size);
+        block->next = next;
+        next = block;
+    }
+    pool->free_list = next;
+}
+
+/*
+ * Takes a block from the pool, or returns NULL if all blocks are in use.
+ * The block's contents are whatever was left in it.
+ */
+void* pool_alloc(Pool* pool) {
+    volatile uint32_t* head = (volatile uint32_t*) &pool->free_list;
+    PoolBlock* block;
+    do {
+        block = (PoolBlock*) __LDREXW(head);
+        if (block == NULL) {
+            __CLREX();
+            pool_atomic_add(&pool->failures, 1);
+            return NULL;
+        }
+    } while (__STREXW((uint32_t) block->next, head) != 0);
+
+    pool_update_peak(pool, pool_atomic_add(&pool->in_use, 1));
+    return block;
+}
+
+/*
+ * Returns a block to the pool (does nothing for NULL). The block must have
+ * come from pool_alloc() on the same pool.
+ */
+void pool_free(Pool* pool, void* block) {
+    if (block == NULL) {
+        return;
+    }
+    // Putting anything else on the free list would corrupt the pool
+    if (!pool_owns(pool, block) ||
+            ((uint8_t*) block - pool->start) % pool->block_size != 0) {
+        Error_Handler();
+        return;
+    }
+
+    volatile uint32_t* head = (volatile uint32_t*) &pool->free_list;
+    PoolBlock* free_block = (PoolBlock*) block;
+    do {
+        free_block->next = (PoolBlock*) __LDREXW(head);
+        // Make sure the link is written before the block is on the list
+        __DMB();
+    } while (__STREXW((uint32_t) free_block, head) != 0);
+
+    pool_atomic_add(&pool->in_use, (uint32_t) -1);
+}
+
+/*
+ * Returns true if ptr points into the pool's memory.
+ */
+bool pool_owns(Pool* pool, void* ptr) {
+    uint8_t* p = (uint8_t*) ptr;
+    return p >= pool->start &&
+            p < pool->start + pool->block_size * pool->count;
+}
@@ -0,0 +1,46 @@
+/*
+ * Pool.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_UTIL_POOL_H_
+#define COMMON_STM32_UTIL_POOL_H_
+
+#include <common/stm32/mcu/HAL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Rounds a size up to a valid block size (a multiple of 4 bytes, big enough
+// for the free list link), e.g. for declaring a pool's memory:
+//     uint8_t g_frame_blocks[8][POOL_BLOCK_SIZE(sizeof(Frame))]
+//             __attribute__((aligned(4)));
+#define POOL_BLOCK_SIZE(size) \
+    ((((size) < sizeof(PoolBlock)) ? sizeof(PoolBlock) : (size) + 3) & ~3U)
+
+// Free blocks hold the link to the next free block in their first bytes
+typedef struct PoolBlock {
+    struct PoolBlock* next;
+} PoolBlock;
+
+typedef struct {
+    // First free block (NULL if all blocks are in use)
+    PoolBlock* volatile free_list;
+
+    uint8_t* start;
+    uint32_t block_size;
+    uint32_t count;
+
+    // Number of blocks allocated now, and at most since the pool was set up
+    volatile uint32_t in_use;
+    volatile uint32_t peak_in_use;
+    // Number of allocations that returned NULL because all blocks were in use
+    volatile uint32_t failures;
+} Pool;
+
+void pool_init(Pool* pool, void* mem, uint32_t block_size, uint32_t count);
+void* pool_alloc(Pool* pool);
+void pool_free(Pool* pool, void* block);
+bool pool_owns(Pool* pool, void* ptr);
+
+#endif /* COMMON_STM32_UTIL_POOL_H_ */
@@ -0,0 +1,216 @@
+/*
+ * Profile.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Scoped profiler for measuring how long code takes (e.g. log_log(), an ISR),
+ * using zones marked with PROFILE_BEGIN() and PROFILE_END() (see Profile.h).
+ *
+ * Each zone keeps its count, min, max, total (for the mean) and a log2
+ * histogram of its times in a static table, so recording a time is a few
+ * compares and adds with no allocation. profile_dump() reports all zones.
+ *
+ * On the MCU, times come from the DWT cycle counter (CYCCNT), which counts CPU
+ * cycles and wraps around every few seconds (so a single zone must take less
+ * than that). On the host, clock_gettime() is used instead, in ns, so
+ * algorithms can be profiled off-target with the same macros.
+ *
+ * Recording is done with interrupts disabled, so the same zone can be used
+ * from both ISRs and normal code. Since the zone macros compile to nothing
+ * unless PROFILE_ENABLED is defined, the zone functions here are only used
+ * when profiling is enabled.
+ */
+
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/util/Profile.h>
+#include <common/stm32/util/StrBuf.h>
+#include <string.h>
+
+#if !defined(STM32G4) && !defined(STM32H7)
+#include <time.h>
+#endif
+
+
+FAST_BSS static ProfileZone g_profile_zones[PROFILE_MAX_ZONES];
+static uint32_t g_profile_zone_count = 0;
+
+// Used if the zone table is full, so PROFILE_END() always has a zone to
+// record into (never reported)
+static ProfileZone g_profile_overflow_zone;
+
+
+#if defined(STM32G4) || defined(STM32H7)
+
+#define PROFILE_LOCK() \
+    uint32_t primask = __get_PRIMASK(); \
+    __disable_irq()
+#define PROFILE_UNLOCK() __set_PRIMASK(primask)
+
+#else
+
+#define PROFILE_LOCK()
+#define PROFILE_UNLOCK()
+
+uint32_t profile_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec);
+}
+
+#endif
+
+
+static void profile_reset_zone(ProfileZone* zone) {
+    zone->count = 0;
+    zone->min = UINT32_MAX;
+    zone->max = 0;
+    zone->total = 0;
+    memset(zone->hist, 0, sizeof(zone->hist));
+}
+
+/*
+ * Starts the time source (the DWT cycle counter on the MCU). Must be called
+ * before any zones are used, and by anything else that reads CYCCNT (e.g.
+ * GPIOEdgeQueue.c).
+ *
+ * This can be called any number of times. The counter is only enabled if it
+ * is off, and is never reset, since other code may already be timing
+ * something with it (only differences between two readings are meaningful).
+ */
+void profile_init(void) {
+#if defined(STM32G4) || defined(STM32H7)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(STM32H7)
+    // The Cortex-M7 DWT registers are locked until this key is written
+    DWT->LAR = 0xC5ACCE55;
+#endif
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0) {
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+#endif
+}
+
+/*
+ * Returns the zone with the given name, adding it to the table if this is the
+ * first time it is used. Names are compared by pointer, since each
+ * PROFILE_BEGIN() passes its own string literal and only calls this once.
+ */
+ProfileZone* profile_get_zone(char* name) {
+    PROFILE_LOCK();
+    ProfileZone* zone = &g_profile_overflow_zone;
+    for (uint32_t i = 0; i < g_profile_zone_count; i++) {
+        if (g_profile_zones[i].name == name) {
+            zone = &g_profile_zones[i];
+            break;
+        }
+    }
+    if (zone == &g_profile_overflow_zone &&
+            g_profile_zone_count < PROFILE_MAX_ZONES) {
+        zone = &g_profile_zones[g_profile_zone_count];
+        zone->name = name;
+        profile_reset_zone(zone);
+        g_profile_zone_count++;
+    }
+    PROFILE_UNLOCK();
+    return zone;
+}
+
+/*
+ * Adds one time (in PROFILE_UNITS) to a zone.
+ */
+FAST_CODE void profile_record(ProfileZone* zone, uint32_t time) {
+    // Index of the highest set bit (0 for a time of 0 or 1)
+    uint32_t bucket = (time == 0) ? 0 : (31 - __builtin_clz(time));
+
+    PROFILE_LOCK();
+    zone->count++;
+    zone->total += time;
+    if (time < zone->min) {
+        zone->min = time;
+    }
+    if (time > zone->max) {
+        zone->max = time;
+    }
+    zone->hist[bucket]++;
+    PROFILE_UNLOCK();
+}
+
+/*
+ * Clears the stats of all zones (the zones stay in the table).
+ */
+void profile_reset(void) {
+    PROFILE_LOCK();
+    for (uint32_t i = 0; i < g_profile_zone_count; i++) {
+        profile_reset_zone(&g_profile_zones[i]);
+    }
+    PROFILE_UNLOCK();
+}
+
+/*
+ * Writes one line of the report.
+ */
+static void profile_write_line(ProfileOutput* out, char* line) {
+#if defined(STM32G4) || defined(STM32H7)
+    info(out, "%s", line);
+#else
+    fprintf(out, "%s\n", line);
+#endif
+}
+
+/*
+ * Reports every zone's count, min, mean and max, followed by its non-empty
+ * histogram buckets, e.g.
+ *     log_log: 120 calls, min 5210 / mean 6034 / max 9877 cycles
+ *       2^12: 57 2^13: 63
+ */
+void profile_dump(ProfileOutput* out) {
+    char line[120];
+    StrBuf sb;
+    strbuf_init(&sb, line, sizeof(line));
+
+    uint32_t zone_count = g_profile_zone_count;
+    if (zone_count == 0) {
+        profile_write_line(out, "No profile zones");
+        return;
+    }
+
+    for (uint32_t i = 0; i < zone_count; i++) {
+        // Copy the zone so the stats are consistent (and so logging, which
+        // might be profiled itself, doesn't change them while writing)
+        ProfileZone zone;
+        PROFILE_LOCK();
+        zone = g_profile_zones[i];
+        PROFILE_UNLOCK();
+
+        strbuf_clear(&sb);
+        if (zone.count == 0) {
+            strbuf_appendf(&sb, "%s: 0 calls", zone.name);
+            profile_write_line(out, line);
+            continue;
+        }
+        strbuf_appendf(&sb, "%s: %lu calls, min %lu / mean %lu / max %lu %s",
+                zone.name, (unsigned long) zone.count,
+                (unsigned long) zone.min,
+                (unsigned long) (zone.total / zone.count),
+                (unsigned long) zone.max, PROFILE_UNITS);
+        profile_write_line(out, line);
+
+        // Histogram, several buckets per line
+        strbuf_clear(&sb);
+        strbuf_append(&sb, " ");
+        for (uint32_t b = 0; b < PROFILE_HIST_BUCKETS; b++) {
+            if (zone.hist[b] == 0) {
+                continue;
+            }
+            // Leave room for one more bucket, otherwise start a new line
+            if (sb.len > sizeof(line) - 24) {
+                profile_write_line(out, line);
+                strbuf_clear(&sb);
+                strbuf_append(&sb, " ");
+            }
+            strbuf_appendf(&sb, " 2^%lu: %lu", (unsigned long) b,
+                    (unsigned long) zone.hist[b]);
+        }
+        profile_write_line(out, line);
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ * Profile.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_UTIL_PROFILE_H_
+#define COMMON_STM32_UTIL_PROFILE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// On the MCU, times are in CPU cycles from the DWT cycle counter, and the
+// report goes to a Log. On the host (for profiling code off-target), times are
+// in ns from clock_gettime() and the report goes to a FILE (e.g. stdout).
+#if defined(STM32G4) || defined(STM32H7)
+#include <common/stm32/uart/Log.h>
+#define PROFILE_UNITS "cycles"
+typedef Log ProfileOutput;
+#else
+#include <stdio.h>
+#define PROFILE_UNITS "ns"
+typedef FILE ProfileOutput;
+#endif
+
+// Maximum number of zones (each zone name used with PROFILE_BEGIN()/
+// PROFILE_END() takes one the first time it runs)
+#define PROFILE_MAX_ZONES 32
+// Histogram buckets: bucket n counts times in [2^n, 2^(n+1)) (bucket 0 also
+// counts 0)
+#define PROFILE_HIST_BUCKETS 32
+
+typedef struct {
+    char* name;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROFILE_HIST_BUCKETS];
+} ProfileZone;
+
+// Profiling is only compiled in if PROFILE_ENABLED is defined (e.g. with
+// `cmake -DPROFILE=ON`). Otherwise, the zone macros expand to nothing, so they
+// can be left in the code at no cost.
+//
+// Usage (the zone name must be a valid identifier, unique within the
+// function):
+//     PROFILE_BEGIN(log_log);
+//     ... code to measure ...
+//     PROFILE_END(log_log);
+#ifdef PROFILE_ENABLED
+
+// The zone is looked up once, the first time the code runs, and kept in a
+// static pointer, so each BEGIN/END after that is just a counter read
+#define PROFILE_BEGIN(name) \
+    static ProfileZone* profile_zone_##name = NULL; \
+    if (profile_zone_##name == NULL) { \
+        profile_zone_##name = profile_get_zone(#name); \
+    } \
+    uint32_t profile_start_##name = profile_now()
+
+#define PROFILE_END(name) \
+    profile_record(profile_zone_##name, \
+            profile_now() - profile_start_##name)
+
+#else
+
+#define PROFILE_BEGIN(name)
+#define PROFILE_END(name)
+
+#endif
+
+void profile_init(void);
+ProfileZone* profile_get_zone(char* name);
+void profile_record(ProfileZone* zone, uint32_t time);
+void profile_reset(void);
+void profile_dump(ProfileOutput* out);
+
+#if defined(STM32G4) || defined(STM32H7)
+
+/*
+ * Returns the current time in CPU cycles (wraps around, only differences are
+ * meaningful).
+ */
+static inline uint32_t profile_now(void) {
+    return DWT->CYCCNT;
+}
+
+#else
+
+uint32_t profile_now(void);
+
+#endif
+
+#endif /* COMMON_STM32_UTIL_PROFILE_H_ */
@@ -7,30 +7,102 @@
  * Random number generation library
  *
  * When random is initialized, use the RNG peripheral inside the MCU to generate
- * a true random number. Use that number as the seed for the C random number
- * generator, then use the C random number generator to generate all numbers
- * going forward.
+ * a true random number. Use that number as the seed for a pseudo-random number
+ * generator (PRNG), then use the PRNG to generate all numbers going forward.
  *
  * The reason for only using the RNG peripheral once to generate the seed is so
  * that we can reproduce the same sequence of random numbers again (for testing
- * purposes) by configuring the C random number library with the same seed. If
- * we generated all the random numbers with the RNG peripheral, they would all
- * be truly random and it would be impossible to reproduce that sequence of
- * numbers deterministically.
+ * purposes) by configuring the PRNG with the same seed. If we generated all the
+ * random numbers with the RNG peripheral, they would all be truly random and it
+ * would be impossible to reproduce that sequence of numbers deterministically.
+ *
+ * The PRNG is xoshiro128** (see random_next() in Random.h). We used to use the
+ * C library's rand(), but it has a single global state shared by every Random
+ * struct, is not reentrant (so it can't safely be used from ISRs), and only
+ * produces 31 bits per call. Each Random struct now has its own 128-bit state,
+ * which is expanded from the 32-bit seed so that a seed can still be logged and
+ * passed to random_set_seed() to reproduce a sequence.
+ *
+ * Separately from the PRNG, the default Random (the first one initialized,
+ * which receives the RNG interrupt) keeps a small pool of true random numbers
+ * from the RNG peripheral. The RNG interrupt refills the pool in the background
+ * whenever it is not full, so random_get_hw_entropy() never has to wait for the
+ * peripheral (e.g. for nonces or for reseeding).
  *
  * NOTE: This library is only intended to be used for randomized testing
  * programs, not for anything cryptographically secure.
  */
 
 #include <common/stm32/mcu/Errors.h>
+#include <common/stm32/mcu/Stack.h>
 #include <common/stm32/util/Random.h>
 #include <common/stm32/util/Util.h>
-#include <stdlib.h>
+#include <math.h>
 
 
 // Global pointer to "default" Random struct - for use in IRQ handler
 Random* g_random_def = NULL;
 
+// Ziggurat tables for generating normally distributed values (see
+// random_fill_normal_f32())
+// These only depend on the shape of the normal distribution, not on any Random
+// struct, so they are shared and only calculated once
+#define RANDOM_ZIGGURAT_LAYERS 128
+// x coordinate of the right edge of the base layer
+#define RANDOM_ZIGGURAT_R 3.442619855899
+// Area of each layer
+#define RANDOM_ZIGGURAT_AREA 9.91256303526217e-3
+bool g_random_zig_ready = false;
+// Thresholds for accepting a value immediately (scaled by 2^31)
+uint32_t g_random_zig_k[RANDOM_ZIGGURAT_LAYERS];
+// Layer widths (scaled by 2^-31)
+float g_random_zig_w[RANDOM_ZIGGURAT_LAYERS];
+// Value of the normal density function at the top of each layer
+float g_random_zig_f[RANDOM_ZIGGURAT_LAYERS];
+
+
+/*
+ * Expands the 32-bit seed into the full PRNG state.
+ *
+ * Each state word is produced by SplitMix32 (adding the golden ratio constant,
+ * then mixing the bits with the MurmurHash3 finalizer). Since the finalizer is
+ * a bijection and the 4 inputs are all different, at most one state word can
+ * be 0, so the state can never be all zeros (which xoshiro must avoid).
+ */
+void random_seed_state(Random* random, uint32_t seed) {
+    uint32_t z = seed;
+    for (uint32_t i = 0; i < RANDOM_STATE_WORDS; i++) {
+        z += 0x9E3779B9;
+        uint32_t x = z;
+        x = (x ^ (x >> 16)) * 0x85EBCA6B;
+        x = (x ^ (x >> 13)) * 0xC2B2AE35;
+        x ^= x >> 16;
+        random->state[i] = x;
+    }
+}
+
+
+/*
+ * Requests the next number from the RNG peripheral in interrupt mode, if a
+ * request is not already in progress.
+ *
+ * This is called from both the RNG ISR and from random_get_hw_entropy(), but
+ * never at the same time: random_get_hw_entropy() only calls it when there is
+ * no request in progress, so the RNG interrupt is disabled.
+ *
+ * Does nothing for any Random other than the default one, since the RNG
+ * interrupt only delivers numbers to the default one (see RNG_IRQHandler()).
+ */
+void random_start_hw_refill(Random* random) {
+    if (random != g_random_def || random->hw_refilling) {
+        return;
+    }
+
+    random->hw_refilling = true;
+    if (HAL_RNG_GenerateRandomNumber_IT(&random->handle) != HAL_OK) {
+        random->hw_refilling = false;
+    }
+}
 
 void random_init(Random* random, UART* uart) {
     // Initialize the log specifically for random
@@ -67,17 +139,35 @@ void random_init(Random* random, UART* uart) {
         Error_Handler();
     }
 
-    // Generate a random number from the RNG peripheral and use it to set the
-    // seed of the C random library
+    // Start the continuous health tests before taking any numbers from the
+    // RNG peripheral
+    random_health_init(&random->health);
+
+    // Generate a random number from the RNG peripheral and use it to seed
+    // this Random's PRNG
     random->seed = 0;
     HAL_RNG_GenerateRandomNumber(&random->handle, &random->seed);
-    srand(random->seed);
+    if (!random_health_check_word(&random->health, random->seed)) {
+        warning(&random->log, "RNG seed failed health test");
+    }
+    random_seed_state(random, random->seed);
 
     // Save pointer to default Random
     if (g_random_def == NULL) {
         g_random_def = random;
     }
 
+    // Start filling the entropy pool in the background
+    // Only the default Random receives RNG interrupts (see RNG_IRQHandler())
+    random->hw_pool_head = 0;
+    random->hw_pool_tail = 0;
+    random->hw_refilling = false;
+    random->hw_clock_errors = 0;
+    random->hw_seed_errors = 0;
+    if (g_random_def == random) {
+        random_start_hw_refill(random);
+    }
+
     // Log the random seed and instructions for reproducing the random sequence
     info(&random->log, "Initialized random with random seed %lu", random->seed);
     info(&random->log, "Random numbers can be reproduced using "
@@ -90,27 +180,117 @@ void random_init(Random* random, UART* uart) {
  */
 void random_set_seed(Random* random, uint32_t seed) {
     random->seed = seed;
-    srand(random->seed);
+    random_seed_state(random, random->seed);
     info(&random->log, "Manually set random seed to %lu", random->seed);
 }
 
 /*
- * Gets a raw value from rand() between 0 and INT32_MAX.
+ * Copies up to `count` true random numbers (32 bits each) from the RNG
+ * peripheral's entropy pool into `buf`, without waiting.
+ *
+ * Returns the number of values actually copied, which is less than `count` if
+ * the pool does not have enough values ready (it holds at most
+ * RANDOM_HW_POOL_SIZE values, and each value takes the RNG peripheral a few
+ * microseconds to generate).
+ *
+ * This must not be called from an ISR that can preempt another call to this
+ * function, since there can only be one consumer of the pool.
+ *
+ * Only the default Random (the first one initialized) has a pool. For any
+ * other Random, this logs a warning and returns 0.
+ */
+uint32_t random_get_hw_entropy(Random* random, uint32_t* buf, uint32_t count) {
+    if (random != g_random_def) {
+        warning(&random->log, "Only the default Random has an entropy pool");
+        return 0;
+    }
+
+    // If the RNG peripheral stopped because of an error, reinitialize it
+    // This is done here rather than in the ISR because HAL_RNG_Init() can wait
+    // for the peripheral
+    if (random->handle.State == HAL_RNG_STATE_ERROR) {
+        warning(&random->log, "Reinitializing RNG after error "
+                "(%lu clock errors, %lu seed errors)",
+                random->hw_clock_errors, random->hw_seed_errors);
+        HAL_RNG_DeInit(&random->handle);
+        if (HAL_RNG_Init(&random->handle) != HAL_OK) {
+            Error_Handler();
+        }
+        random->hw_refilling = false;
+    }
+
+    uint32_t tail = random->hw_pool_tail;
+    uint32_t available = random->hw_pool_head - tail;
+    // Make sure the values are read after the head index that says they are
+    // ready (the Cortex-M7 can reorder memory accesses)
+    __DMB();
+
+    if (count > available) {
+        count = available;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        buf[i] = random->hw_pool[(tail + i) & (RANDOM_HW_POOL_SIZE - 1)];
+    }
+
+    // Finish reading the values before giving their slots back to the ISR
+    __DMB();
+    random->hw_pool_tail = tail + count;
+
+    // The ISR stops requesting numbers when the pool is full, so request more
+    // now that there is space (this does nothing if a request is already in
+    // progress)
+    random_start_hw_refill(random);
+
+    verbose(&random->log, "Got %lu values from entropy pool", count);
+    return count;
+}
+
+/*
+ * Gets the total number of errors (clock errors and seed errors) reported by
+ * the RNG peripheral since random_init().
+ * This should stay at 0 in normal operation.
+ */
+uint32_t random_get_hw_error_count(Random* random) {
+    return random->hw_clock_errors + random->hw_seed_errors;
+}
+
+/*
+ * Gets the total number of continuous health test failures (see
+ * RandomHealth.c) on numbers from the RNG peripheral since random_init().
+ * Use random->health for the individual counters.
+ */
+uint32_t random_get_hw_health_failure_count(Random* random) {
+    return random->health.rct_failures + random->health.apt_failures;
+}
+
+/*
+ * Gets a raw value from the PRNG between 0 and UINT32_MAX (all 32 bits are
+ * random).
  */
 uint32_t random_get_raw(Random* random) {
-    // rand() generates a number between 0 and RAND_MAX (equal to INT32_MAX)
-    uint32_t number = rand();
-    verbose(&random->log, "Raw value from rand(): %lu", number);
+    uint32_t number = random_next(random);
+    verbose(&random->log, "Raw value from PRNG: %lu", number);
     return number;
 }
 
 /*
  * Gets a random unsigned integer value in the range [low, high].
  * low and high are both INCLUSIVE
- * high can be up to 2^31 - 1
+ *
+ * Every value in the range is equally likely (taking the raw value modulo the
+ * size of the range would make smaller values slightly more likely), and no
+ * division is needed (see random_next_bounded()).
  */
 uint32_t random_get_uint(Random* random, uint32_t low, uint32_t high) {
-    uint32_t number = (random_get_raw(random) % (high - low + 1)) + low;
+    // Number of possible values, which overflows to 0 if the range is the full
+    // 32 bits
+    uint32_t range = high - low + 1;
+    uint32_t number;
+    if (range == 0) {
+        number = random_next(random);
+    } else {
+        number = random_next_bounded(random, range) + low;
+    }
     debug(&random->log, "Random uint: %lu", number);
     return number;
 }
@@ -118,31 +298,222 @@ uint32_t random_get_uint(Random* random, uint32_t low, uint32_t high) {
 /*
  * Gets a random unsigned integer value in the range [0, 2^32 - 1].
  *
- * Need this function because random_get_uint() can only produce up to 2^31 - 1.
+ * The PRNG produces all 32 bits at once, so this only needs one raw value
+ * (rand() only produced 31 bits, so this used to combine two values).
  */
 uint32_t random_get_uint32(Random* random) {
-    uint32_t raw1 = random_get_raw(random);
-    uint32_t raw2 = random_get_raw(random);
-    // raw1 only has 31 random bits (bits 30:0), so take bit 0 of raw2 and make
-    // that bit 31 in the result
-    uint32_t value = raw1 | ((raw2 & bit(0)) << 31);
+    uint32_t value = random_get_raw(random);
     debug(&random->log, "Random uint32: 0x%lX", value);
     return value;
 }
 
 /*
- * Gets a random double value in the range [low, high].
- * low and high are both INCLUSIVE
+ * Gets a random float value in the range [low, high).
+ * low is INCLUSIVE, high is EXCLUSIVE
+ *
+ * Prefer this over random_get_double() when 24 bits of precision is enough,
+ * since the G4 FPU only supports single-precision and double-precision
+ * arithmetic is emulated in software.
+ */
+float random_get_float(Random* random, float low, float high) {
+    float number = (random_next_float01(random) * (high - low)) + low;
+    debug(&random->log, "Random float: %f", number);
+    return number;
+}
+
+/*
+ * Gets a random double value in the range [low, high).
+ * low is INCLUSIVE, high is EXCLUSIVE
  */
 double random_get_double(Random* random, double low, double high) {
-    // Translate to a double value between 0.0 and 1.0
-    double zero_to_one = (double) random_get_raw(random) / (double) RAND_MAX;
-    // Translate to a double value in the desired range
-    double number = (zero_to_one * (high - low)) + low;
+    // Translate to a double value in the range [0.0, 1.0), then translate to a
+    // double value in the desired range
+    double number = (random_next_double01(random) * (high - low)) + low;
     debug(&random->log, "Random double: %lf", number);
     return number;
 }
 
+/*
+ * Fills buf with `count` random values in the range [0, 2^32 - 1].
+ *
+ * The bulk fill functions generate numbers directly with the inline PRNG
+ * functions, so there is only one function call and one log level check per
+ * batch instead of per value. The loops are unrolled by 4 to reduce loop
+ * overhead.
+ */
+void random_fill_u32(Random* random, uint32_t* buf, uint32_t count) {
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        buf[i + 0] = random_next(random);
+        buf[i + 1] = random_next(random);
+        buf[i + 2] = random_next(random);
+        buf[i + 3] = random_next(random);
+    }
+    for (; i < count; i++) {
+        buf[i] = random_next(random);
+    }
+    debug(&random->log, "Filled %lu random uint32 values", count);
+}
+
+/*
+ * Fills buf with `count` random float values in the range [low, high).
+ */
+void random_fill_uniform_f32(Random* random, float* buf, uint32_t count,
+        float low, float high) {
+    float scale = high - low;
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        buf[i + 0] = (random_next_float01(random) * scale) + low;
+        buf[i + 1] = (random_next_float01(random) * scale) + low;
+        buf[i + 2] = (random_next_float01(random) * scale) + low;
+        buf[i + 3] = (random_next_float01(random) * scale) + low;
+    }
+    for (; i < count; i++) {
+        buf[i] = (random_next_float01(random) * scale) + low;
+    }
+    debug(&random->log, "Filled %lu random float values in [%f, %f)",
+            count, low, high);
+}
+
+/*
+ * Calculates the ziggurat tables (Marsaglia and Tsang, "The Ziggurat Method
+ * for Generating Random Variables", 2000).
+ *
+ * The area under the normal density curve is covered by layers (horizontal
+ * rectangles) of equal area, plus a tail beyond RANDOM_ZIGGURAT_R.
+ * Uses double-precision since it only runs once.
+ */
+void random_init_ziggurat(void) {
+    const double m = 2147483648.0;  // 2^31
+    double dn = RANDOM_ZIGGURAT_R;
+    double tn = dn;
+    double q = RANDOM_ZIGGURAT_AREA / exp(-0.5 * dn * dn);
+
+    g_random_zig_k[0] = (uint32_t) ((dn / q) * m);
+    g_random_zig_k[1] = 0;
+    g_random_zig_w[0] = (float) (q / m);
+    g_random_zig_w[RANDOM_ZIGGURAT_LAYERS - 1] = (float) (dn / m);
+    g_random_zig_f[0] = 1.0f;
+    g_random_zig_f[RANDOM_ZIGGURAT_LAYERS - 1] = (float) exp(-0.5 * dn * dn);
+
+    for (uint32_t i = RANDOM_ZIGGURAT_LAYERS - 2; i >= 1; i--) {
+        dn = sqrt(-2.0 * log((RANDOM_ZIGGURAT_AREA / dn) + exp(-0.5 * dn * dn)));
+        g_random_zig_k[i + 1] = (uint32_t) ((dn / tn) * m);
+        tn = dn;
+        g_random_zig_f[i] = (float) exp(-0.5 * dn * dn);
+        g_random_zig_w[i] = (float) (dn / m);
+    }
+
+    g_random_zig_ready = true;
+}
+
+/*
+ * Gets a random float in the range (0.0, 1.0], which is safe to pass to logf().
+ */
+static inline float random_next_float01_nonzero(Random* random) {
+    return 1.0f - random_next_float01(random);
+}
+
+/*
+ * Finishes a normally distributed value for a PRNG output `hz` that missed the
+ * fast path in random_normal_from_word(), i.e. fell in the base layer (the
+ * tail) or in a layer's wedge. Only about 1% of values get here, so this is
+ * kept out of line to keep the fast path small.
+ */
+__attribute__((noinline)) static float random_normal_slow_f32(Random* random,
+        int32_t hz) {
+    while (true) {
+        uint32_t iz = hz & (RANDOM_ZIGGURAT_LAYERS - 1);
+        float x = (float) hz * g_random_zig_w[iz];
+
+        // Base layer: sample from the tail beyond R
+        if (iz == 0) {
+            float tail_x;
+            float tail_y;
+            do {
+                tail_x = -logf(random_next_float01_nonzero(random)) *
+                        (float) (1.0 / RANDOM_ZIGGURAT_R);
+                tail_y = -logf(random_next_float01_nonzero(random));
+            } while (tail_y + tail_y < tail_x * tail_x);
+            return (hz > 0) ? (float) RANDOM_ZIGGURAT_R + tail_x :
+                    -(float) RANDOM_ZIGGURAT_R - tail_x;
+        }
+
+        // Wedge between the rectangle and the curve: accept if the point is
+        // under the curve
+        float f_low = g_random_zig_f[iz];
+        float f_high = g_random_zig_f[iz - 1];
+        if (f_low + (random_next_float01(random) * (f_high - f_low)) <
+                expf(-0.5f * x * x)) {
+            return x;
+        }
+
+        // Otherwise, try again with a new random number
+        hz = (int32_t) random_next(random);
+        iz = hz & (RANDOM_ZIGGURAT_LAYERS - 1);
+        uint32_t abs_hz = (hz < 0) ? (0 - (uint32_t) hz) : (uint32_t) hz;
+        if (abs_hz < g_random_zig_k[iz]) {
+            return (float) hz * g_random_zig_w[iz];
+        }
+    }
+}
+
+/*
+ * Gets a normally distributed value with mean 0 and standard deviation 1 from
+ * a PRNG output, using the ziggurat method.
+ *
+ * Most of the time (about 99%) the random point falls inside a layer's
+ * rectangle, so the value is accepted with a table lookup, a comparison and a
+ * multiplication. Only near the edges of the curve does it need more PRNG
+ * calls and expf() or logf() (see random_normal_slow_f32()).
+ */
+static inline float random_normal_from_word(Random* random, uint32_t word) {
+    int32_t hz = (int32_t) word;
+    uint32_t iz = hz & (RANDOM_ZIGGURAT_LAYERS - 1);
+    // Absolute value as an unsigned number so INT32_MIN doesn't overflow
+    uint32_t abs_hz = (hz < 0) ? (0 - (uint32_t) hz) : (uint32_t) hz;
+
+    // Fast path: inside the rectangle
+    if (abs_hz < g_random_zig_k[iz]) {
+        return (float) hz * g_random_zig_w[iz];
+    }
+    return random_normal_slow_f32(random, hz);
+}
+
+/*
+ * Fills buf with `count` normally distributed (Gaussian) float values with the
+ * given mean and standard deviation.
+ *
+ * Like random_fill_u32(), this generates 4 values per iteration. The 4 PRNG
+ * outputs are generated first, so the fast paths of the 4 samples (which do
+ * not depend on each other) can be scheduled together, and only the rare
+ * samples that miss the fast path branch off to random_normal_slow_f32().
+ */
+void random_fill_normal_f32(Random* random, float* buf, uint32_t count,
+        float mean, float std_dev) {
+    if (!g_random_zig_ready) {
+        random_init_ziggurat();
+    }
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32_t word0 = random_next(random);
+        uint32_t word1 = random_next(random);
+        uint32_t word2 = random_next(random);
+        uint32_t word3 = random_next(random);
+        buf[i + 0] = (random_normal_from_word(random, word0) * std_dev) + mean;
+        buf[i + 1] = (random_normal_from_word(random, word1) * std_dev) + mean;
+        buf[i + 2] = (random_normal_from_word(random, word2) * std_dev) + mean;
+        buf[i + 3] = (random_normal_from_word(random, word3) * std_dev) + mean;
+    }
+    for (; i < count; i++) {
+        buf[i] = (random_normal_from_word(random, random_next(random)) *
+                std_dev) + mean;
+    }
+    debug(&random->log, "Filled %lu normal float values (mean %f, std dev %f)",
+            count, mean, std_dev);
+}
+
 
 
 
@@ -157,6 +528,7 @@ double random_get_double(Random* random, double low, double high) {
  * startup_(...).s files.
  */
 void RNG_IRQHandler(void) {
+    STACK_SAMPLE_ISR(rng_irq);
     // Call the IRQ handler function in the HAL
     if (g_random_def != NULL) {
         HAL_RNG_IRQHandler(&g_random_def->handle);
@@ -173,5 +545,57 @@ void RNG_IRQHandler(void) {
  * This function is called by HAL_RNG_IRQHandler() in the HAL.
  */
 void HAL_RNG_ErrorCallback(RNG_HandleTypeDef* hrng) {
-    Error_Handler();
+    if (g_random_def == NULL || hrng != &g_random_def->handle) {
+        return;
+    }
+
+    // Only count the error here, the peripheral is reinitialized the next time
+    // random_get_hw_entropy() is called
+    // Logging from this ISR is not safe (see uart_write_dma())
+    // ErrorCode is a bit mask, so both can be set at once
+    if (hrng->ErrorCode & HAL_RNG_ERROR_CLOCK) {
+        g_random_def->hw_clock_errors++;
+    }
+    if (hrng->ErrorCode & HAL_RNG_ERROR_SEED) {
+        g_random_def->hw_seed_errors++;
+    }
+    g_random_def->hw_refilling = false;
+}
+
+/**
+ * @brief  Data Ready callback in non-blocking mode.
+ * @param  hrng pointer to a RNG_HandleTypeDef structure that contains
+ *                the configuration information for RNG.
+ * @param  random32bit generated random number.
+ * @retval None
+ *
+ * This overrides the weak function of the same name in the HAL.
+ * This function is called by HAL_RNG_IRQHandler() in the HAL after a number
+ * requested with HAL_RNG_GenerateRandomNumber_IT() is ready.
+ */
+void HAL_RNG_ReadyDataCallback(RNG_HandleTypeDef* hrng, uint32_t random32bit) {
+    if (g_random_def == NULL || hrng != &g_random_def->handle) {
+        return;
+    }
+    Random* random = g_random_def;
+
+    // Discard numbers that fail the health tests
+    bool healthy = random_health_check_word(&random->health, random32bit);
+
+    uint32_t head = random->hw_pool_head;
+    if (healthy && head - random->hw_pool_tail < RANDOM_HW_POOL_SIZE) {
+        random->hw_pool[head & (RANDOM_HW_POOL_SIZE - 1)] = random32bit;
+        // Make sure the value is written before the consumer can see the new
+        // head index
+        __DMB();
+        head++;
+        random->hw_pool_head = head;
+    }
+
+    // Keep generating until the pool is full
+    // random_get_hw_entropy() restarts generation after taking values out
+    random->hw_refilling = false;
+    if (head - random->hw_pool_tail < RANDOM_HW_POOL_SIZE) {
+        random_start_hw_refill(random);
+    }
 }
@@ -9,19 +9,153 @@
 #define COMMON_STM32_UTIL_RANDOM_H_
 
 #include <common/stm32/uart/Log.h>
+#include <common/stm32/util/RandomHealth.h>
+#include <string.h>
+
+// Number of 32-bit words of PRNG state (xoshiro128** has 128 bits of state)
+#define RANDOM_STATE_WORDS 4
+
+// Number of 32-bit words of true random numbers kept ready from the RNG
+// peripheral
+// Must be a power of 2 so the indices can wrap around with a mask
+#define RANDOM_HW_POOL_SIZE 16
 
 typedef struct {
     Log log;
     RNG_HandleTypeDef handle;
     uint32_t seed;
+    // PRNG state, expanded from the seed
+    // Each Random has its own state, so multiple Random structs do not affect
+    // each other's sequences
+    uint32_t state[RANDOM_STATE_WORDS];
+
+    // Pool of true random numbers, kept full by the RNG interrupt in the
+    // background (see random_get_hw_entropy()), only for the default Random
+    // This is a single-producer (RNG ISR), single-consumer ring buffer
+    // The indices count up forever and are masked when accessing the array
+    volatile uint32_t hw_pool[RANDOM_HW_POOL_SIZE];
+    // Only written by the ISR
+    volatile uint32_t hw_pool_head;
+    // Only written by random_get_hw_entropy()
+    volatile uint32_t hw_pool_tail;
+    // True while an interrupt-mode generation has been requested
+    volatile bool hw_refilling;
+
+    // Health counters for errors reported by the RNG peripheral
+    volatile uint32_t hw_clock_errors;
+    volatile uint32_t hw_seed_errors;
+    // Continuous statistical tests on every word from the RNG peripheral
+    // Words that fail are discarded instead of being put in the pool
+    RandomHealth health;
 } Random;
 
+
+/*
+ * Rotates the bits of x left by k bits (k must be between 1 and 31).
+ */
+static inline uint32_t random_rotl(uint32_t x, uint32_t k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+/*
+ * Advances the PRNG state and returns the next 32 random bits.
+ * This is xoshiro128** (https://prng.di.unimi.it/xoshiro128starstar.c), which
+ * only needs a few shifts, XORs and multiplies per number.
+ *
+ * It is inline (and does not log anything) so that functions generating many
+ * numbers can call it in a loop without the overhead of a function call.
+ */
+static inline uint32_t random_next(Random* random) {
+    uint32_t* s = random->state;
+    uint32_t result = random_rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = random_rotl(s[3], 11);
+
+    return result;
+}
+
+/*
+ * Gets a random number in the range [0, range) using Lemire's multiply-shift
+ * method (https://arxiv.org/abs/1805.10941), where range must be at least 1.
+ *
+ * Taking the upper 32 bits of (random * range) maps the 32 random bits onto
+ * [0, range) without a division. A few values of the low 32 bits would make
+ * some results slightly more likely than others, so those are rejected and
+ * regenerated. The threshold for rejection needs a division, but it is only
+ * calculated in the rare case (probability range / 2^32) that the low bits are
+ * small enough to possibly be rejected.
+ */
+static inline uint32_t random_next_bounded(Random* random, uint32_t range) {
+    uint64_t product = (uint64_t) random_next(random) * range;
+    uint32_t low_bits = (uint32_t) product;
+
+    if (low_bits < range) {
+        // Equal to 2^32 mod range
+        uint32_t threshold = (0 - range) % range;
+        while (low_bits < threshold) {
+            product = (uint64_t) random_next(random) * range;
+            low_bits = (uint32_t) product;
+        }
+    }
+
+    return (uint32_t) (product >> 32);
+}
+
+/*
+ * Gets a random float in the range [0.0, 1.0).
+ *
+ * Instead of converting an integer and dividing, this puts 23 random bits
+ * directly into the mantissa of a float with exponent 0, which gives a value
+ * in the range [1.0, 2.0), then subtracts 1.0. Everything is single-precision,
+ * which the FPU on both the G4 and H7 supports in hardware.
+ */
+static inline float random_next_float01(Random* random) {
+    // 0x3F800000 is 1.0f (sign 0, exponent 127, mantissa 0)
+    uint32_t bits = 0x3F800000 | (random_next(random) >> 9);
+    float one_to_two;
+    // memcpy is the standard-compliant way to reinterpret the bits and
+    // compiles down to a single register move
+    memcpy(&one_to_two, &bits, sizeof(one_to_two));
+    return one_to_two - 1.0f;
+}
+
+/*
+ * Gets a random double in the range [0.0, 1.0), with 53 random bits (the full
+ * precision of a double).
+ *
+ * The 53-bit integer is multiplied by 2^-53 instead of being divided.
+ */
+static inline double random_next_double01(Random* random) {
+    uint64_t high_bits = random_next(random) >> 5;
+    uint64_t low_bits = random_next(random) >> 6;
+    uint64_t value = (high_bits << 26) | low_bits;
+    // 2^-53
+    return (double) value * (1.0 / 9007199254740992.0);
+}
+
 void random_init(Random* random, UART* uart);
 void random_set_seed(Random* random, uint32_t seed);
 
+uint32_t random_get_hw_entropy(Random* random, uint32_t* buf, uint32_t count);
+uint32_t random_get_hw_error_count(Random* random);
+uint32_t random_get_hw_health_failure_count(Random* random);
+
 uint32_t random_get_raw(Random* random);
 uint32_t random_get_uint(Random* random, uint32_t low, uint32_t high);
 uint32_t random_get_uint32(Random* random);
+float random_get_float(Random* random, float low, float high);
 double random_get_double(Random* random, double low, double high);
 
+void random_fill_u32(Random* random, uint32_t* buf, uint32_t count);
+void random_fill_uniform_f32(Random* random, float* buf, uint32_t count,
+        float low, float high);
+void random_fill_normal_f32(Random* random, float* buf, uint32_t count,
+        float mean, float std_dev);
+
 #endif /* COMMON_STM32_UTIL_RANDOM_H_ */
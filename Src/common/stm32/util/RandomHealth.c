@@ -0,0 +1,119 @@
+/*
+ * RandomHealth.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Continuous health tests for a hardware entropy source (e.g. the RNG
+ * peripheral), based on NIST SP 800-90B Section 4.4:
+ * - Repetition count test (RCT) - detects the source getting stuck on one
+ *   value
+ * - Adaptive proportion test (APT) - detects the source producing one value
+ *   much more often than it should (losing entropy)
+ *
+ * The RNG peripheral's own error flags only catch clock and seed errors, so
+ * these tests watch the actual values coming out of it.
+ *
+ * Each 32-bit word is split into 4 byte samples. Both tests only keep a few
+ * counters and update them once per sample, so checking a word takes constant
+ * time and memory.
+ *
+ * This module does not depend on the HAL, so it can also be fed a simulated
+ * source (see Manual_Tests/common/stm32/random_health).
+ */
+
+#include <common/stm32/util/RandomHealth.h>
+#include <stddef.h>
+
+
+void random_health_init(RandomHealth* health) {
+    health->rct_value = 0;
+    health->rct_count = 0;
+    health->apt_value = 0;
+    health->apt_count = 0;
+    health->apt_index = 0;
+    health->samples = 0;
+    health->rct_failures = 0;
+    health->apt_failures = 0;
+    health->failure_cb = NULL;
+    health->failure_context = NULL;
+}
+
+/*
+ * Sets a function to be called whenever a test fails. The callback can be
+ * NULL to only count failures.
+ */
+void random_health_set_failure_cb(RandomHealth* health,
+        RandomHealthFailureCB callback, void* context) {
+    health->failure_cb = callback;
+    health->failure_context = context;
+}
+
+void random_health_fail(RandomHealth* health, RandomHealthTest test) {
+    if (test == RANDOM_HEALTH_TEST_RCT) {
+        health->rct_failures++;
+    } else {
+        health->apt_failures++;
+    }
+
+    if (health->failure_cb != NULL) {
+        health->failure_cb(health->failure_context, test);
+    }
+}
+
+/*
+ * Runs both tests on one sample.
+ * Returns true if both tests passed, false if either failed.
+ */
+bool random_health_check_sample(RandomHealth* health, uint8_t sample) {
+    bool passed = true;
+    health->samples++;
+
+    // Repetition count test
+    if (health->rct_count > 0 && sample == health->rct_value) {
+        health->rct_count++;
+        if (health->rct_count >= RANDOM_HEALTH_RCT_CUTOFF) {
+            random_health_fail(health, RANDOM_HEALTH_TEST_RCT);
+            passed = false;
+            // Start counting again so a stuck source keeps failing
+            health->rct_count = 1;
+        }
+    } else {
+        health->rct_value = sample;
+        health->rct_count = 1;
+    }
+
+    // Adaptive proportion test
+    // The first sample of each window is the value to count for the rest of
+    // the window
+    if (health->apt_index == 0) {
+        health->apt_value = sample;
+        health->apt_count = 1;
+    } else if (sample == health->apt_value) {
+        health->apt_count++;
+        // Use == instead of >= so it only fails once per window
+        if (health->apt_count == RANDOM_HEALTH_APT_CUTOFF) {
+            random_health_fail(health, RANDOM_HEALTH_TEST_APT);
+            passed = false;
+        }
+    }
+    health->apt_index++;
+    if (health->apt_index >= RANDOM_HEALTH_APT_WINDOW) {
+        health->apt_index = 0;
+    }
+
+    return passed;
+}
+
+/*
+ * Runs both tests on the 4 bytes of a word (least significant byte first).
+ * Returns true if all tests passed, false if any failed (in which case the
+ * word should not be used).
+ */
+bool random_health_check_word(RandomHealth* health, uint32_t word) {
+    // Use & instead of && so all 4 samples are always checked
+    bool passed = random_health_check_sample(health, word & 0xFF);
+    passed &= random_health_check_sample(health, (word >> 8) & 0xFF);
+    passed &= random_health_check_sample(health, (word >> 16) & 0xFF);
+    passed &= random_health_check_sample(health, (word >> 24) & 0xFF);
+    return passed;
+}
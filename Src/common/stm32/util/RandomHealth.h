@@ -0,0 +1,60 @@
+/*
+ * RandomHealth.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_UTIL_RANDOMHEALTH_H_
+#define COMMON_STM32_UTIL_RANDOMHEALTH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Assumed min-entropy of each sample (byte), in bits
+// The cutoffs below are calculated from this with a false positive
+// probability of 2^-20 per sample (NIST SP 800-90B Section 4.4)
+#define RANDOM_HEALTH_ENTROPY_BITS 4
+// Repetition count test: fail if the same sample repeats this many times in a
+// row (1 + ceil(20 / H))
+#define RANDOM_HEALTH_RCT_CUTOFF 6
+// Adaptive proportion test: fail if the first sample of a window appears this
+// many times in the window (1 + CRITBINOM(512, 2^-H, 1 - 2^-20))
+#define RANDOM_HEALTH_APT_WINDOW 512
+#define RANDOM_HEALTH_APT_CUTOFF 62
+
+typedef enum {
+    RANDOM_HEALTH_TEST_RCT,
+    RANDOM_HEALTH_TEST_APT,
+} RandomHealthTest;
+
+// Called when a health test fails
+// Note this may be called from an ISR (e.g. the RNG interrupt)
+typedef void (*RandomHealthFailureCB)(void* context, RandomHealthTest test);
+
+typedef struct {
+    // Repetition count test state
+    uint8_t rct_value;
+    uint32_t rct_count;
+
+    // Adaptive proportion test state
+    uint8_t apt_value;
+    uint32_t apt_count;
+    // Position of the next sample in the current window
+    uint32_t apt_index;
+
+    // Counters
+    uint32_t samples;
+    uint32_t rct_failures;
+    uint32_t apt_failures;
+
+    RandomHealthFailureCB failure_cb;
+    void* failure_context;
+} RandomHealth;
+
+void random_health_init(RandomHealth* health);
+void random_health_set_failure_cb(RandomHealth* health,
+        RandomHealthFailureCB callback, void* context);
+bool random_health_check_sample(RandomHealth* health, uint8_t sample);
+bool random_health_check_word(RandomHealth* health, uint32_t word);
+
+#endif /* COMMON_STM32_UTIL_RANDOMHEALTH_H_ */
@@ -0,0 +1,160 @@
+/*
+ * StrBuf.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Length-tracking string builder, used instead of repeated calls to
+ * util_safe_strncat() when assembling a string from several pieces.
+ *
+ * util_safe_strncat() has to call strlen() on the destination every time it is
+ * called, so building a string from N pieces costs O(N * length). A StrBuf
+ * remembers where the string currently ends, so each append only costs as much
+ * as the piece being appended.
+ *
+ * The buffer always contains a valid C string (terminated with \0), so it can
+ * be passed directly to functions that expect one. If an append does not fit,
+ * as many characters as possible are copied, the rest are discarded and
+ * `truncated` is set (similar to snprintf()).
+ */
+
+#include <common/stm32/mcu/Sections.h>
+#include <common/stm32/util/StrBuf.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * size must be at least 1 so there is space for the \0 character.
+ */
+void strbuf_init(StrBuf* sb, char* buf, size_t size) {
+    sb->buf = buf;
+    sb->size = size;
+    strbuf_clear(sb);
+}
+
+/*
+ * Empties the string so the buffer can be reused.
+ */
+void strbuf_clear(StrBuf* sb) {
+    sb->len = 0;
+    sb->truncated = false;
+    if (sb->size > 0) {
+        sb->buf[0] = '\0';
+    }
+}
+
+/*
+ * Returns the number of characters that can still be appended (not including
+ * the \0 character).
+ */
+static size_t strbuf_remaining(StrBuf* sb) {
+    if (sb->size == 0) {
+        return 0;
+    }
+    return (sb->size - 1) - sb->len;
+}
+
+/*
+ * Appends `count` characters from `chars` (which does not need to be a C
+ * string), truncating if necessary.
+ */
+static void strbuf_append_chars(StrBuf* sb, char* chars, size_t count) {
+    size_t remaining = strbuf_remaining(sb);
+    if (count > remaining) {
+        count = remaining;
+        sb->truncated = true;
+    }
+
+    memcpy(&sb->buf[sb->len], chars, count);
+    sb->len += count;
+    if (sb->size > 0) {
+        sb->buf[sb->len] = '\0';
+    }
+}
+
+FAST_CODE void strbuf_append(StrBuf* sb, char* str) {
+    strbuf_append_chars(sb, str, strlen(str));
+}
+
+void strbuf_append_char(StrBuf* sb, char c) {
+    strbuf_append_chars(sb, &c, 1);
+}
+
+/*
+ * Appends an unsigned integer in decimal form, equivalent to "%lu" but without
+ * going through snprintf().
+ */
+FAST_CODE void strbuf_append_u32(StrBuf* sb, uint32_t value) {
+    // 2^32 - 1 = 4294967295 has 10 digits
+    char digits[10];
+    size_t count = 0;
+
+    // Generate digits from least to most significant, filling the array from
+    // the end so they come out in the right order
+    do {
+        digits[sizeof(digits) - 1 - count] = '0' + (value % 10);
+        value /= 10;
+        count++;
+    } while (value > 0);
+
+    strbuf_append_chars(sb, &digits[sizeof(digits) - count], count);
+}
+
+/*
+ * Appends an unsigned integer in uppercase hexadecimal form (without a "0x"
+ * prefix), padded with zeros to at least min_digits digits.
+ * Equivalent to "%.<min_digits>lX", e.g. (0xA, 2) -> "0A", (0x1F3, 2) -> "1F3"
+ */
+void strbuf_append_hex(StrBuf* sb, uint32_t value, uint32_t min_digits) {
+    static const char hex_chars[] = "0123456789ABCDEF";
+    // 32 bits is 8 hex digits
+    char digits[8];
+    size_t count = 0;
+
+    if (min_digits > sizeof(digits)) {
+        min_digits = sizeof(digits);
+    }
+
+    do {
+        digits[sizeof(digits) - 1 - count] = hex_chars[value & 0xF];
+        value >>= 4;
+        count++;
+    } while (value > 0 || count < min_digits);
+
+    strbuf_append_chars(sb, &digits[sizeof(digits) - count], count);
+}
+
+/*
+ * Appends a printf-style formatted string.
+ */
+void strbuf_appendf(StrBuf* sb, char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    strbuf_vappendf(sb, format, args);
+    va_end(args);
+}
+
+FAST_CODE void strbuf_vappendf(StrBuf* sb, char* format, va_list args) {
+    if (sb->size == 0) {
+        sb->truncated = true;
+        return;
+    }
+
+    // Format directly into the unused part of the buffer
+    // vsnprintf() returns the number of characters that WOULD have been
+    // written if there was enough space, not the number actually written
+    size_t available = sb->size - sb->len;
+    int count = vsnprintf(&sb->buf[sb->len], available, format, args);
+    if (count < 0) {
+        // Encoding error, leave the string as it was
+        sb->buf[sb->len] = '\0';
+        return;
+    }
+
+    if ((size_t) count >= available) {
+        sb->len = sb->size - 1;
+        sb->truncated = true;
+    } else {
+        sb->len += count;
+    }
+}
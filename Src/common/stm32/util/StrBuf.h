@@ -0,0 +1,39 @@
+/*
+ * StrBuf.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_UTIL_STRBUF_H_
+#define COMMON_STM32_UTIL_STRBUF_H_
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A string being built in a caller-provided char buffer
+// Tracking the length means appending never has to call strlen() on the
+// string that is already in the buffer
+typedef struct {
+    // Start of the buffer (always contains a C string with a \0 at buf[len])
+    char* buf;
+    // Total size of the buffer in bytes, including space for the \0
+    size_t size;
+    // Number of characters currently in the buffer (not including the \0)
+    size_t len;
+    // Set to true if any append did not fit and was cut off
+    bool truncated;
+} StrBuf;
+
+void strbuf_init(StrBuf* sb, char* buf, size_t size);
+void strbuf_clear(StrBuf* sb);
+
+void strbuf_append(StrBuf* sb, char* str);
+void strbuf_append_char(StrBuf* sb, char c);
+void strbuf_append_u32(StrBuf* sb, uint32_t value);
+void strbuf_append_hex(StrBuf* sb, uint32_t value, uint32_t min_digits);
+void strbuf_appendf(StrBuf* sb, char* format, ...);
+void strbuf_vappendf(StrBuf* sb, char* format, va_list args);
+
+#endif /* COMMON_STM32_UTIL_STRBUF_H_ */
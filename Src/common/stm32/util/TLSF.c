@@ -0,0 +1,540 @@
+/*
+ * TLSF.c
+ *
+ *  Created on: Oct. 19, 2026
+ *
+ * Two-level segregated fit (TLSF) allocator (M. Masmano, I. Ripoll, A. Crespo
+ * and J. Real, "TLSF: a New Dynamic Memory Allocator for Real-Time Systems").
+ *
+ * Free blocks are kept in lists by size: the first level splits sizes into
+ * power of 2 ranges, and the second level splits each range into TLSF_SL_COUNT
+ * equal parts. A bitmap per level records which lists have any blocks, so:
+ * - Allocating rounds the size up to the next list boundary, then finds the
+ *   first non-empty list at or above it with two find-first-set operations.
+ *   Any block in that list is big enough, so the first one is taken (and
+ *   split if it has room left over) without searching.
+ * - Freeing merges the block with its neighbours in memory if they are free
+ *   (each block points to the one before it, and its size gives the one after
+ *   it), then puts it at the head of its list.
+ * Neither has a loop that depends on the number of blocks, so both take a
+ * bounded time, unlike newlib's allocator, which walks its free list (and
+ * calls _sbrk()).
+ *
+ * Each block has a header (the previous block's address and its size) just
+ * before its data. Free blocks also keep their list links in their data, so
+ * the smallest block holds 2 pointers.
+ *
+ * This module does not depend on the HAL (so it can be tested and compared to
+ * other allocators off-target) and does not lock anything itself (see Heap.c
+ * for the malloc() wrapper).
+ */
+
+#include <common/stm32/util/TLSF.h>
+#include <string.h>
+
+// Bit 0 of TLSFBlock.size
+#define TLSF_BLOCK_FREE 1
+// Bytes between a block and its data
+#define TLSF_HEADER_SIZE offsetof(TLSFBlock, next_free)
+// Smallest data size, so a free block can hold its list links
+#define TLSF_BLOCK_SIZE_MIN \
+    ((sizeof(TLSFBlock) - TLSF_HEADER_SIZE + TLSF_ALIGN - 1) & \
+    ~((size_t) TLSF_ALIGN - 1))
+// Largest data size (smaller than 2^TLSF_FL_MAX)
+#define TLSF_BLOCK_SIZE_MAX (((size_t) 1 << TLSF_FL_MAX) - TLSF_ALIGN)
+
+
+/*
+ * Returns the index of the highest set bit (size must not be 0).
+ */
+static inline uint32_t tlsf_fls(size_t size) {
+    return (sizeof(unsigned long) * 8 - 1) - __builtin_clzl(size);
+}
+
+static inline size_t tlsf_align_up(size_t size) {
+    return (size + (TLSF_ALIGN - 1)) & ~((size_t) TLSF_ALIGN - 1);
+}
+
+static inline size_t tlsf_block_size(TLSFBlock* block) {
+    return block->size & ~((size_t) TLSF_BLOCK_FREE);
+}
+
+static inline bool tlsf_block_is_free(TLSFBlock* block) {
+    return (block->size & TLSF_BLOCK_FREE) != 0;
+}
+
+static inline void* tlsf_block_to_ptr(TLSFBlock* block) {
+    return (uint8_t*) block + TLSF_HEADER_SIZE;
+}
+
+static inline TLSFBlock* tlsf_ptr_to_block(void* ptr) {
+    return (TLSFBlock*) ((uint8_t*) ptr - TLSF_HEADER_SIZE);
+}
+
+/*
+ * Returns the block just after this one in memory (the last block in the pool
+ * is followed by a used block of size 0).
+ */
+static inline TLSFBlock* tlsf_block_next(TLSFBlock* block) {
+    return (TLSFBlock*) ((uint8_t*) tlsf_block_to_ptr(block) +
+            tlsf_block_size(block));
+}
+
+/*
+ * Gets the list a block of this size belongs in (rounding down).
+ */
+static inline void tlsf_mapping_insert(size_t size, uint32_t* fl,
+        uint32_t* sl) {
+    if (size < TLSF_SMALL_BLOCK_SIZE) {
+        *fl = 0;
+        *sl = size >> TLSF_ALIGN_LOG2;
+    } else {
+        uint32_t f = tlsf_fls(size);
+        *sl = (size >> (f - TLSF_SL_COUNT_LOG2)) ^ TLSF_SL_COUNT;
+        *fl = f - (TLSF_FL_SHIFT - 1);
+    }
+}
+
+/*
+ * Gets the first list where every block is at least this size (rounding up).
+ */
+static inline void tlsf_mapping_search(size_t size, uint32_t* fl,
+        uint32_t* sl) {
+    if (size >= TLSF_SMALL_BLOCK_SIZE) {
+        size += ((size_t) 1 << (tlsf_fls(size) - TLSF_SL_COUNT_LOG2)) - 1;
+    }
+    tlsf_mapping_insert(size, fl, sl);
+}
+
+/*
+ * Gets the smallest size in the list a block of this size belongs in, which is
+ * the largest request that is sure to find the block (rounding down).
+ */
+static inline size_t tlsf_mapping_floor(size_t size) {
+    if (size < TLSF_SMALL_BLOCK_SIZE) {
+        return size;
+    }
+    return size & ~(((size_t) 1 << (tlsf_fls(size) - TLSF_SL_COUNT_LOG2)) - 1);
+}
+
+/*
+ * Finds the first non-empty list at or after [fl][sl], or returns NULL if
+ * there is none.
+ */
+static inline TLSFBlock* tlsf_find_suitable(TLSF* tlsf, uint32_t* fl,
+        uint32_t* sl) {
+    if (*fl >= TLSF_FL_COUNT) {
+        return NULL;
+    }
+
+    // Any larger list at the same first level
+    uint32_t sl_map = tlsf->sl_bitmap[*fl] & (~0U << *sl);
+    if (sl_map == 0) {
+        // Otherwise, the smallest list at any larger first level
+        uint32_t fl_map = tlsf->fl_bitmap & (~0U << (*fl + 1));
+        if (fl_map == 0) {
+            return NULL;
+        }
+        *fl = __builtin_ctz(fl_map);
+        sl_map = tlsf->sl_bitmap[*fl];
+    }
+    *sl = __builtin_ctz(sl_map);
+    return tlsf->blocks[*fl][*sl];
+}
+
+static void tlsf_remove_free(TLSF* tlsf, TLSFBlock* block, uint32_t fl,
+        uint32_t sl) {
+    TLSFBlock* prev = block->prev_free;
+    TLSFBlock* next = block->next_free;
+    next->prev_free = prev;
+    prev->next_free = next;
+
+    if (tlsf->blocks[fl][sl] == block) {
+        tlsf->blocks[fl][sl] = next;
+        if (next == &tlsf->block_null) {
+            tlsf->sl_bitmap[fl] &= ~(1U << sl);
+            if (tlsf->sl_bitmap[fl] == 0) {
+                tlsf->fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+    tlsf->free_blocks--;
+}
+
+static void tlsf_insert_free(TLSF* tlsf, TLSFBlock* block) {
+    uint32_t fl;
+    uint32_t sl;
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+
+    TLSFBlock* head = tlsf->blocks[fl][sl];
+    block->next_free = head;
+    block->prev_free = &tlsf->block_null;
+    head->prev_free = block;
+    tlsf->blocks[fl][sl] = block;
+
+    tlsf->fl_bitmap |= 1U << fl;
+    tlsf->sl_bitmap[fl] |= 1U << sl;
+    tlsf->free_blocks++;
+}
+
+static inline void tlsf_remove_free_block(TLSF* tlsf, TLSFBlock* block) {
+    uint32_t fl;
+    uint32_t sl;
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+    tlsf_remove_free(tlsf, block, fl, sl);
+}
+
+/*
+ * If a used block has room for another block after the first `size` bytes,
+ * splits that off and frees it (merging it with the next block if that is
+ * free).
+ */
+static void tlsf_trim_used(TLSF* tlsf, TLSFBlock* block, size_t size) {
+    size_t block_size = tlsf_block_size(block);
+    if (block_size < size + TLSF_HEADER_SIZE + TLSF_BLOCK_SIZE_MIN) {
+        return;
+    }
+
+    TLSFBlock* rest = (TLSFBlock*) ((uint8_t*) tlsf_block_to_ptr(block) +
+            size);
+    rest->prev_phys = block;
+    rest->size = (block_size - size - TLSF_HEADER_SIZE) | TLSF_BLOCK_FREE;
+    block->size = size;
+    tlsf->used_bytes -= block_size - size;
+
+    TLSFBlock* next = tlsf_block_next(rest);
+    if (tlsf_block_is_free(next)) {
+        tlsf_remove_free_block(tlsf, next);
+        rest->size += tlsf_block_size(next) + TLSF_HEADER_SIZE;
+        next = tlsf_block_next(rest);
+    }
+    next->prev_phys = rest;
+    tlsf_insert_free(tlsf, rest);
+}
+
+/*
+ * Converts a requested size to a block data size, or returns 0 if it is too
+ * big for any block.
+ */
+static inline size_t tlsf_adjust_size(size_t size) {
+    if (size > TLSF_BLOCK_SIZE_MAX) {
+        return 0;
+    }
+    size = tlsf_align_up(size);
+    return (size < TLSF_BLOCK_SIZE_MIN) ? TLSF_BLOCK_SIZE_MIN : size;
+}
+
+
+/*
+ * Sets up a pool over `bytes` bytes of memory starting at `mem`, as one free
+ * block. Any memory past what the largest block can hold (about 1 MB) is not
+ * used.
+ *
+ * Returns false if the memory is too small to hold a block.
+ */
+bool tlsf_init(TLSF* tlsf, void* mem, size_t bytes) {
+    tlsf->fl_bitmap = 0;
+    for (uint32_t i = 0; i < TLSF_FL_COUNT; i++) {
+        tlsf->sl_bitmap[i] = 0;
+        for (uint32_t j = 0; j < TLSF_SL_COUNT; j++) {
+            tlsf->blocks[i][j] = &tlsf->block_null;
+        }
+    }
+    tlsf->block_null.next_free = &tlsf->block_null;
+    tlsf->block_null.prev_free = &tlsf->block_null;
+    tlsf->block_null.prev_phys = NULL;
+    tlsf->block_null.size = 0;
+
+    tlsf->pool_start = NULL;
+    tlsf->pool_bytes = 0;
+    tlsf->used_bytes = 0;
+    tlsf->peak_used_bytes = 0;
+    tlsf->free_blocks = 0;
+    tlsf->allocs = 0;
+    tlsf->frees = 0;
+    tlsf->failures = 0;
+
+    // Align the start, then leave room for the end marker's header
+    uintptr_t start = ((uintptr_t) mem + (TLSF_ALIGN - 1)) &
+            ~((uintptr_t) TLSF_ALIGN - 1);
+    uintptr_t end = (uintptr_t) mem + bytes;
+    if (end < start + 2 * TLSF_HEADER_SIZE + TLSF_BLOCK_SIZE_MIN) {
+        return false;
+    }
+    size_t size = (end - start - 2 * TLSF_HEADER_SIZE) &
+            ~((size_t) TLSF_ALIGN - 1);
+    if (size > TLSF_BLOCK_SIZE_MAX) {
+        size = TLSF_BLOCK_SIZE_MAX;
+    }
+
+    TLSFBlock* block = (TLSFBlock*) start;
+    block->prev_phys = NULL;
+    block->size = size | TLSF_BLOCK_FREE;
+
+    // A used block of size 0 marks the end, so the last block is never merged
+    // past it
+    TLSFBlock* end_marker = tlsf_block_next(block);
+    end_marker->prev_phys = block;
+    end_marker->size = 0;
+
+    tlsf_insert_free(tlsf, block);
+    tlsf->pool_start = (uint8_t*) block;
+    tlsf->pool_bytes = size + TLSF_HEADER_SIZE;
+    return true;
+}
+
+/*
+ * Allocates at least `size` bytes, aligned to TLSF_ALIGN. Returns NULL if
+ * there is no free block big enough (or size is 0).
+ */
+void* tlsf_malloc(TLSF* tlsf, size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+    size_t adjusted = tlsf_adjust_size(size);
+    if (adjusted == 0) {
+        tlsf->failures++;
+        return NULL;
+    }
+
+    uint32_t fl;
+    uint32_t sl;
+    tlsf_mapping_search(adjusted, &fl, &sl);
+    TLSFBlock* block = tlsf_find_suitable(tlsf, &fl, &sl);
+    if (block == NULL) {
+        tlsf->failures++;
+        return NULL;
+    }
+
+    // The block is at the head of its list
+    tlsf_remove_free(tlsf, block, fl, sl);
+    block->size &= ~((size_t) TLSF_BLOCK_FREE);
+    tlsf->used_bytes += tlsf_block_size(block) + TLSF_HEADER_SIZE;
+    tlsf_trim_used(tlsf, block, adjusted);
+
+    if (tlsf->used_bytes > tlsf->peak_used_bytes) {
+        tlsf->peak_used_bytes = tlsf->used_bytes;
+    }
+    tlsf->allocs++;
+    return tlsf_block_to_ptr(block);
+}
+
+/*
+ * Frees memory returned by tlsf_malloc()/tlsf_realloc()/tlsf_calloc() (does
+ * nothing for NULL).
+ */
+void tlsf_free(TLSF* tlsf, void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    TLSFBlock* block = tlsf_ptr_to_block(ptr);
+    tlsf->used_bytes -= tlsf_block_size(block) + TLSF_HEADER_SIZE;
+    tlsf->frees++;
+
+    // Merge with the previous block
+    TLSFBlock* prev = block->prev_phys;
+    if (prev != NULL && tlsf_block_is_free(prev)) {
+        tlsf_remove_free_block(tlsf, prev);
+        prev->size += tlsf_block_size(block) + TLSF_HEADER_SIZE;
+        block = prev;
+    }
+
+    // Merge with the next block
+    TLSFBlock* next = tlsf_block_next(block);
+    if (tlsf_block_is_free(next)) {
+        tlsf_remove_free_block(tlsf, next);
+        block->size += tlsf_block_size(next) + TLSF_HEADER_SIZE;
+        next = tlsf_block_next(block);
+    }
+
+    block->size |= TLSF_BLOCK_FREE;
+    next->prev_phys = block;
+    tlsf_insert_free(tlsf, block);
+}
+
+/*
+ * Resizes an allocation, in place if it is shrinking or the next block is free
+ * and big enough, otherwise by allocating a new block and copying. Behaves
+ * like realloc() (NULL ptr allocates, 0 size frees).
+ */
+void* tlsf_realloc(TLSF* tlsf, void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return tlsf_malloc(tlsf, size);
+    }
+    if (size == 0) {
+        tlsf_free(tlsf, ptr);
+        return NULL;
+    }
+
+    size_t adjusted = tlsf_adjust_size(size);
+    if (adjusted == 0) {
+        tlsf->failures++;
+        return NULL;
+    }
+
+    TLSFBlock* block = tlsf_ptr_to_block(ptr);
+    size_t current = tlsf_block_size(block);
+    TLSFBlock* next = tlsf_block_next(block);
+    size_t next_free_size = tlsf_block_is_free(next) ?
+            tlsf_block_size(next) + TLSF_HEADER_SIZE : 0;
+
+    if (adjusted > current && adjusted <= current + next_free_size) {
+        // Grow into the next block
+        tlsf_remove_free_block(tlsf, next);
+        block->size += next_free_size;
+        tlsf->used_bytes += next_free_size;
+        tlsf_block_next(block)->prev_phys = block;
+    } else if (adjusted > current) {
+        void* new_ptr = tlsf_malloc(tlsf, size);
+        if (new_ptr != NULL) {
+            memcpy(new_ptr, ptr, current);
+            tlsf_free(tlsf, ptr);
+        }
+        return new_ptr;
+    }
+
+    tlsf_trim_used(tlsf, block, adjusted);
+    if (tlsf->used_bytes > tlsf->peak_used_bytes) {
+        tlsf->peak_used_bytes = tlsf->used_bytes;
+    }
+    return ptr;
+}
+
+/*
+ * Allocates zeroed memory for `count` items of `size` bytes.
+ */
+void* tlsf_calloc(TLSF* tlsf, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        tlsf->failures++;
+        return NULL;
+    }
+    void* ptr = tlsf_malloc(tlsf, count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+/*
+ * Returns the usable size of an allocation (at least what was requested).
+ */
+size_t tlsf_get_size(void* ptr) {
+    if (ptr == NULL) {
+        return 0;
+    }
+    return tlsf_block_size(tlsf_ptr_to_block(ptr));
+}
+
+/*
+ * Returns true if ptr is inside the pool's memory.
+ */
+bool tlsf_owns(TLSF* tlsf, void* ptr) {
+    uint8_t* p = (uint8_t*) ptr;
+    return p >= tlsf->pool_start && p < tlsf->pool_start + tlsf->pool_bytes;
+}
+
+/*
+ * Gets the pool's usage and counters.
+ *
+ * Finding the largest free block searches the highest non-empty list, so this
+ * is not constant time.
+ */
+void tlsf_get_stats(TLSF* tlsf, TLSFStats* stats) {
+    stats->pool_bytes = tlsf->pool_bytes;
+    stats->used_bytes = tlsf->used_bytes;
+    stats->peak_used_bytes = tlsf->peak_used_bytes;
+    stats->free_blocks = tlsf->free_blocks;
+    stats->allocs = tlsf->allocs;
+    stats->frees = tlsf->frees;
+    stats->failures = tlsf->failures;
+
+    stats->largest_free = 0;
+    if (tlsf->fl_bitmap != 0) {
+        uint32_t fl = tlsf_fls(tlsf->fl_bitmap);
+        uint32_t sl = tlsf_fls(tlsf->sl_bitmap[fl]);
+        for (TLSFBlock* block = tlsf->blocks[fl][sl];
+                block != &tlsf->block_null; block = block->next_free) {
+            if (tlsf_block_size(block) > stats->largest_free) {
+                stats->largest_free = tlsf_block_size(block);
+            }
+        }
+    }
+    // tlsf_malloc() rounds a request up to the next list's size, then takes
+    // any block from that list or a larger one, so the largest request that
+    // finds the largest block is the smallest size in its list
+    stats->largest_request = tlsf_mapping_floor(stats->largest_free);
+}
+
+/*
+ * Walks every block in the pool and every free list, and returns false if
+ * anything is inconsistent (e.g. after a buffer overrun into a block header).
+ * This takes time proportional to the number of blocks, so it is meant for
+ * tests and debugging.
+ */
+bool tlsf_check(TLSF* tlsf) {
+    if (tlsf->pool_start == NULL) {
+        return false;
+    }
+
+    // Physical blocks: links match, no two free blocks in a row, and the
+    // sizes add up to the pool
+    TLSFBlock* prev = NULL;
+    TLSFBlock* block = (TLSFBlock*) tlsf->pool_start;
+    size_t total = 0;
+    size_t used = 0;
+    uint32_t free_blocks = 0;
+    while (tlsf_block_size(block) != 0) {
+        if (block->prev_phys != prev || total > tlsf->pool_bytes) {
+            return false;
+        }
+        if (tlsf_block_is_free(block)) {
+            if (prev != NULL && tlsf_block_is_free(prev)) {
+                return false;
+            }
+            free_blocks++;
+        } else {
+            used += tlsf_block_size(block) + TLSF_HEADER_SIZE;
+        }
+        total += tlsf_block_size(block) + TLSF_HEADER_SIZE;
+        prev = block;
+        block = tlsf_block_next(block);
+    }
+    if (block->prev_phys != prev || total != tlsf->pool_bytes ||
+            used != tlsf->used_bytes || free_blocks != tlsf->free_blocks) {
+        return false;
+    }
+
+    // Free lists: bitmaps match, and each block is free and in the right list
+    uint32_t listed = 0;
+    for (uint32_t fl = 0; fl < TLSF_FL_COUNT; fl++) {
+        bool fl_set = (tlsf->fl_bitmap & (1U << fl)) != 0;
+        if (fl_set != (tlsf->sl_bitmap[fl] != 0)) {
+            return false;
+        }
+        for (uint32_t sl = 0; sl < TLSF_SL_COUNT; sl++) {
+            TLSFBlock* head = tlsf->blocks[fl][sl];
+            bool sl_set = (tlsf->sl_bitmap[fl] & (1U << sl)) != 0;
+            if (sl_set != (head != &tlsf->block_null)) {
+                return false;
+            }
+            for (block = head; block != &tlsf->block_null;
+                    block = block->next_free) {
+                uint32_t block_fl;
+                uint32_t block_sl;
+                tlsf_mapping_insert(tlsf_block_size(block), &block_fl,
+                        &block_sl);
+                if (!tlsf_block_is_free(block) || block_fl != fl ||
+                        block_sl != sl) {
+                    return false;
+                }
+                if (block->next_free != &tlsf->block_null &&
+                        block->next_free->prev_free != block) {
+                    return false;
+                }
+                listed++;
+            }
+        }
+    }
+    return listed == tlsf->free_blocks;
+}
@@ -0,0 +1,91 @@
+/*
+ * TLSF.h
+ *
+ *  Created on: Oct. 19, 2026
+ */
+
+#ifndef COMMON_STM32_UTIL_TLSF_H_
+#define COMMON_STM32_UTIL_TLSF_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Alignment of all blocks and returned pointers (8 for doubles and uint64_t)
+#define TLSF_ALIGN_LOG2 3
+#define TLSF_ALIGN (1 << TLSF_ALIGN_LOG2)
+// Number of second level lists per first level (power of 2) range
+#define TLSF_SL_COUNT_LOG2 5
+#define TLSF_SL_COUNT (1 << TLSF_SL_COUNT_LOG2)
+// Blocks below this size all go in first level 0, split into TLSF_SL_COUNT
+// lists TLSF_ALIGN bytes apart
+#define TLSF_FL_SHIFT (TLSF_SL_COUNT_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_BLOCK_SIZE (1 << TLSF_FL_SHIFT)
+// Blocks must be smaller than 2^TLSF_FL_MAX bytes (1 MB, more than the RAM
+// on either MCU)
+#define TLSF_FL_MAX 20
+#define TLSF_FL_COUNT (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+
+typedef struct TLSFBlock {
+    // Block just before this one in memory (NULL for the first block)
+    struct TLSFBlock* prev_phys;
+    // Size of the block's data (a multiple of TLSF_ALIGN), with the free flag
+    // in bit 0
+    size_t size;
+    // Free list links, only valid while the block is free (they are the first
+    // bytes of the data)
+    struct TLSFBlock* next_free;
+    struct TLSFBlock* prev_free;
+} TLSFBlock;
+
+typedef struct {
+    // Bytes managed by the pool (including block headers)
+    size_t pool_bytes;
+    // Bytes in allocated blocks (including their headers and rounding), now
+    // and at most since the pool was set up
+    size_t used_bytes;
+    size_t peak_used_bytes;
+    // Size of the largest free block. A request for this many bytes can still
+    // fail, since requests are rounded up to the next list's size (see TLSF.c)
+    size_t largest_free;
+    // Largest request that would currently succeed
+    size_t largest_request;
+    uint32_t free_blocks;
+    uint32_t allocs;
+    uint32_t frees;
+    // Number of allocations that returned NULL because no block was big enough
+    uint32_t failures;
+} TLSFStats;
+
+typedef struct {
+    // Bit n is set if first level n has any free blocks
+    uint32_t fl_bitmap;
+    // Bit m of sl_bitmap[n] is set if list [n][m] has any free blocks
+    uint32_t sl_bitmap[TLSF_FL_COUNT];
+    // Heads of the free lists (&block_null if empty)
+    TLSFBlock* blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    // End of the free lists, so inserting and removing has no NULL checks
+    TLSFBlock block_null;
+
+    uint8_t* pool_start;
+    size_t pool_bytes;
+    size_t used_bytes;
+    size_t peak_used_bytes;
+    uint32_t free_blocks;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+} TLSF;
+
+bool tlsf_init(TLSF* tlsf, void* mem, size_t bytes);
+void* tlsf_malloc(TLSF* tlsf, size_t size);
+void tlsf_free(TLSF* tlsf, void* ptr);
+void* tlsf_realloc(TLSF* tlsf, void* ptr, size_t size);
+void* tlsf_calloc(TLSF* tlsf, size_t count, size_t size);
+size_t tlsf_get_size(void* ptr);
+bool tlsf_owns(TLSF* tlsf, void* ptr);
+
+void tlsf_get_stats(TLSF* tlsf, TLSFStats* stats);
+bool tlsf_check(TLSF* tlsf);
+
+#endif /* COMMON_STM32_UTIL_TLSF_H_ */